@@ -2,6 +2,7 @@
 #include "mpc_lowmc.h"
 
 #include <m4ri/m4ri.h>
+#include <stdbool.h>
 
 #if COMMITMENT_LENGTH == SHA256_DIGEST_LENGTH
 typedef SHA256_CTX commitment_ctx;
@@ -20,36 +21,92 @@ typedef SHA512_CTX commitment_ctx;
 #define commitment_final SHA512_Final
 #endif
 
-static void commit_mzd(commitment_ctx* ctx, mzd_t const* v) {
-  commitment_update(ctx, CONST_FIRST_ROW(v), sizeof(word) * v->width * v->nrows);
-}
-
-#if COMMITMENT_LENGTH == SHA256_DIGEST_LENGTH
-#define hash_mzd commit_mzd
-#else
-static void hash_mzd(SHA256_CTX* ctx, mzd_t const* v) {
-  SHA256_Update(ctx, CONST_FIRST_ROW(v), sizeof(word) * v->width * v->nrows);
-}
-#endif
-
-void H(const unsigned char k[PRNG_KEYSIZE], mzd_t* y[SC_PROOF], const view_t* v, unsigned vidx,
-       unsigned vcnt, const unsigned char r[COMMITMENT_RAND_LENGTH],
+void H(const unsigned char k[PRNG_KEYSIZE], word* const y[SC_PROOF], mpc_lowmc_t const* lowmc,
+       view_t const* v, unsigned vidx, unsigned vcnt, const unsigned char r[COMMITMENT_RAND_LENGTH],
        unsigned char hash[COMMITMENT_LENGTH]) {
+  const size_t width_k = (lowmc->k + m4ri_radix - 1) / m4ri_radix;
+  const size_t width_n = (lowmc->n + m4ri_radix - 1) / m4ri_radix;
+
   commitment_ctx ctx;
   commitment_init(&ctx);
   commitment_update(&ctx, k, PRNG_KEYSIZE);
 
   for (unsigned i = 0; i < SC_PROOF; ++i) {
-    commit_mzd(&ctx, y[i]);
+    commitment_update(&ctx, y[i], sizeof(word) * width_n);
   }
-  for (unsigned i = 0; i < vcnt; ++i) {
-    commit_mzd(&ctx, v[i].s[vidx]);
+
+  // views stored back to back are hashed with a single update
+  word const* start = v[0].s[vidx];
+  size_t len        = width_k;
+  for (unsigned i = 1; i < vcnt; ++i) {
+    word const* next = v[i].s[vidx];
+    if (next != start + len) {
+      commitment_update(&ctx, start, sizeof(word) * len);
+      start = next;
+      len   = 0;
+    }
+    len += width_n;
   }
+  commitment_update(&ctx, start, sizeof(word) * len);
 
   commitment_update(&ctx, r, COMMITMENT_RAND_LENGTH);
   commitment_final(hash, &ctx);
 }
 
+void H_multiple(unsigned int count, unsigned char const* const* k, word* const* const* y,
+                mpc_lowmc_t const* lowmc, view_t const* const* v, unsigned int const* vidx,
+                unsigned vcnt, unsigned char const* const* r, unsigned char* const* hash) {
+#if COMMITMENT_LENGTH == SHA256_DIGEST_LENGTH
+  const size_t width_k = (lowmc->k + m4ri_radix - 1) / m4ri_radix;
+  const size_t width_n = (lowmc->n + m4ri_radix - 1) / m4ri_radix;
+
+  sha256_multi_ctx ctx;
+  sha256_multi_init(&ctx, count);
+  sha256_multi_update(&ctx, k, PRNG_KEYSIZE);
+
+  unsigned char const* data[SHA256_MULTI_LANES];
+  for (unsigned i = 0; i < SC_PROOF; ++i) {
+    for (unsigned int l = 0; l < count; ++l) {
+      data[l] = (unsigned char const*)y[l][i];
+    }
+    sha256_multi_update(&ctx, data, sizeof(word) * width_n);
+  }
+
+  // views stored back to back in all lanes are hashed with a single update
+  word const* start[SHA256_MULTI_LANES];
+  for (unsigned int l = 0; l < count; ++l) {
+    start[l] = v[l][0].s[vidx[l]];
+  }
+  size_t len = width_k;
+  for (unsigned i = 1; i < vcnt; ++i) {
+    bool contiguous = true;
+    for (unsigned int l = 0; l < count; ++l) {
+      contiguous = contiguous && v[l][i].s[vidx[l]] == start[l] + len;
+    }
+    if (!contiguous) {
+      for (unsigned int l = 0; l < count; ++l) {
+        data[l]  = (unsigned char const*)start[l];
+        start[l] = v[l][i].s[vidx[l]];
+      }
+      sha256_multi_update(&ctx, data, sizeof(word) * len);
+      len = 0;
+    }
+    len += width_n;
+  }
+  for (unsigned int l = 0; l < count; ++l) {
+    data[l] = (unsigned char const*)start[l];
+  }
+  sha256_multi_update(&ctx, data, sizeof(word) * len);
+
+  sha256_multi_update(&ctx, r, COMMITMENT_RAND_LENGTH);
+  sha256_multi_final(&ctx, hash);
+#else
+  for (unsigned int l = 0; l < count; ++l) {
+    H(k[l], y[l], lowmc, v[l], vidx[l], vcnt, r[l], hash[l]);
+  }
+#endif
+}
+
 static void H3_compute(unsigned char hash[SHA256_DIGEST_LENGTH], unsigned char* ch) {
   // Pick bits from hash
   unsigned char* eof      = ch + NUM_ROUNDS;
@@ -3,14 +3,26 @@
 
 #include "mpc_lowmc.h"
 #include "parameters.h"
+#include "sha256_multi.h"
 
 /**
  * Computes commitments to the view of an execution.
+ *
+ * \param y    the output shares, lowmc->n bits each
+ * \param vidx the party whose views are committed to
  */
-void H(const unsigned char k[PRNG_KEYSIZE], mzd_t* y[SC_PROOF], view_t const* v, unsigned vidx,
-       unsigned vcnt, const unsigned char r[COMMITMENT_RAND_LENGTH],
+void H(const unsigned char k[PRNG_KEYSIZE], word* const y[SC_PROOF], mpc_lowmc_t const* lowmc,
+       view_t const* v, unsigned vidx, unsigned vcnt, const unsigned char r[COMMITMENT_RAND_LENGTH],
        unsigned char hash[COMMITMENT_LENGTH]);
 
+/**
+ * Computes count <= SHA256_MULTI_LANES commitments at once. The i-th commitment is the one computed
+ * by H(k[i], y[i], lowmc, v[i], vidx[i], vcnt, r[i], hash[i]).
+ */
+void H_multiple(unsigned int count, unsigned char const* const* k, word* const* const* y,
+                mpc_lowmc_t const* lowmc, view_t const* const* v, unsigned int const* vidx,
+                unsigned vcnt, unsigned char const* const* r, unsigned char* const* hash);
+
 /**
  * Computes the challenge for Fish (when signing).
  */
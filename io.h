@@ -5,4 +5,17 @@ unsigned char* mzd_to_char_array(mzd_t* data, unsigned numbytes);
 
 mzd_t* mzd_from_char_array(unsigned char* data, unsigned len, unsigned vec_len);
 
+/**
+ * Like mzd_to_char_array, but reads the words of a vector with vec_len columns from row and
+ * writes numbytes bytes to dst.
+ */
+void mzd_row_to_char_array(unsigned char* dst, word const* row, unsigned vec_len,
+                           unsigned numbytes);
+
+/**
+ * Like mzd_from_char_array, but writes to the cleared words of a vector with vec_len columns.
+ */
+void mzd_row_from_char_array(word* row, unsigned vec_len, unsigned char const* data,
+                             unsigned len);
+
 #endif
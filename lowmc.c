@@ -1,12 +1,15 @@
 #include "lowmc.h"
 #include "lowmc_pars.h"
 #include "mzd_additional.h"
+#include "mzd_fixed.h"
+
+#include <string.h>
 
 #ifdef WITH_OPT
 #include "simd.h"
 #endif
 
-static void sbox_layer_bitsliced(mzd_t* out, mzd_t* in, rci_t m, mask_t const* mask) {
+void sbox_layer_bitsliced(mzd_t* out, mzd_t* in, mask_t const* mask) {
   mzd_and(out, in, mask->mask);
 
   mzd_t* buffer[6] = {NULL};
@@ -42,6 +45,65 @@ static void sbox_layer_bitsliced(mzd_t* out, mzd_t* in, rci_t m, mask_t const* m
   mzd_local_free_multiple(buffer);
 }
 
+/**
+ * sbox_layer_bitsliced for a state of width words.
+ */
+FN_ATTRIBUTES_FIXED void sbox_layer_fixed(mzd_t* out, mzd_t* in, mask_t const* mask,
+                                          const unsigned int width) {
+  word const* inw = CONST_FIRST_ROW(in);
+  word x0m[MZD_FIXED_MAX_WIDTH], x1m[MZD_FIXED_MAX_WIDTH], x2m[MZD_FIXED_MAX_WIDTH];
+  word t0[MZD_FIXED_MAX_WIDTH], t1[MZD_FIXED_MAX_WIDTH], t2[MZD_FIXED_MAX_WIDTH];
+
+  mzd_fixed_and(x0m, inw, CONST_FIRST_ROW(mask->x0), width);
+  mzd_fixed_and(x1m, inw, CONST_FIRST_ROW(mask->x1), width);
+  mzd_fixed_and(x2m, inw, CONST_FIRST_ROW(mask->x2), width);
+
+  mzd_fixed_shift_left(x0m, x0m, 2, width);
+  mzd_fixed_shift_left(x1m, x1m, 1, width);
+
+  mzd_fixed_and(t0, x1m, x2m, width);
+  mzd_fixed_and(t1, x0m, x2m, width);
+  mzd_fixed_and(t2, x0m, x1m, width);
+
+  mzd_fixed_xor(t0, t0, x0m, width);
+
+  mzd_fixed_xor(x0m, x0m, x1m, width);
+  mzd_fixed_xor(t1, t1, x0m, width);
+
+  mzd_fixed_xor(t2, t2, x0m, width);
+  mzd_fixed_xor(t2, t2, x2m, width);
+
+  mzd_fixed_shift_right(t0, t0, 2, width);
+  mzd_fixed_shift_right(t1, t1, 1, width);
+
+  word* outw = FIRST_ROW(out);
+  mzd_fixed_and(outw, inw, CONST_FIRST_ROW(mask->mask), width);
+  mzd_fixed_xor(outw, outw, t2, width);
+  mzd_fixed_xor(outw, outw, t0, width);
+  mzd_fixed_xor(outw, outw, t1, width);
+}
+
+/**
+ * Instantiates sbox_layer_fixed for block size n as name_n.
+ */
+#define sbox_layer_fixed_instantiate(attr, name, n)                                                \
+  attr static void name##_##n(mzd_t* out, mzd_t* in, mask_t const* mask) {                        \
+    sbox_layer_fixed(out, in, mask, (n) / (sizeof(word) * 8));                                     \
+  }
+
+sbox_layer_fixed_instantiate(, sbox_layer_fixed, 128)
+sbox_layer_fixed_instantiate(, sbox_layer_fixed, 192)
+sbox_layer_fixed_instantiate(, sbox_layer_fixed, 256)
+sbox_layer_fixed_instantiate(, sbox_layer_fixed, 384)
+sbox_layer_fixed_instantiate(, sbox_layer_fixed, 512)
+
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+sbox_layer_fixed_instantiate(__attribute__((target("avx2"))), sbox_layer_fixed_avx, 384)
+sbox_layer_fixed_instantiate(__attribute__((target("avx2"))), sbox_layer_fixed_avx, 512)
+#endif
+
+#undef sbox_layer_fixed_instantiate
+
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
 __attribute__((target("sse2"))) static void sbox_layer_sse(mzd_t* out, mzd_t* in,
@@ -134,57 +196,223 @@ __attribute__((target("avx2"))) static void sbox_layer_avx(mzd_t* out, mzd_t* in
 #endif
 #endif
 
-mzd_t* lowmc_call(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p) {
-  if (p->ncols > lowmc->n) {
-    printf("p larger than block size!\n");
-    return NULL;
+lowmc_sbox_fn lowmc_sbox_select(rci_t n) {
+#ifdef WITH_OPT
+#ifdef WITH_SSE2
+  if (CPU_SUPPORTS_SSE2 && n == 128) {
+    return sbox_layer_sse;
   }
-  if (p->nrows != 1) {
-    printf("p needs to have exactly one row!\n");
+#endif
+#ifdef WITH_AVX2
+  if (CPU_SUPPORTS_AVX2 && n == 256) {
+    return sbox_layer_avx;
+  }
+  if (CPU_SUPPORTS_AVX2 && n == 384) {
+    return sbox_layer_fixed_avx_384;
   }
+  if (CPU_SUPPORTS_AVX2 && n == 512) {
+    return sbox_layer_fixed_avx_512;
+  }
+#endif
+#endif
 
-  mzd_t* x = mzd_local_init_ex(1, lowmc->n, false);
-  mzd_t* y = mzd_local_init_ex(1, lowmc->n, false);
+  switch (n) {
+  case 128:
+    return sbox_layer_fixed_128;
+  case 192:
+    return sbox_layer_fixed_192;
+  case 256:
+    return sbox_layer_fixed_256;
+  case 384:
+    return sbox_layer_fixed_384;
+  case 512:
+    return sbox_layer_fixed_512;
+  default:
+    return sbox_layer_bitsliced;
+  }
+}
 
-  mzd_local_copy(x, p);
+void lowmc_expand_key(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t* const* round_keys,
+                      unsigned int stride) {
+#ifdef REDUCED_ROUND_KEYS
+#ifdef NOSCR
+  lowmc->kernels.mul_vl_rrk(round_keys[0], lowmc_key, lowmc->rrk_lookup);
+  lowmc->kernels.mul_vl(round_keys[stride], lowmc_key, lowmc->kf_lookup);
+#else
+  mzd_mul_v(round_keys[0], lowmc_key, lowmc->rrk_matrix);
+  mzd_mul_v(round_keys[stride], lowmc_key, lowmc->kf_matrix);
+#endif
+#else
 #ifdef NOSCR
-  mzd_addmul_vl(x, lowmc_key, lowmc->k0_lookup);
+  lowmc->kernels.mul_vl(round_keys[0], lowmc_key, lowmc->k0_lookup);
 #else
-  mzd_addmul_v(x, lowmc_key, lowmc->k0_matrix);
+  mzd_mul_v(round_keys[0], lowmc_key, lowmc->k0_matrix);
 #endif
 
   lowmc_round_t const* round = lowmc->rounds;
   for (unsigned i = 0; i < lowmc->r; ++i, ++round) {
-#ifdef WITH_OPT
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && lowmc->n == 128) {
-      sbox_layer_sse(y, x, &lowmc->mask);
-    } else
+    mzd_t* round_key = round_keys[(i + 1) * stride];
+#ifdef NOSCR
+    lowmc->kernels.mul_vl(round_key, lowmc_key, round->k_lookup);
+#else
+    mzd_mul_v(round_key, lowmc_key, round->k_matrix);
 #endif
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && lowmc->n == 256) {
-      sbox_layer_avx(y, x, &lowmc->mask);
-    } else
+  }
 #endif
+}
+
+unsigned int lowmc_key_schedule_length(lowmc_t const* lowmc) {
+#ifdef REDUCED_ROUND_KEYS
+  (void)lowmc;
+  return 2;
+#else
+  return lowmc->r + 1;
+#endif
+}
+
+mzd_t** lowmc_key_schedule_init_multiple(lowmc_t const* lowmc, unsigned int count) {
+  const unsigned int length = lowmc_key_schedule_length(lowmc);
+
+  mzd_t** round_keys = calloc(length * count + 1, sizeof(mzd_t*));
+  if (!round_keys) {
+    return NULL;
+  }
+
+  for (unsigned int i = 0; i < length; ++i) {
+#ifdef REDUCED_ROUND_KEYS
+    const rci_t ncols = i ? (rci_t)lowmc->n : lowmc->rrk_matrix->ncols;
+#else
+    const rci_t ncols = lowmc->n;
 #endif
-    {
-      sbox_layer_bitsliced(y, x, lowmc->m, &lowmc->mask);
+    if (!mzd_local_init_multiple_ex(&round_keys[i * count], count, 1, ncols, false)) {
+      lowmc_key_schedule_free_multiple(round_keys, count);
+      return NULL;
+    }
+  }
+  return round_keys;
+}
+
+void lowmc_key_schedule_free_multiple(mzd_t** round_keys, unsigned int count) {
+  if (round_keys) {
+    for (mzd_t** block = round_keys; *block; block += count) {
+      mzd_local_free_multiple(block);
     }
+    free(round_keys);
+  }
+}
+
+mzd_t** lowmc_key_schedule_init(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key) {
+  mzd_t** round_keys = lowmc_key_schedule_init_multiple(lowmc, 1);
+  if (round_keys) {
+    lowmc_expand_key(lowmc, lowmc_key, round_keys, 1);
+  }
+  return round_keys;
+}
+
+void lowmc_key_schedule_free(mzd_t** round_keys) {
+  lowmc_key_schedule_free_multiple(round_keys, 1);
+}
+
+#ifdef REDUCED_ROUND_KEYS
+/**
+ * lowmc_linear_layer for folded linear layers. The lower and the upper words of y are copied into
+ * vectors on the stack, so that they can be passed to the kernels.
+ */
+static void lowmc_folded_linear_layer(lowmc_t const* lowmc, mzd_t* x, mzd_t const* y,
+                                      unsigned int i) {
+  if (i + 1 == lowmc->r) {
+#ifdef NOSCR
+    lowmc->kernels.mul_vl(x, y, lowmc->lf_lookup);
+#else
+    mzd_mul_v(x, y, lowmc->lf_matrix);
+#endif
+    return;
+  }
+
+  lowmc_round_t const* round = &lowmc->rounds[i];
+  const unsigned int first   = lowmc->rrk_word;
+  const rci_t lower          = first * m4ri_radix;
+
+  // each holds the 64 byte mzd_t followed by a row of at most MZD_FIXED_MAX_WIDTH words
+  word buffers[3][64 / sizeof(word) + MZD_FIXED_MAX_WIDTH] __attribute__((aligned(32)));
+  word* rows[3];
+  mzd_t* y_lower = mzd_local_setup_in_place(buffers[0], 1, lower, &rows[0]);
+  mzd_t* y_upper = mzd_local_setup_in_place(buffers[1], 1, lowmc->n - lower, &rows[1]);
+  mzd_t* z       = mzd_local_setup_in_place(buffers[2], 1, lowmc->n - lower, &rows[2]);
+
+  word const* yptr = CONST_FIRST_ROW(y);
+  memcpy(FIRST_ROW(y_lower), yptr, first * sizeof(word));
+  memcpy(FIRST_ROW(y_upper), yptr + first, y_upper->width * sizeof(word));
 
 #ifdef NOSCR
-    mzd_mul_vl(x, y, round->l_lookup);
+  lowmc->kernels.mul_vl_upper(x, y_upper, round->upper_lookup);
+  lowmc->kernels.mul_vl_lower(z, y_lower, round->lower_lookup);
 #else
-    mzd_mul_v(x, y, round->l_matrix);
+  mzd_mul_v(x, y_upper, round->upper_matrix);
+  mzd_mul_v(z, y_lower, round->lower_matrix);
+#endif
+
+  // the lower words are mapped to themselves
+  word* xptr       = FIRST_ROW(x);
+  word const* zptr = CONST_FIRST_ROW(z);
+  for (unsigned int w = 0; w < first; ++w) {
+    xptr[w] ^= yptr[w];
+  }
+  for (rci_t w = 0; w < z->width; ++w) {
+    xptr[first + w] ^= zptr[w];
+  }
+}
 #endif
-    mzd_xor(x, x, round->constant);
+
+void lowmc_linear_layer(lowmc_t const* lowmc, mzd_t* x, mzd_t const* y, unsigned int i) {
+#ifdef REDUCED_ROUND_KEYS
+  if (lowmc->folded) {
+    lowmc_folded_linear_layer(lowmc, x, y, i);
+    return;
+  }
+#endif
+
 #ifdef NOSCR
-    mzd_addmul_vl(x, lowmc_key, round->k_lookup);
+  lowmc->kernels.mul_vl(x, y, lowmc->rounds[i].l_lookup);
 #else
-    mzd_addmul_v(x, lowmc_key, round->k_matrix);
+  mzd_mul_v(x, y, lowmc->rounds[i].l_matrix);
 #endif
+}
+
+mzd_t* lowmc_call_key_schedule(lowmc_t const* lowmc, mzd_t* const* round_keys, mzd_t const* p) {
+  if (p->ncols > lowmc->n) {
+    printf("p larger than block size!\n");
+    return NULL;
+  }
+  if (p->nrows != 1) {
+    printf("p needs to have exactly one row!\n");
+  }
+
+  mzd_t* x = mzd_local_init_ex(1, lowmc->n, false);
+  mzd_t* y = mzd_local_init_ex(1, lowmc->n, false);
+
+  mzd_local_copy(x, p);
+
+  for (unsigned i = 0; i < lowmc->r; ++i) {
+    lowmc_add_round_key(lowmc, x, round_keys, i, 1);
+    lowmc->kernels.sbox(y, x, &lowmc->mask);
+    lowmc_linear_layer(lowmc, x, y, i);
+    mzd_xor(x, x, lowmc_round_constant(lowmc, i));
   }
+  lowmc_add_round_key(lowmc, x, round_keys, lowmc->r, 1);
 
   mzd_local_free(y);
 
   return x;
 }
+
+mzd_t* lowmc_call(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p) {
+  mzd_t** round_keys = lowmc_key_schedule_init(lowmc, lowmc_key);
+  if (!round_keys) {
+    return NULL;
+  }
+
+  mzd_t* c = lowmc_call_key_schedule(lowmc, round_keys, p);
+  lowmc_key_schedule_free(round_keys);
+  return c;
+}
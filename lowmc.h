@@ -4,6 +4,17 @@
 #include "lowmc_pars.h"
 #include <m4ri/m4ri.h>
 
+/**
+ * Selects the S-box layer for block size n.
+ */
+lowmc_sbox_fn lowmc_sbox_select(rci_t n);
+
+/**
+ * S-box layer for any block size. The layers returned by lowmc_sbox_select and the MPC S-box
+ * layers are specializations of it.
+ */
+void sbox_layer_bitsliced(mzd_t* out, mzd_t* in, mask_t const* mask);
+
 /**
  * Implements LowMC encryption
  *
@@ -13,4 +24,84 @@
  */
 mzd_t* lowmc_call(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t const* p);
 
+/**
+ * Computes the key schedule of a key, i.e. the products of the key with the key matrices. The
+ * schedule consists of lowmc_key_schedule_length vectors and the i-th vector is stored in
+ * round_keys[i * stride]. Without reduced round keys, these are the r + 1 round keys. Otherwise,
+ * the first vector holds the S-box bits of the round keys of all rounds and the second one the key
+ * added after the last round.
+ */
+void lowmc_expand_key(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key, mzd_t* const* round_keys,
+                      unsigned int stride);
+
+/**
+ * Number of vectors of a key schedule.
+ */
+unsigned int lowmc_key_schedule_length(lowmc_t const* lowmc);
+
+/**
+ * Allocates count key schedules. The i-th vector of the j-th schedule is stored in
+ * round_keys[i * count + j], so lowmc_expand_key fills the j-th schedule with &round_keys[j] and
+ * stride count.
+ *
+ * \return the vectors to be freed with lowmc_key_schedule_free_multiple or NULL on failure
+ */
+mzd_t** lowmc_key_schedule_init_multiple(lowmc_t const* lowmc, unsigned int count);
+void lowmc_key_schedule_free_multiple(mzd_t** round_keys, unsigned int count);
+
+/**
+ * Allocates and computes the key schedule of a key.
+ *
+ * \return the key schedule to be freed with lowmc_key_schedule_free
+ */
+mzd_t** lowmc_key_schedule_init(lowmc_t const* lowmc, lowmc_key_t const* lowmc_key);
+void lowmc_key_schedule_free(mzd_t** round_keys);
+
+/**
+ * Adds the round key of round i from a key schedule stored with the given stride to x. It is added
+ * before the S-box layer of round i. Round r denotes the key addition after the last round.
+ */
+static inline void lowmc_add_round_key(lowmc_t const* lowmc, mzd_t* x, mzd_t* const* round_keys,
+                                       unsigned int i, unsigned int stride) {
+#ifdef REDUCED_ROUND_KEYS
+  if (i == lowmc->r) {
+    mzd_xor(x, x, round_keys[stride]);
+    return;
+  }
+
+  word* xptr       = FIRST_ROW(x) + lowmc->rrk_word;
+  word const* kptr = CONST_FIRST_ROW(round_keys[0]) + i * lowmc->rrk_words;
+  for (unsigned int w = 0; w < lowmc->rrk_words; ++w) {
+    xptr[w] ^= kptr[w];
+  }
+#else
+  (void)lowmc;
+  mzd_xor(x, x, round_keys[i * stride]);
+#endif
+}
+
+/**
+ * Computes the product of the output y of the S-box layer of round i with the linear layer of the
+ * round and stores it in x. If the linear layers are folded, x and y are in the bases of the states
+ * described in lowmc_t. x and y must not overlap.
+ */
+void lowmc_linear_layer(lowmc_t const* lowmc, mzd_t* x, mzd_t const* y, unsigned int i);
+
+/**
+ * Returns the constant of round i, which is added after lowmc_linear_layer.
+ */
+static inline mzd_t const* lowmc_round_constant(lowmc_t const* lowmc, unsigned int i) {
+#ifdef REDUCED_ROUND_KEYS
+  if (lowmc->folded) {
+    return lowmc->rounds[i].folded_constant;
+  }
+#endif
+  return lowmc->rounds[i].constant;
+}
+
+/**
+ * Like lowmc_call, but with the key schedule from lowmc_key_schedule_init.
+ */
+mzd_t* lowmc_call_key_schedule(lowmc_t const* lowmc, mzd_t* const* round_keys, mzd_t const* p);
+
 #endif
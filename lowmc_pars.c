@@ -1,15 +1,34 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
 #include "lowmc_pars.h"
+#include "lowmc.h"
 #include "mpc.h"
+#include "mpc_lowmc.h"
 #include "mzd_additional.h"
+#include "mzd_fixed.h"
 #include "randomness.h"
+#include "thread_pool.h"
 
 #include <m4ri/m4ri.h>
+#include <openssl/sha.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef HAVE_SYS_MMAN_H
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
 
 static mask_t* prepare_masks(mask_t* mask, rci_t n, rci_t m) {
   mask->x0   = mzd_local_init(1, n);
-  mask->x1   = mzd_local_init_ex(1, n, false);
-  mask->x2   = mzd_local_init_ex(1, n, false);
+  mask->x1   = mzd_local_init(1, n);
+  mask->x2   = mzd_local_init(1, n);
   mask->mask = mzd_local_init(1, n);
 
   const int bound = n - 3 * m;
@@ -25,22 +44,64 @@ static mask_t* prepare_masks(mask_t* mask, rci_t n, rci_t m) {
   return mask;
 }
 
-static mzd_t* mzd_sample_matrix_word(rci_t n, rci_t k, rci_t rank, bool with_xor) {
-  // use mzd_init for A since m4ri will work with it in mzd_echolonize
-  // also, this function cannot be parallelized as mzd_echolonize will call
-  // mzd_init and mzd_free at will causing various crashes.
-  mzd_t* A = mzd_init(n, k);
-  mzd_t* B = mzd_local_init_ex(n, k, false);
+/**
+ * Computes the rank of A. The rows of A are reduced in place and their order is changed. If pivots
+ * is not NULL, the pivot columns are set in the vector pivots.
+ */
+static rci_t mzd_local_rank(mzd_t* A, mzd_t* pivots) {
+  const rci_t nrows = A->nrows;
+  const rci_t width = A->width;
+
+  rci_t rank = 0;
+  for (rci_t c = 0; c < A->ncols && rank < nrows; ++c) {
+    const rci_t w   = c / m4ri_radix;
+    const word mask = m4ri_one << (c % m4ri_radix);
+    rci_t pivot     = rank;
+    while (pivot < nrows && !(A->rows[pivot][w] & mask)) {
+      ++pivot;
+    }
+    if (pivot == nrows) {
+      continue;
+    }
+
+    if (pivots) {
+      FIRST_ROW(pivots)[w] |= mask;
+    }
+
+    word* pivot_row = A->rows[pivot];
+    A->rows[pivot]  = A->rows[rank];
+    A->rows[rank]   = pivot_row;
+    for (rci_t i = rank + 1; i < nrows; ++i) {
+      word* row = A->rows[i];
+      if (row[w] & mask) {
+        for (rci_t j = w; j < width; ++j) {
+          row[j] ^= pivot_row[j];
+        }
+      }
+    }
+    ++rank;
+  }
+  return rank;
+}
+
+/**
+ * Samples an n x k matrix of the given rank. The rank is computed without m4ri's allocator and
+ * the randomness is taken from aes_prng, so that multiple matrices can be sampled in parallel.
+ */
+static mzd_t* mzd_sample_matrix_word(rci_t n, rci_t k, rci_t rank, bool with_xor,
+                                     aes_prng_t* aes_prng) {
+  mzd_t* A = mzd_local_init(n, k);
+  mzd_t* B = mzd_local_init(n, k);
   do {
-    mzd_randomize_ssl(A);
+    mzd_randomize_prng(B, aes_prng);
     if (with_xor) {
       for (rci_t i = 0; i < n; i++) {
-        mzd_xor_bits(A, n - i - 1, (k + i + 1) % k, 1, 1);
+        mzd_xor_bits(B, n - i - 1, (k + i + 1) % k, 1, 1);
       }
     }
-    mzd_local_copy(B, A);
-  } while (mzd_echelonize(A, 0) != rank);
-  mzd_free(A);
+    mzd_local_copy(A, B);
+  } while (mzd_local_rank(A, NULL) != rank);
+  mzd_local_free(A);
   return B;
 };
 
@@ -49,26 +110,494 @@ static mzd_t* mzd_sample_matrix_word(rci_t n, rci_t k, rci_t rank, bool with_xor
  *
  * \param n the blocksize
  */
-static mzd_t* mzd_sample_lmatrix(rci_t n) {
-  return mzd_sample_matrix_word(n, n, n, false);
+static mzd_t* mzd_sample_lmatrix(rci_t n, aes_prng_t* aes_prng) {
+  return mzd_sample_matrix_word(n, n, n, false, aes_prng);
 }
 
 /**
  * Samples the K matrix for the LowMC instance
  * \param n the blocksize
  */
-static mzd_t* mzd_sample_kmatrix(rci_t n, rci_t k) {
-  return mzd_sample_matrix_word(n, k, MIN(n, k), true);
+static mzd_t* mzd_sample_kmatrix(rci_t n, rci_t k, aes_prng_t* aes_prng) {
+  return mzd_sample_matrix_word(n, k, MIN(n, k), true, aes_prng);
 }
 
-lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k) {
+/**
+ * Samples the matrices of the LowMC instance from seed. The seed keys an AES-128-CTR stream (see
+ * aes_prng_t) whose first 16 * (r + 1) bytes are the seeds of the rounds followed by the seed of
+ * the initial key matrix. Each of them keys another stream from which the L matrix, the K matrix
+ * and the constant of the round, or the initial key matrix, are sampled in this order. Hence the
+ * instance only depends on the seed and not on the order in which the rounds are generated.
+ */
+typedef struct {
+  lowmc_t* lowmc;
+  unsigned char (*seeds)[PRNG_KEYSIZE];
+} lowmc_sample_chunk_t;
+
+static void lowmc_sample_chunk(void* arg, size_t begin, size_t end) {
+  lowmc_sample_chunk_t const* chunk = arg;
+  lowmc_t* lowmc                    = chunk->lowmc;
+  const rci_t n                     = lowmc->n;
+  const rci_t k                     = lowmc->k;
+
+  for (size_t i = begin; i < end; ++i) {
+    aes_prng_t round_prng;
+    aes_prng_init(&round_prng, chunk->seeds[i]);
+    if (i == lowmc->r) {
+      lowmc->k0_matrix = mzd_sample_kmatrix(k, n, &round_prng);
+    } else {
+      lowmc_round_t* round = &lowmc->rounds[i];
+      round->l_matrix      = mzd_sample_lmatrix(n, &round_prng);
+      round->k_matrix      = mzd_sample_kmatrix(k, n, &round_prng);
+      round->constant      = mzd_init_random_vector_prng(n, &round_prng);
+    }
+    aes_prng_clear(&round_prng);
+  }
+}
+
+static void lowmc_sample_matrices(lowmc_t* lowmc, const unsigned char seed[PRNG_KEYSIZE]) {
+  const unsigned int r = lowmc->r;
+
+  unsigned char(*seeds)[PRNG_KEYSIZE] = malloc((r + 1) * sizeof(*seeds));
+  aes_prng_t aes_prng;
+  aes_prng_init(&aes_prng, seed);
+  aes_prng_get_randomness(&aes_prng, seeds[0], (r + 1) * sizeof(*seeds));
+  aes_prng_clear(&aes_prng);
+
+  lowmc_sample_chunk_t chunk = {lowmc, seeds};
+  thread_pool_for(r + 1, 1, lowmc_sample_chunk, &chunk);
+
+  free(seeds);
+}
+
+/**
+ * Folding requires lower words and keeps copies of them in vectors of at most MZD_FIXED_MAX_WIDTH
+ * words, see lowmc_linear_layer. For n <= 256, a row of the lookup tables fits into a single
+ * SSE2 or AVX2 register and the products cost one load per lookup, so folding only adds work.
+ */
+static bool lowmc_folding_supported(size_t m, size_t n) {
+  return (n - 3 * m) / (sizeof(word) * 8) && n > 256 &&
+         n <= MZD_FIXED_MAX_WIDTH * sizeof(word) * 8;
+}
+
+#ifdef REDUCED_ROUND_KEYS
+/**
+ * Computes the matrices of the reduced round keys. Let A_0 be the matrix of the initial key
+ * addition. The S-box bits of A_i are added before the S-box layer of round i, whereas the
+ * remaining bits pass the S-box layer unchanged. They are hence moved through the linear layer into
+ * the key addition of round i: A_{i + 1} = lin(A_i) * L_i + K_i. A_r is added after the last round.
+ */
+static void lowmc_reduced_round_keys_layout(lowmc_t* lowmc) {
+  lowmc->rrk_word  = (lowmc->n - 3 * lowmc->m) / (sizeof(word) * 8);
+  lowmc->rrk_words = (lowmc->n - 1) / (sizeof(word) * 8) - lowmc->rrk_word + 1;
+}
+
+// Rows of the reduced round keys per chunk distributed over the thread pool
+#define LOWMC_RRK_CHUNK_ROWS 16
+
+typedef struct {
+  lowmc_t const* lowmc;
+  mzd_t* A;
+  mzd_t* rrk;
+  word const* lin_bits;
+  word const* sbox_bits;
+} lowmc_rrk_chunk_t;
+
+/**
+ * Moves the rows begin <= j < end of A through all rounds and stores their S-box bits in rrk.
+ */
+static void lowmc_rrk_chunk(void* arg, size_t begin, size_t end) {
+  lowmc_rrk_chunk_t const* chunk = arg;
+  lowmc_t const* lowmc           = chunk->lowmc;
+  const unsigned int first       = lowmc->rrk_word;
+  const unsigned int words       = lowmc->rrk_words;
+  const unsigned int width       = chunk->A->width;
+
+  mzd_t* lin        = mzd_local_init(1, lowmc->n);
+  mzd_t* t          = mzd_local_init(1, lowmc->n);
+  word* lin_row     = FIRST_ROW(lin);
+  word const* t_row = CONST_FIRST_ROW(t);
+
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    lowmc_round_t const* round = &lowmc->rounds[i];
+    for (size_t j = begin; j < end; ++j) {
+      word* row         = chunk->A->rows[j];
+      word* rrk_row     = chunk->rrk->rows[j] + i * words;
+      word const* k_row = round->k_matrix->rows[j];
+
+      for (unsigned int w = 0; w < words; ++w) {
+        rrk_row[w] = row[first + w] & chunk->sbox_bits[first + w];
+      }
+      for (unsigned int w = 0; w < width; ++w) {
+        lin_row[w] = row[w] & chunk->lin_bits[w];
+      }
+      mzd_mul_v(t, lin, round->l_matrix);
+      for (unsigned int w = 0; w < width; ++w) {
+        row[w] = t_row[w] ^ k_row[w];
+      }
+    }
+  }
+
+  mzd_local_free(t);
+  mzd_local_free(lin);
+}
+
+static void lowmc_precompute_reduced_round_keys(lowmc_t* lowmc) {
+  lowmc_reduced_round_keys_layout(lowmc);
+
+  const rci_t n              = lowmc->n;
+  const rci_t k              = lowmc->k;
+  const unsigned int width   = lowmc->k0_matrix->width;
+  const unsigned int rrk_len = lowmc->r * lowmc->rrk_words * sizeof(word) * 8;
+
+  // the columns are padded to a multiple of 256 to allow the SIMD kernels
+  mzd_t* rrk = mzd_local_init(k, (rrk_len + 255) & ~255);
+  mzd_t* A   = mzd_local_init(k, n);
+  for (rci_t j = 0; j < k; ++j) {
+    memcpy(A->rows[j], lowmc->k0_matrix->rows[j], width * sizeof(word));
+  }
+
+  // the S-box bits are the union of the bits selected by the three masks
+  mzd_t* sbox_mask = mzd_local_init(1, n);
+  mzd_xor(sbox_mask, lowmc->mask.x0, lowmc->mask.x1);
+  mzd_xor(sbox_mask, sbox_mask, lowmc->mask.x2);
+
+  // the rows are independent of each other and are processed in parallel
+  lowmc_rrk_chunk_t chunk = {lowmc, A, rrk, CONST_FIRST_ROW(lowmc->mask.mask),
+                             CONST_FIRST_ROW(sbox_mask)};
+  thread_pool_for(k, LOWMC_RRK_CHUNK_ROWS, lowmc_rrk_chunk, &chunk);
+  mzd_local_free(sbox_mask);
+
+  lowmc->rrk_matrix = rrk;
+  lowmc->kf_matrix  = A;
+}
+
+/**
+ * Computes the inverse of the square matrix A in inv. The rows of A are reduced to the identity in
+ * place. The rows are swapped by value, since the kernels do not use the row pointers.
+ *
+ * \return false if A is singular
+ */
+static bool mzd_local_inverse(mzd_t* inv, mzd_t* A) {
+  const rci_t n     = A->nrows;
+  const rci_t width = A->width;
+
+  for (rci_t i = 0; i < n; ++i) {
+    memset(inv->rows[i], 0, width * sizeof(word));
+    mzd_write_bit(inv, i, i, 1);
+  }
+
+  for (rci_t c = 0; c < n; ++c) {
+    const rci_t w   = c / m4ri_radix;
+    const word mask = m4ri_one << (c % m4ri_radix);
+    rci_t pivot     = c;
+    while (pivot < n && !(A->rows[pivot][w] & mask)) {
+      ++pivot;
+    }
+    if (pivot == n) {
+      return false;
+    }
+
+    for (rci_t j = 0; pivot != c && j < width; ++j) {
+      const word a        = A->rows[pivot][j];
+      const word b        = inv->rows[pivot][j];
+      A->rows[pivot][j]   = A->rows[c][j];
+      inv->rows[pivot][j] = inv->rows[c][j];
+      A->rows[c][j]       = a;
+      inv->rows[c][j]     = b;
+    }
+    for (rci_t i = 0; i < n; ++i) {
+      if (i != c && (A->rows[i][w] & mask)) {
+        for (rci_t j = 0; j < width; ++j) {
+          A->rows[i][j] ^= A->rows[c][j];
+          inv->rows[i][j] ^= inv->rows[c][j];
+        }
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * Computes C = A * B row by row. t and u are vectors with the number of columns of A and B.
+ */
+static void mzd_local_mul_rows(mzd_t* C, mzd_t const* A, mzd_t const* B, mzd_t* t, mzd_t* u) {
+  for (rci_t j = 0; j < A->nrows; ++j) {
+    memcpy(FIRST_ROW(t), A->rows[j], A->width * sizeof(word));
+    mzd_mul_v(u, t, B);
+    memcpy(C->rows[j], CONST_FIRST_ROW(u), C->width * sizeof(word));
+  }
+}
+
+static void lowmc_free_folded_linear_layers(lowmc_t* lowmc) {
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    lowmc_round_t* round = &lowmc->rounds[i];
+#ifdef NOSCR
+    mzd_local_free(round->lower_lookup);
+    mzd_local_free(round->upper_lookup);
+    round->lower_lookup = NULL;
+    round->upper_lookup = NULL;
+#endif
+    mzd_local_free(round->lower_matrix);
+    mzd_local_free(round->upper_matrix);
+    mzd_local_free(round->folded_constant);
+    round->lower_matrix    = NULL;
+    round->upper_matrix    = NULL;
+    round->folded_constant = NULL;
+  }
+#ifdef NOSCR
+  mzd_local_free(lowmc->lf_lookup);
+  lowmc->lf_lookup = NULL;
+#endif
+  mzd_local_free(lowmc->lf_matrix);
+  lowmc->lf_matrix = NULL;
+  lowmc->folded    = false;
+}
+
+/**
+ * Computes the folded linear layers, see lowmc_t. Let D_i map the state of round i in the basis
+ * B_i to the standard basis. The linear layer of round i then is M_i = D_i L_i D_{i + 1}^-1 and the
+ * constant c_i D_{i + 1}^-1. The rows of D_{i + 1} for the lower words are those of D_i L_i
+ * restricted to the linear bits, so that M_i maps the lower words to themselves. They are completed
+ * to a basis of the linear bits by unit vectors, which fails if the rows are linearly dependent.
+ * The S-box bits are kept, i.e. D_{i + 1} is the identity on them. D_r is the identity.
+ *
+ * \return false if the linear layers cannot be folded
+ */
+static bool lowmc_precompute_folded_linear_layers(lowmc_t* lowmc) {
+  if (!lowmc_folding_supported(lowmc->m, lowmc->n)) {
+    return false;
+  }
+
+  const rci_t n            = lowmc->n;
+  const rci_t lin          = n - 3 * lowmc->m;
+  const unsigned int first = lowmc->rrk_word;
+  const rci_t lower        = first * m4ri_radix;
+  const rci_t width        = lowmc->mask.mask->width;
+  word const* lin_bits     = CONST_FIRST_ROW(lowmc->mask.mask);
+
+  mzd_t* D      = mzd_local_init(n, n);
+  mzd_t* next_D = mzd_local_init(n, n);
+  mzd_t* inv_D  = mzd_local_init(n, n);
+  mzd_t* M      = mzd_local_init(n, n);
+  mzd_t* R      = mzd_local_init(lower, n);
+  mzd_t* pivots = mzd_local_init(1, n);
+  mzd_t* t      = mzd_local_init(1, n);
+  mzd_t* u      = mzd_local_init(1, n);
+  for (rci_t j = 0; j < n; ++j) {
+    mzd_write_bit(D, j, j, 1);
+  }
+
+  bool ret = true;
+  for (unsigned int i = 0; ret && i < lowmc->r; ++i) {
+    lowmc_round_t* round = &lowmc->rounds[i];
+
+    // D_i L_i
+    mzd_local_mul_rows(M, D, round->l_matrix, t, u);
+    if (i + 1 == lowmc->r) {
+      lowmc->lf_matrix       = mzd_local_copy(NULL, M);
+      round->folded_constant = mzd_local_copy(NULL, round->constant);
+      break;
+    }
+
+    mzd_local_clear(pivots);
+    for (rci_t j = 0; j < lower; ++j) {
+      for (rci_t w = 0; w < width; ++w) {
+        R->rows[j][w] = M->rows[j][w] & lin_bits[w];
+      }
+      memcpy(next_D->rows[j], R->rows[j], width * sizeof(word));
+    }
+    ret = mzd_local_rank(R, pivots) == lower;
+
+    rci_t row = lower;
+    for (rci_t c = 0; ret && c < n; ++c) {
+      if (c >= lin || !mzd_read_bit(pivots, 0, c)) {
+        memset(next_D->rows[row], 0, width * sizeof(word));
+        mzd_write_bit(next_D, row++, c, 1);
+      }
+    }
+
+    // D_i L_i D_{i + 1}^-1, the inverse reduces its input, so D_i is used as temporary
+    ret = ret && mzd_local_inverse(inv_D, mzd_local_copy(D, next_D));
+    if (ret) {
+      mzd_local_mul_rows(D, M, inv_D, t, u);
+
+      round->lower_matrix    = mzd_local_init(lower, n - lower);
+      round->upper_matrix    = mzd_local_init(n - lower, n);
+      round->folded_constant = mzd_local_init(1, n);
+      for (rci_t j = 0; j < lower; ++j) {
+        memcpy(round->lower_matrix->rows[j], D->rows[j] + first,
+               (width - first) * sizeof(word));
+      }
+      for (rci_t j = lower; j < n; ++j) {
+        memcpy(round->upper_matrix->rows[j - lower], D->rows[j], width * sizeof(word));
+      }
+      mzd_mul_v(round->folded_constant, round->constant, inv_D);
+      mzd_local_copy(D, next_D);
+    }
+  }
+
+  mzd_local_free(u);
+  mzd_local_free(t);
+  mzd_local_free(pivots);
+  mzd_local_free(R);
+  mzd_local_free(M);
+  mzd_local_free(inv_D);
+  mzd_local_free(next_D);
+  mzd_local_free(D);
+
+  if (!ret) {
+    lowmc_free_folded_linear_layers(lowmc);
+  }
+  lowmc->folded = ret;
+  return ret;
+}
+#endif
+
+#ifdef NOSCR
+#ifdef REDUCED_ROUND_KEYS
+static void lowmc_precompute_reduced_lookups(lowmc_t* lowmc, unsigned int bits) {
+  mzd_local_free(lowmc->rrk_lookup);
+  mzd_local_free(lowmc->kf_lookup);
+  lowmc->rrk_lookup = mzd_precompute_matrix_lookup(lowmc->rrk_matrix, bits);
+  lowmc->kf_lookup  = mzd_precompute_matrix_lookup(lowmc->kf_matrix, bits);
+
+  if (!lowmc->folded) {
+    return;
+  }
+
+  for (unsigned int i = 0; i + 1 < lowmc->r; ++i) {
+    lowmc_round_t* round = &lowmc->rounds[i];
+    mzd_local_free(round->lower_lookup);
+    mzd_local_free(round->upper_lookup);
+    round->lower_lookup = mzd_precompute_matrix_lookup(round->lower_matrix, bits);
+    round->upper_lookup = mzd_precompute_matrix_lookup(round->upper_matrix, bits);
+  }
+  mzd_local_free(lowmc->lf_lookup);
+  lowmc->lf_lookup = mzd_precompute_matrix_lookup(lowmc->lf_matrix, bits);
+}
+#endif
+
+static void lowmc_free_lookups(lowmc_t* lowmc) {
+  for (unsigned int i = 0; i < lowmc->r; ++i) {
+    mzd_local_free(lowmc->rounds[i].k_lookup);
+    mzd_local_free(lowmc->rounds[i].l_lookup);
+    lowmc->rounds[i].k_lookup = NULL;
+    lowmc->rounds[i].l_lookup = NULL;
+  }
+  mzd_local_free(lowmc->k0_lookup);
+  lowmc->k0_lookup = NULL;
+}
+
+typedef struct {
+  lowmc_t* lowmc;
+  unsigned int bits;
+} lowmc_lookup_chunk_t;
+
+static void lowmc_lookup_chunk(void* arg, size_t begin, size_t end) {
+  lowmc_lookup_chunk_t const* chunk = arg;
+
+  for (size_t i = begin; i < end; ++i) {
+    lowmc_round_t* round = &chunk->lowmc->rounds[i];
+    round->l_lookup      = mzd_precompute_matrix_lookup(round->l_matrix, chunk->bits);
+    round->k_lookup      = mzd_precompute_matrix_lookup(round->k_matrix, chunk->bits);
+  }
+}
+
+void lowmc_precompute_lookups(lowmc_t* lowmc, unsigned int bits) {
+  lowmc_free_lookups(lowmc);
+
+  lowmc->k0_lookup = mzd_precompute_matrix_lookup(lowmc->k0_matrix, bits);
+
+  lowmc_lookup_chunk_t chunk = {lowmc, bits};
+  thread_pool_for(lowmc->r, 1, lowmc_lookup_chunk, &chunk);
+#ifdef REDUCED_ROUND_KEYS
+  lowmc_precompute_reduced_lookups(lowmc, bits);
+#endif
+  lowmc_select_kernels(lowmc);
+}
+
+static uint64_t lowmc_calibration_time(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/**
+ * Measures LowMC encryptions with 4 and 8 bit lookup tables and returns the faster chunk width.
+ * Small tables fit into L1, but require twice the number of lookups. The 8 bit tables of all
+ * rounds quickly outgrow L2, which makes the smaller tables the better choice for large n.
+ *
+ * When signing, the views, the random tapes and the hashing evict the tables between the
+ * repetitions. The caches are hence flushed before each encryption, otherwise the measurement
+ * favors the large tables.
+ */
+static unsigned int lowmc_calibrate_lookup_bits(lowmc_t* lowmc) {
+  static const unsigned int candidates[] = {8, 4};
+  static const unsigned int passes       = 4;
+  static const unsigned int encryptions  = 8;
+
+  // larger than the L2 cache of current CPUs
+  static const size_t evict_size = 8 << 20;
+
+  volatile unsigned char* evict = calloc(evict_size, 1);
+  if (!evict) {
+    return candidates[0];
+  }
+
+  lowmc_key_t* key = lowmc_keygen(lowmc);
+  mzd_t* p         = mzd_init_random_vector(lowmc->n);
+
+  unsigned int best_bits = candidates[0];
+  uint64_t best_time     = UINT64_MAX;
+  for (unsigned int c = 0; c < sizeof(candidates) / sizeof(candidates[0]); ++c) {
+    lowmc_precompute_lookups(lowmc, candidates[c]);
+
+    // the first pass is discarded
+    uint64_t min_time = UINT64_MAX;
+    for (unsigned int pass = 0; pass <= passes; ++pass) {
+      uint64_t elapsed = 0;
+      for (unsigned int e = 0; e < encryptions; ++e) {
+        for (size_t i = 0; i < evict_size; i += 64) {
+          ++evict[i];
+        }
+
+        const uint64_t start = lowmc_calibration_time();
+        mzd_local_free(lowmc_call(lowmc, key, p));
+        elapsed += lowmc_calibration_time() - start;
+      }
+      if (pass && elapsed < min_time) {
+        min_time = elapsed;
+      }
+    }
+
+    if (min_time < best_time) {
+      best_time = min_time;
+      best_bits = candidates[c];
+    }
+  }
+
+  mzd_local_free(p);
+  lowmc_key_free(key);
+  free((void*)evict);
+  return best_bits;
+}
+#endif
+
+/**
+ * Reads the instance from its file or generates it from seed. If from_seed is set, the file is
+ * named after the seed, otherwise any instance with the same parameters is used.
+ */
+static lowmc_t* lowmc_init_ex(size_t m, size_t n, size_t r, size_t k,
+                              const unsigned char seed[PRNG_KEYSIZE], bool from_seed) {
   if (n - 3 * m < 2) {
     printf("Bitsliced implementation requires in->ncols - 3 * m >= 2\n");
     return NULL;
   }
 
-  lowmc_t* ret = readFile(m, n, r, k);
+  lowmc_t* ret = readFile(m, n, r, k, from_seed ? seed : NULL);
   if (ret) {
+    lowmc_select_kernels(ret);
     return ret;
   }
 
@@ -77,142 +606,600 @@ lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k) {
   lowmc->n       = n;
   lowmc->r       = r;
   lowmc->k       = k;
-
-  lowmc->k0_matrix = mzd_sample_kmatrix(k, n);
-#ifdef NOSCR
-  lowmc->k0_lookup = mzd_precompute_matrix_lookup(lowmc->k0_matrix);
-#endif
+  memcpy(lowmc->seed, seed, sizeof(lowmc->seed));
 
   lowmc->rounds = calloc(sizeof(lowmc_round_t), r);
-  for (unsigned int i = 0; i < r; ++i) {
-    lowmc->rounds[i].l_matrix = mzd_sample_lmatrix(n);
-    lowmc->rounds[i].k_matrix = mzd_sample_kmatrix(k, n);
-    lowmc->rounds[i].constant = mzd_init_random_vector(n);
-
-#ifdef NOSCR
-    lowmc->rounds[i].l_lookup = mzd_precompute_matrix_lookup(lowmc->rounds[i].l_matrix);
-    lowmc->rounds[i].k_lookup = mzd_precompute_matrix_lookup(lowmc->rounds[i].k_matrix);
-#endif
-  }
+  lowmc_sample_matrices(lowmc, seed);
 
   if (!prepare_masks(&lowmc->mask, n, m)) {
     lowmc_free(lowmc);
     return NULL;
   }
 
-  writeFile(lowmc);
+#ifdef REDUCED_ROUND_KEYS
+  lowmc_precompute_reduced_round_keys(lowmc);
+  lowmc_precompute_folded_linear_layers(lowmc);
+#endif
+#ifdef NOSCR
+  lowmc_precompute_lookups(lowmc, lowmc_calibrate_lookup_bits(lowmc));
+#endif
+
+  writeFile(lowmc, from_seed);
+  lowmc_select_kernels(lowmc);
 
   return lowmc;
 }
 
-lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k) {
+lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k) {
+  unsigned char seed[PRNG_KEYSIZE];
+  rand_bytes(seed, sizeof(seed));
 
-  lowmc_t* lowmc  = NULL;
-  char* file_name = calloc(20, sizeof(char));
-  sprintf(file_name, "%zu-%zu-%zu-%zu", m, n, r, k);
-  FILE* file = fopen(file_name, "r+");
-  free(file_name);
-  if (file) {
-    lowmc = calloc(1, sizeof(lowmc_t));
+  return lowmc_init_ex(m, n, r, k, seed, false);
+}
 
-    int ret = 0;
+lowmc_t* lowmc_init_from_seed(size_t m, size_t n, size_t r, size_t k,
+                              const unsigned char seed[PRNG_KEYSIZE]) {
+  return lowmc_init_ex(m, n, r, k, seed, true);
+}
 
-    ret = fread(&lowmc->m, sizeof(lowmc->m), 1, file);
-    ret += fread(&lowmc->n, sizeof(lowmc->n), 1, file);
-    ret += fread(&lowmc->r, sizeof(lowmc->r), 1, file);
-    ret += fread(&lowmc->k, sizeof(lowmc->k), 1, file);
+void lowmc_select_kernels(lowmc_t* lowmc) {
+  const rci_t n     = (rci_t)lowmc->n;
+  const rci_t k     = (rci_t)lowmc->k;
+  const rci_t radix = (rci_t)(sizeof(word) * 8);
+  // the lookup tables are multiplied with the state and the key, so SIMD kernels can only be used
+  // if both n and k are multiples of the word size. Otherwise, vcols is the one that is not.
+  const rci_t vcols = (n % radix == 0 && k % radix == 0) ? n : (n % radix ? n : k);
+#ifdef NOSCR
+  const unsigned int bits = mzd_lookup_bits(lowmc->k0_lookup, k);
+#else
+  const unsigned int bits = 8;
+#endif
 
-    if (lowmc->m != m || lowmc->n != n || lowmc->r != r || lowmc->k != k) {
-      printf("Error when reading file!\n");
-      return NULL;
-    }
+  lowmc->kernels.sbox      = lowmc_sbox_select(n);
+  lowmc->kernels.mul_vl    = mzd_mul_vl_select(n, vcols, bits);
+  lowmc->kernels.addmul_vl = mzd_addmul_vl_select(n, vcols, bits);
+#ifdef REDUCED_ROUND_KEYS
+  lowmc->kernels.mul_vl_rrk = mzd_mul_vl_select(lowmc->rrk_matrix->ncols, k, bits);
+  if (lowmc->folded) {
+    const rci_t lower           = lowmc->rrk_word * sizeof(word) * 8;
+    lowmc->kernels.mul_vl_lower = mzd_mul_vl_select(n - lower, lower, bits);
+    lowmc->kernels.mul_vl_upper = mzd_mul_vl_select(n, n - lower, bits);
+  }
+#endif
+  mpc_lowmc_select_kernels(&lowmc->kernels, n, bits);
+}
+
+/**
+ * Instance files start with a header followed by an index of all matrices. Each entry of the index
+ * points to the mzd_t of a matrix which is followed by the rows in the layout of mzd_local_init.
+ * The file is mapped and the matrices are used in place, so that processes using the same instance
+ * share the pages of the file. Only the row pointers depend on the address of the mapping. They
+ * are set up before the mapping is made read-only, so the pages holding the mzd_t instances are
+ * copied. The rows of matrices spanning at least one page are hence aligned to pages and the mzd_t
+ * instances are stored in the preceding, otherwise unused page.
+ */
+#define LOWMC_FILE_MAGIC "LOWMCINS"
+#define LOWMC_FILE_VERSION 4
+#define LOWMC_FILE_PAGE_SIZE 4096
+// size of the mzd_t preceding the rows, see FIRST_ROW
+#define LOWMC_FILE_MZD_SIZE 64
+
+typedef struct {
+  char magic[8];
+  uint32_t version;
+  // configuration of the writer, files of a different configuration are ignored
+  uint32_t word_size;
+  uint32_t lookup_bits;
+  uint32_t reduced_round_keys;
+  // whether the instance has folded linear layers, see lowmc_t
+  uint32_t folded;
+  uint32_t reserved;
+  uint64_t m;
+  uint64_t n;
+  uint64_t r;
+  uint64_t k;
+  uint64_t matrices;
+  uint64_t size;
+  // seed the instance was sampled from
+  unsigned char seed[PRNG_KEYSIZE];
+  // SHA-256 of the header with a cleared digest followed by the index and the rows of all
+  // matrices in the order of the index
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+} lowmc_file_header_t;
+
+typedef struct {
+  int32_t nrows;
+  int32_t ncols;
+  // offset of the mzd_t
+  uint64_t offset;
+} lowmc_file_entry_t;
 
-    lowmc->mask.x0   = readMZD_TStructFromFile(file);
-    lowmc->mask.x1   = readMZD_TStructFromFile(file);
-    lowmc->mask.x2   = readMZD_TStructFromFile(file);
-    lowmc->mask.mask = readMZD_TStructFromFile(file);
+/**
+ * Collects the locations of all matrices of the instance in the order they are stored in the file.
+ * lowmc->rounds needs to be allocated.
+ */
+static size_t lowmc_file_matrices(lowmc_t* lowmc, mzd_t** matrices[]) {
+  size_t count = 0;
 
-    lowmc->k0_matrix = readMZD_TStructFromFile(file);
+  matrices[count++] = &lowmc->mask.x0;
+  matrices[count++] = &lowmc->mask.x1;
+  matrices[count++] = &lowmc->mask.x2;
+  matrices[count++] = &lowmc->mask.mask;
+  matrices[count++] = &lowmc->k0_matrix;
 #ifdef NOSCR
-    lowmc->k0_lookup = readMZD_TStructFromFile(file);
+  matrices[count++] = &lowmc->k0_lookup;
 #endif
-    lowmc->rounds = calloc(r, sizeof(lowmc_round_t));
+  for (size_t i = 0; i < lowmc->r; ++i) {
+    matrices[count++] = &lowmc->rounds[i].k_matrix;
+    matrices[count++] = &lowmc->rounds[i].l_matrix;
+    matrices[count++] = &lowmc->rounds[i].constant;
+#ifdef NOSCR
+    matrices[count++] = &lowmc->rounds[i].k_lookup;
+    matrices[count++] = &lowmc->rounds[i].l_lookup;
+#endif
+  }
+#ifdef REDUCED_ROUND_KEYS
+  matrices[count++] = &lowmc->rrk_matrix;
+  matrices[count++] = &lowmc->kf_matrix;
+#ifdef NOSCR
+  matrices[count++] = &lowmc->rrk_lookup;
+  matrices[count++] = &lowmc->kf_lookup;
+#endif
+  if (lowmc->folded) {
     for (size_t i = 0; i < lowmc->r; ++i) {
-      lowmc->rounds[i].k_matrix = readMZD_TStructFromFile(file);
-      lowmc->rounds[i].l_matrix = readMZD_TStructFromFile(file);
-      lowmc->rounds[i].constant = readMZD_TStructFromFile(file);
+      if (i + 1 < lowmc->r) {
+        matrices[count++] = &lowmc->rounds[i].lower_matrix;
+        matrices[count++] = &lowmc->rounds[i].upper_matrix;
+      }
+      matrices[count++] = &lowmc->rounds[i].folded_constant;
 #ifdef NOSCR
-      lowmc->rounds[i].k_lookup = readMZD_TStructFromFile(file);
-      lowmc->rounds[i].l_lookup = readMZD_TStructFromFile(file);
+      if (i + 1 < lowmc->r) {
+        matrices[count++] = &lowmc->rounds[i].lower_lookup;
+        matrices[count++] = &lowmc->rounds[i].upper_lookup;
+      }
 #endif
     }
-    fclose(file);
+    matrices[count++] = &lowmc->lf_matrix;
+#ifdef NOSCR
+    matrices[count++] = &lowmc->lf_lookup;
+#endif
   }
+#endif
 
-  return lowmc;
+  return count;
 }
 
-bool writeFile(lowmc_t* lowmc) {
-
-  char* file_name = calloc(20, sizeof(char));
-  sprintf(file_name, "%zu-%zu-%zu-%zu", lowmc->m, lowmc->n, lowmc->r, lowmc->k);
-  FILE* file = fopen(file_name, "w");
-  free(file_name);
-  if (file) {
-    fwrite(&lowmc->m, sizeof(lowmc->m), 1, file);
-    fwrite(&lowmc->n, sizeof(lowmc->n), 1, file);
-    fwrite(&lowmc->r, sizeof(lowmc->r), 1, file);
-    fwrite(&lowmc->k, sizeof(lowmc->k), 1, file);
-
-    writeMZD_TStructToFile(lowmc->mask.x0, file);
-    writeMZD_TStructToFile(lowmc->mask.x1, file);
-    writeMZD_TStructToFile(lowmc->mask.x2, file);
-    writeMZD_TStructToFile(lowmc->mask.mask, file);
+static void lowmc_file_set_dimensions(lowmc_file_entry_t* entry, size_t nrows, size_t ncols) {
+  entry->nrows = nrows;
+  entry->ncols = ncols;
+}
 
-    writeMZD_TStructToFile(lowmc->k0_matrix, file);
+/**
+ * Computes the dimensions of the matrices collected by lowmc_file_matrices in the same order. bits
+ * is the number of bits the lookup tables are computed for.
+ */
+static size_t lowmc_file_dimensions(size_t m, size_t n, size_t r, size_t k, unsigned int bits,
+                                    bool folded, lowmc_file_entry_t dims[]) {
+  size_t count = 0;
+#ifdef NOSCR
+  // see mzd_precompute_matrix_lookup
+  const size_t lookup = (1 << bits) / bits;
+#else
+  (void)bits;
+#endif
 
+  for (unsigned int i = 0; i < 4; ++i) {
+    lowmc_file_set_dimensions(&dims[count++], 1, n);
+  }
+  lowmc_file_set_dimensions(&dims[count++], k, n);
 #ifdef NOSCR
-    writeMZD_TStructToFile(lowmc->k0_lookup, file);
+  lowmc_file_set_dimensions(&dims[count++], lookup * k, n);
 #endif
-    for (size_t i = 0; i < lowmc->r; ++i) {
-      writeMZD_TStructToFile(lowmc->rounds[i].k_matrix, file);
-      writeMZD_TStructToFile(lowmc->rounds[i].l_matrix, file);
-      writeMZD_TStructToFile(lowmc->rounds[i].constant, file);
+  for (size_t i = 0; i < r; ++i) {
+    lowmc_file_set_dimensions(&dims[count++], k, n);
+    lowmc_file_set_dimensions(&dims[count++], n, n);
+    lowmc_file_set_dimensions(&dims[count++], 1, n);
+#ifdef NOSCR
+    lowmc_file_set_dimensions(&dims[count++], lookup * k, n);
+    lowmc_file_set_dimensions(&dims[count++], lookup * n, n);
+#endif
+  }
+#ifdef REDUCED_ROUND_KEYS
+  // see lowmc_precompute_reduced_round_keys
+  const size_t rrk_words = (n - 1) / (sizeof(word) * 8) - (n - 3 * m) / (sizeof(word) * 8) + 1;
+  const size_t rrk_cols  = (r * rrk_words * sizeof(word) * 8 + 255) & ~255;
+  lowmc_file_set_dimensions(&dims[count++], k, rrk_cols);
+  lowmc_file_set_dimensions(&dims[count++], k, n);
+#ifdef NOSCR
+  lowmc_file_set_dimensions(&dims[count++], lookup * k, rrk_cols);
+  lowmc_file_set_dimensions(&dims[count++], lookup * k, n);
+#endif
+  if (folded) {
+    // see lowmc_precompute_folded_linear_layers
+    const size_t lower = (n - 3 * m) / (sizeof(word) * 8) * sizeof(word) * 8;
+    for (size_t i = 0; i < r; ++i) {
+      if (i + 1 < r) {
+        lowmc_file_set_dimensions(&dims[count++], lower, n - lower);
+        lowmc_file_set_dimensions(&dims[count++], n - lower, n);
+      }
+      lowmc_file_set_dimensions(&dims[count++], 1, n);
 #ifdef NOSCR
-      writeMZD_TStructToFile(lowmc->rounds[i].k_lookup, file);
-      writeMZD_TStructToFile(lowmc->rounds[i].l_lookup, file);
+      if (i + 1 < r) {
+        lowmc_file_set_dimensions(&dims[count++], lookup * lower, n - lower);
+        lowmc_file_set_dimensions(&dims[count++], lookup * (n - lower), n);
+      }
+#endif
+    }
+    lowmc_file_set_dimensions(&dims[count++], n, n);
+#ifdef NOSCR
+    lowmc_file_set_dimensions(&dims[count++], lookup * n, n);
+#endif
+  }
+#else
+  (void)m;
+  (void)folded;
+#endif
+
+  return count;
+}
+
+static size_t lowmc_file_max_matrices(size_t r) {
+  return 12 + 10 * r;
+}
+
+static size_t lowmc_file_rows_size(rci_t nrows, rci_t ncols) {
+  return (size_t)nrows * mzd_local_rowstride(ncols) * sizeof(word);
+}
+
+static size_t lowmc_file_align(size_t offset, size_t alignment) {
+  return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+// files of instances from lowmc_init_from_seed are named after their seed
+static bool lowmc_file_name(char* file_name, size_t size, size_t m, size_t n, size_t r, size_t k,
+                            const unsigned char* seed) {
+  int len = snprintf(file_name, size, "%zu-%zu-%zu-%zu", m, n, r, k);
+  for (unsigned int i = 0; seed && i < PRNG_KEYSIZE && len >= 0 && (size_t)len < size; ++i) {
+    len += snprintf(file_name + len, size - len, i ? "%02x" : "-%02x", seed[i]);
+  }
+  return len >= 0 && (size_t)len < size;
+}
+
+static void lowmc_file_init_header(lowmc_file_header_t* header, size_t m, size_t n, size_t r,
+                                   size_t k) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, LOWMC_FILE_MAGIC, sizeof(header->magic));
+  header->version   = LOWMC_FILE_VERSION;
+  header->word_size = sizeof(word);
+#ifdef REDUCED_ROUND_KEYS
+  header->reduced_round_keys = 1;
 #endif
+  header->m = m;
+  header->n = n;
+  header->r = r;
+  header->k = k;
+}
+
+/**
+ * Starts the digest of a file with its header and index. The rows of the matrices are added by the
+ * caller.
+ */
+static void lowmc_file_digest_init(SHA256_CTX* ctx, lowmc_file_header_t const* header,
+                                   lowmc_file_entry_t const* index) {
+  lowmc_file_header_t tmp = *header;
+  memset(tmp.digest, 0, sizeof(tmp.digest));
+
+  SHA256_Init(ctx);
+  SHA256_Update(ctx, &tmp, sizeof(tmp));
+  SHA256_Update(ctx, index, header->matrices * sizeof(*index));
+}
+
+static void* lowmc_file_map(char const* file_name, size_t* size) {
+#ifdef HAVE_SYS_MMAN_H
+  const int fd = open(file_name, O_RDONLY);
+  if (fd == -1) {
+    return NULL;
+  }
+
+  struct stat st;
+  void* data = NULL;
+  if (!fstat(fd, &st) && st.st_size >= (off_t)sizeof(lowmc_file_header_t)) {
+    // mapped privately, so that the row pointers can be set up
+    data = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      data = NULL;
+    }
+    *size = st.st_size;
+  }
+  close(fd);
+  return data;
+#else
+  FILE* file = fopen(file_name, "rb");
+  if (!file) {
+    return NULL;
+  }
+
+  void* data = NULL;
+  if (!fseek(file, 0, SEEK_END)) {
+    const long file_size = ftell(file);
+    if (file_size >= (long)sizeof(lowmc_file_header_t) && !fseek(file, 0, SEEK_SET)) {
+      *size = file_size;
+      data  = aligned_alloc(LOWMC_FILE_PAGE_SIZE,
+                           lowmc_file_align(file_size, LOWMC_FILE_PAGE_SIZE));
+      if (data && fread(data, file_size, 1, file) != 1) {
+        free(data);
+        data = NULL;
+      }
     }
-    fclose(file);
+  }
+  fclose(file);
+  return data;
+#endif
+}
+
+static void lowmc_file_unmap(void* data, size_t size) {
+#ifdef HAVE_SYS_MMAN_H
+  munmap(data, size);
+#else
+  (void)size;
+  free(data);
+#endif
+}
+
+static int lowmc_file_entry_cmp(const void* a, const void* b) {
+  const uint64_t lhs = ((lowmc_file_entry_t const*)a)->offset;
+  const uint64_t rhs = ((lowmc_file_entry_t const*)b)->offset;
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static bool lowmc_file_check(lowmc_file_header_t const* header, lowmc_file_entry_t const* index,
+                             size_t size, size_t m, size_t n, size_t r, size_t k,
+                             const unsigned char* seed, size_t matrices) {
+  lowmc_file_header_t expected;
+  lowmc_file_init_header(&expected, m, n, r, k);
+
+  if (memcmp(header->magic, expected.magic, sizeof(expected.magic)) ||
+      header->version != expected.version || header->word_size != expected.word_size ||
+      header->reduced_round_keys != expected.reduced_round_keys || header->m != m ||
+      header->n != n || header->r != r || header->k != k || header->size != size ||
+      header->folded > expected.reduced_round_keys ||
+      (header->folded && !lowmc_folding_supported(m, n)) ||
+      header->matrices != matrices || (seed && memcmp(header->seed, seed, PRNG_KEYSIZE)) ||
+      sizeof(*header) + matrices * sizeof(*index) > size) {
+    return false;
+  }
+#ifdef NOSCR
+  if (header->lookup_bits != 4 && header->lookup_bits != 8) {
+    return false;
+  }
+#else
+  if (header->lookup_bits) {
+    return false;
+  }
+#endif
+
+  // the kernels rely on the dimensions of the matrices, so they have to match the instance
+  lowmc_file_entry_t* dims = calloc(lowmc_file_max_matrices(r), sizeof(lowmc_file_entry_t));
+  bool ret = dims && lowmc_file_dimensions(m, n, r, k, header->lookup_bits, header->folded,
+                                           dims) == matrices;
+  for (size_t i = 0; ret && i < matrices; ++i) {
+    ret = index[i].nrows == dims[i].nrows && index[i].ncols == dims[i].ncols;
+  }
+  free(dims);
+  if (!ret) {
+    return false;
   }
 
-  return false;
+  // the index is in the order of the matrices, so the offsets are checked in sorted order: the
+  // matrices have to follow the index, must not overlap and have to end within the file
+  lowmc_file_entry_t* sorted = malloc(matrices * sizeof(*index));
+  if (!sorted) {
+    return false;
+  }
+  memcpy(sorted, index, matrices * sizeof(*index));
+  qsort(sorted, matrices, sizeof(*sorted), lowmc_file_entry_cmp);
+
+  size_t end = sizeof(*header) + matrices * sizeof(*index);
+  for (size_t i = 0; ret && i < matrices; ++i) {
+    const size_t len =
+        LOWMC_FILE_MZD_SIZE + lowmc_file_rows_size(sorted[i].nrows, sorted[i].ncols);
+    ret = sorted[i].offset % 32 == 0 && sorted[i].offset >= end && sorted[i].offset <= size &&
+          size - sorted[i].offset >= len;
+    end = sorted[i].offset + len;
+  }
+  free(sorted);
+  if (!ret) {
+    return false;
+  }
+
+  SHA256_CTX ctx;
+  lowmc_file_digest_init(&ctx, header, index);
+  for (size_t i = 0; i < matrices; ++i) {
+    SHA256_Update(&ctx, (unsigned char const*)header + index[i].offset + LOWMC_FILE_MZD_SIZE,
+                  lowmc_file_rows_size(index[i].nrows, index[i].ncols));
+  }
+  unsigned char digest[SHA256_DIGEST_LENGTH];
+  SHA256_Final(digest, &ctx);
+  return !memcmp(digest, header->digest, sizeof(digest));
 }
 
-void writeMZD_TStructToFile(mzd_t* matrix, FILE* file) {
+lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed) {
+  char file_name[64];
+  if (!lowmc_file_name(file_name, sizeof(file_name), m, n, r, k, seed)) {
+    return NULL;
+  }
+
+  size_t size         = 0;
+  unsigned char* data = lowmc_file_map(file_name, &size);
+  if (!data) {
+    return NULL;
+  }
+
+  lowmc_file_header_t const* header = (lowmc_file_header_t const*)data;
+  lowmc_file_entry_t const* index   = (lowmc_file_entry_t const*)(data + sizeof(*header));
+
+  lowmc_t* lowmc = calloc(1, sizeof(lowmc_t));
+  lowmc->m       = m;
+  lowmc->n       = n;
+  lowmc->r       = r;
+  lowmc->k       = k;
+  lowmc->rounds  = calloc(r, sizeof(lowmc_round_t));
+#ifdef REDUCED_ROUND_KEYS
+  // the value is checked by lowmc_file_check
+  lowmc->folded = header->folded;
+#endif
+
+  mzd_t*** matrices  = calloc(lowmc_file_max_matrices(r), sizeof(mzd_t**));
+  const size_t count = lowmc_file_matrices(lowmc, matrices);
+  if (!lowmc_file_check(header, index, size, m, n, r, k, seed, count)) {
+    printf("Ignoring invalid instance file %s\n", file_name);
+    lowmc_file_unmap(data, size);
+    free(matrices);
+    free(lowmc->rounds);
+    free(lowmc);
+    return NULL;
+  }
+
+  size_t total_rows = 0;
+  for (size_t i = 0; i < count; ++i) {
+    total_rows += index[i].nrows;
+  }
+
+  word** rows = malloc(total_rows * sizeof(word*));
+  for (size_t i = 0; i < count; ++i) {
+    *matrices[i] =
+        mzd_local_setup_in_place(data + index[i].offset, index[i].nrows, index[i].ncols, rows);
+    rows += index[i].nrows;
+  }
+  free(matrices);
+
+#ifdef HAVE_SYS_MMAN_H
+  mprotect(data, size, PROT_READ);
+#endif
+
+  lowmc->mapping      = data;
+  lowmc->mapping_size = size;
+  lowmc->mapping_rows = rows - total_rows;
+  memcpy(lowmc->seed, header->seed, sizeof(lowmc->seed));
+#ifdef REDUCED_ROUND_KEYS
+  lowmc_reduced_round_keys_layout(lowmc);
+#endif
+
+  return lowmc;
+}
 
-  fwrite(&(matrix->nrows), sizeof(rci_t), 1, file);
-  fwrite(&(matrix->ncols), sizeof(rci_t), 1, file);
+// writes zeros up to offset
+static bool lowmc_file_pad(FILE* file, size_t offset) {
+  static const unsigned char zeros[LOWMC_FILE_PAGE_SIZE] = {0};
 
-  for (int i = 0; i < matrix->nrows; i++) {
-    fwrite((matrix->rows[i]), matrix->rowstride * sizeof(word), 1, file);
+  const long pos = ftell(file);
+  if (pos < 0 || (size_t)pos > offset) {
+    return false;
   }
+  for (size_t len = offset - pos; len;) {
+    const size_t chunk = MIN(sizeof(zeros), len);
+    if (fwrite(zeros, chunk, 1, file) != 1) {
+      return false;
+    }
+    len -= chunk;
+  }
+  return true;
 }
 
-mzd_t* readMZD_TStructFromFile(FILE* file) {
+bool writeFile(lowmc_t* lowmc, bool from_seed) {
+  mzd_t*** matrices  = calloc(lowmc_file_max_matrices(lowmc->r), sizeof(mzd_t**));
+  const size_t count = lowmc_file_matrices(lowmc, matrices);
+
+  lowmc_file_header_t header;
+  lowmc_file_init_header(&header, lowmc->m, lowmc->n, lowmc->r, lowmc->k);
+#ifdef NOSCR
+  header.lookup_bits = mzd_lookup_bits(lowmc->k0_lookup, lowmc->k);
+#endif
+#ifdef REDUCED_ROUND_KEYS
+  header.folded = lowmc->folded;
+#endif
+  header.matrices = count;
+  memcpy(header.seed, lowmc->seed, sizeof(header.seed));
+
+  // matrices smaller than a page are packed after the index, the others follow page aligned
+  lowmc_file_entry_t* index = calloc(count, sizeof(lowmc_file_entry_t));
+  size_t* order             = calloc(count, sizeof(size_t));
+  size_t offset             = lowmc_file_align(sizeof(header) + count * sizeof(*index), 32);
+  for (unsigned int large = 0, pos = 0; large < 2; ++large) {
+    for (size_t i = 0; i < count; ++i) {
+      mzd_t const* A         = *matrices[i];
+      const size_t rows_size = lowmc_file_rows_size(A->nrows, A->ncols);
+      if ((rows_size >= LOWMC_FILE_PAGE_SIZE) != large) {
+        continue;
+      }
+
+      if (large) {
+        offset = lowmc_file_align(offset + LOWMC_FILE_MZD_SIZE, LOWMC_FILE_PAGE_SIZE) -
+                 LOWMC_FILE_MZD_SIZE;
+      }
+      index[i].nrows  = A->nrows;
+      index[i].ncols  = A->ncols;
+      index[i].offset = offset;
+      order[pos++]    = i;
+      offset = lowmc_file_align(offset + LOWMC_FILE_MZD_SIZE + rows_size,
+                                large ? LOWMC_FILE_PAGE_SIZE : 32);
+    }
+  }
+  header.size = offset;
+
+  SHA256_CTX ctx;
+  lowmc_file_digest_init(&ctx, &header, index);
+  for (size_t i = 0; i < count; ++i) {
+    mzd_t const* A     = *matrices[i];
+    const size_t width = mzd_local_rowstride(A->ncols) * sizeof(word);
+    for (rci_t j = 0; j < A->nrows; ++j) {
+      SHA256_Update(&ctx, A->rows[j], width);
+    }
+  }
+  SHA256_Final(header.digest, &ctx);
 
-  int ret       = 0;
-  int nrows     = 0;
-  int ncols     = 0;
-  ret += fread(&(nrows), sizeof(rci_t), 1, file);
-  ret += fread(&(ncols), sizeof(rci_t), 1, file);
+  // other processes may read the file concurrently, so it is replaced atomically
+  char file_name[64], tmp_name[96];
+  FILE* file = NULL;
+  if (lowmc_file_name(file_name, sizeof(file_name), lowmc->m, lowmc->n, lowmc->r, lowmc->k,
+                      from_seed ? lowmc->seed : NULL)) {
+    const int len = snprintf(tmp_name, sizeof(tmp_name), "%s.%ld.tmp", file_name, (long)getpid());
+    if (len >= 0 && (size_t)len < sizeof(tmp_name)) {
+      file = fopen(tmp_name, "wb");
+    }
+  }
+
+  bool ret = false;
+  if (file) {
+    ret = fwrite(&header, sizeof(header), 1, file) == 1 &&
+          fwrite(index, sizeof(*index), count, file) == count;
 
-  mzd_t* A = mzd_local_init_ex(nrows, ncols, false);
-  for (int i = 0; i < A->nrows; i++) {
-    ret += fread((A->rows[i]), A->rowstride * sizeof(word), 1, file);
+    for (size_t pos = 0; ret && pos < count; ++pos) {
+      const size_t i     = order[pos];
+      mzd_t const* A     = *matrices[i];
+      const size_t width = mzd_local_rowstride(A->ncols) * sizeof(word);
+
+      // the mzd_t is set up when the file is read
+      ret = lowmc_file_pad(file, index[i].offset + LOWMC_FILE_MZD_SIZE);
+      for (rci_t j = 0; ret && j < A->nrows; ++j) {
+        ret = fwrite(A->rows[j], width, 1, file) == 1;
+      }
+    }
+    ret = ret && lowmc_file_pad(file, header.size);
+
+    ret = !fclose(file) && ret;
+    if (ret) {
+      ret = !rename(tmp_name, file_name);
+    }
+    if (!ret) {
+      remove(tmp_name);
+    }
   }
 
-  return A;
+  free(order);
+  free(index);
+  free(matrices);
+  return ret;
 }
 
 lowmc_key_t* lowmc_keygen(lowmc_t* lowmc) {
@@ -220,6 +1207,18 @@ lowmc_key_t* lowmc_keygen(lowmc_t* lowmc) {
 }
 
 void lowmc_free(lowmc_t* lowmc) {
+  if (lowmc->mapping) {
+    // all matrices are stored in the mapping
+    lowmc_file_unmap(lowmc->mapping, lowmc->mapping_size);
+    free(lowmc->mapping_rows);
+    free(lowmc->rounds);
+    free(lowmc);
+    return;
+  }
+
+#ifdef REDUCED_ROUND_KEYS
+  lowmc_free_folded_linear_layers(lowmc);
+#endif
   for (unsigned i = 0; i < lowmc->r; ++i) {
 #ifdef NOSCR
     mzd_local_free(lowmc->rounds[i].k_lookup);
@@ -234,6 +1233,14 @@ void lowmc_free(lowmc_t* lowmc) {
 #endif
   mzd_local_free(lowmc->k0_matrix);
   free(lowmc->rounds);
+#ifdef REDUCED_ROUND_KEYS
+#ifdef NOSCR
+  mzd_local_free(lowmc->rrk_lookup);
+  mzd_local_free(lowmc->kf_lookup);
+#endif
+  mzd_local_free(lowmc->rrk_matrix);
+  mzd_local_free(lowmc->kf_matrix);
+#endif
 
   mzd_local_free(lowmc->mask.x0);
   mzd_local_free(lowmc->mask.x1);
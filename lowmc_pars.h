@@ -22,13 +22,66 @@ typedef struct {
   mzd_t* k_lookup;
   mzd_t* l_lookup;
 #endif
+
+#ifdef REDUCED_ROUND_KEYS
+  // linear layer and constant in the folded representation, see lowmc_t
+  mzd_t* lower_matrix;
+  mzd_t* upper_matrix;
+  mzd_t* folded_constant;
+#ifdef NOSCR
+  mzd_t* lower_lookup;
+  mzd_t* upper_lookup;
+#endif
+#endif
 } lowmc_round_t;
 
+struct lowmc_s;
+struct view_s;
+struct sbox_vars_s;
+
+typedef void (*lowmc_sbox_fn)(mzd_t* out, mzd_t* in, mask_t const* mask);
+typedef void (*mpc_sbox_fn)(mzd_t** out, mzd_t* const* in, struct view_s const* view,
+                            mzd_t* const* rvec, mask_t const* mask,
+                            struct sbox_vars_s const* vars);
+typedef void (*mpc_sbox_x2_fn)(mzd_t** const out[2], mzd_t** const in[2],
+                               struct view_s const* const view[2], mzd_t** const rvec[2],
+                               mask_t const* mask);
+typedef void (*mpc_rounds_fn)(struct lowmc_s const* lowmc, mzd_t** x, mzd_t const* p,
+                              struct view_s* views, mzd_t*** rvec, mzd_t* const* round_keys,
+                              unsigned int ch);
+
+/**
+ * Implementations of the S-box layers and the products with the lookup tables. They are selected
+ * once for the instance and the CPU, so that the rounds do not need to check for CPU features.
+ */
+typedef struct {
+  lowmc_sbox_fn sbox;
+  mpc_sbox_fn mpc_sbox;
+  mpc_sbox_fn mpc_sbox_verify;
+  // evaluates the S-box layers of two repetitions at once, NULL if not available
+  mpc_sbox_x2_fn mpc_sbox_x2;
+  // true if the MPC S-box layers require the buffers from sbox_vars_t
+  bool mpc_sbox_vars;
+  // evaluates all rounds of the prover with the states of the shares kept in registers, NULL if
+  // not available
+  mpc_rounds_fn mpc_rounds;
+
+  mzd_mul_vl_fn mul_vl;
+  mzd_mul_vl_fn addmul_vl;
+#ifdef REDUCED_ROUND_KEYS
+  // product of a key with rrk_lookup
+  mzd_mul_vl_fn mul_vl_rrk;
+  // products with lower_lookup and upper_lookup of the folded linear layers
+  mzd_mul_vl_fn mul_vl_lower;
+  mzd_mul_vl_fn mul_vl_upper;
+#endif
+} lowmc_kernels_t;
+
 /**
  * Represents the LowMC parameters as in https://bitbucket.org/malb/lowmc-helib/src,
  * with the difference that key in a separate struct
  */
-typedef struct {
+typedef struct lowmc_s {
   size_t m;
   size_t n;
   size_t r;
@@ -41,6 +94,62 @@ typedef struct {
   mzd_t* k0_lookup;
 #endif
   lowmc_round_t* rounds;
+
+#ifdef REDUCED_ROUND_KEYS
+  /**
+   * Only the 3m S-box bits of a round key pass through the non-linear layer. The remaining bits
+   * can be moved into the key additions of the following rounds. The round keys then reduce to
+   * the 3m S-box bits of each round, which are added before the S-box layer, and one key addition
+   * after the last round.
+   *
+   * The S-box bits of the state are stored in the rrk_words words starting at rrk_word. Column
+   * block i * rrk_words of rrk_matrix holds these words of the key matrix of round i, kf_matrix
+   * is the key matrix of the final key addition.
+   */
+  mzd_t* rrk_matrix;
+  mzd_t* kf_matrix;
+#ifdef NOSCR
+  mzd_t* rrk_lookup;
+  mzd_t* kf_lookup;
+#endif
+  unsigned int rrk_word;
+  unsigned int rrk_words;
+
+  /**
+   * The S-box layer only changes the 3m S-box bits and passes the other bits of the state, the
+   * linear bits, unchanged. A change of basis of the linear bits hence commutes with it. If folded
+   * is set, the state of round i is kept in the basis B_i of the linear bits, where B_0 is the
+   * standard basis and B_{i + 1} is chosen such that the linear layer maps the lower words, i.e.
+   * the words below rrk_word, of the state to themselves:
+   *
+   *   x' = (y with the words from rrk_word cleared) + (y_lower * lower_matrix placed at rrk_word)
+   *        + y_upper * upper_matrix + folded_constant
+   *
+   * y_lower are the lower words of y and y_upper the remaining words. With l = 64 * rrk_word,
+   * lower_matrix has l rows and n - l columns and upper_matrix n - l rows and n columns. Only the
+   * linear layer of the last round, lf_matrix, returns to the standard basis. The S-box bits and
+   * hence the views are not affected by the change of basis.
+   *
+   * Folding is only used for 256 < n <= 64 * MZD_FIXED_MAX_WIDTH, see lowmc_folding_supported,
+   * and fails with negligible probability for rounds whose linear layer does not allow the choice
+   * of B_{i + 1}. The linear layers are then evaluated with l_matrix.
+   */
+  bool folded;
+  mzd_t* lf_matrix;
+#ifdef NOSCR
+  mzd_t* lf_lookup;
+#endif
+#endif
+
+  lowmc_kernels_t kernels;
+
+  // seed all matrices and constants were derived from
+  unsigned char seed[PRNG_KEYSIZE];
+
+  // if the instance was read from a file, all matrices point into its mapping
+  void* mapping;
+  size_t mapping_size;
+  word** mapping_rows;
 } lowmc_t;
 
 /**
@@ -55,6 +164,22 @@ typedef struct {
  */
 lowmc_t* lowmc_init(size_t m, size_t n, size_t r, size_t k);
 
+/**
+ * Derives a LowMC instance from a seed. All matrices and constants are sampled from AES-128-CTR
+ * streams keyed by the seed, so every host obtains the same instance for the same parameters and
+ * seed without exchanging the instance file. The instance is cached in the file "m-n-r-k-seed".
+ *
+ * \param m    the number of sboxes
+ * \param n    the blocksize
+ * \param r    the number of rounds
+ * \param k    the keysize
+ * \param seed the seed of the instance
+ *
+ * \return parameters defining a LowMC instance
+ */
+lowmc_t* lowmc_init_from_seed(size_t m, size_t n, size_t r, size_t k,
+                              const unsigned char seed[PRNG_KEYSIZE]);
+
 lowmc_key_t* lowmc_keygen(lowmc_t* lowmc);
 
 /**
@@ -80,8 +205,33 @@ void lowmc_key_free(lowmc_key_t* lowmc_key);
  */
 void lowmc_secret_share(lowmc_t* lowmc, lowmc_key_t* lowmc_key);
 
-lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k);
-bool writeFile(lowmc_t* lowmc);
-void writeMZD_TStructToFile(mzd_t* matrix, FILE* file);
-mzd_t* readMZD_TStructFromFile(FILE* file);
+/**
+ * Selects the kernels for the instance based on its parameters and the features of the CPU.
+ */
+void lowmc_select_kernels(lowmc_t* lowmc);
+
+#ifdef NOSCR
+/**
+ * Replaces the lookup tables by tables for chunks of the given number of bits, i.e. 4 or 8, and
+ * selects the kernels for them. The instance must not be mapped from a file.
+ */
+void lowmc_precompute_lookups(lowmc_t* lowmc, unsigned int bits);
+#endif
+
+/**
+ * Maps the instance file "m-n-r-k" in the current working directory. The matrices of the returned
+ * instance are used in place.
+ *
+ * \param seed if not NULL, the file "m-n-r-k-seed" of the instance derived from seed is mapped
+ * \return     the instance or NULL if the file does not exist or does not match the parameters and
+ *             the configuration
+ */
+lowmc_t* readFile(size_t m, size_t n, size_t r, size_t k, const unsigned char* seed);
+/**
+ * Stores the instance in the file "m-n-r-k" in the current working directory. The file is replaced
+ * atomically.
+ *
+ * \param from_seed store the instance in the file named after its seed
+ */
+bool writeFile(lowmc_t* lowmc, bool from_seed);
 #endif
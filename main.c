@@ -37,8 +37,8 @@ static void print_detailed_timings(timing_and_size_t* timings, unsigned int iter
     printf("MPC randomess generation      %6" PRIu64 "\n", timings->sign.rand);
     printf("MPC secret sharing            %6" PRIu64 "\n", timings->sign.secret_sharing);
     printf("MPC LowMC encryption          %6" PRIu64 "\n", timings->sign.lowmc_enc);
-    printf("Hashing views                 %6" PRIu64 "\n", timings->sign.views);
     printf("Generating challenge          %6" PRIu64 "\n", timings->sign.challenge);
+    printf("Allocated mzd buffers         %6" PRIu64 "\n", timings->mzd_allocations);
     printf("\n");
     printf("Verify:\n");
     printf("Recomputing challenge         %6" PRIu64 "\n", timings->verify.challenge);
@@ -51,9 +51,10 @@ static void print_detailed_timings(timing_and_size_t* timings, unsigned int iter
 
 #endif
 
-static void parse_args(int params[5], int argc, char** argv) {
-  if (argc != 6) {
-    printf("Usage ./mpc_lowmc [Number of SBoxes] [Blocksize] [Rounds] [Keysize] [Numiter]\n");
+static void parse_args(int params[6], int argc, char** argv) {
+  if (argc != 6 && argc != 7) {
+    printf("Usage ./mpc_lowmc [Number of SBoxes] [Blocksize] [Rounds] [Keysize] [Numiter] "
+           "[Threads]\n");
     exit(-1);
   }
   params[0] = atoi(argv[1]);
@@ -61,14 +62,20 @@ static void parse_args(int params[5], int argc, char** argv) {
   params[2] = atoi(argv[3]);
   params[3] = atoi(argv[4]);
   params[4] = atoi(argv[5]);
+  // number of worker threads, none by default
+  params[5] = argc == 7 ? atoi(argv[6]) : 0;
 
   if (params[0] * 3 > params[1]) {
     printf("Number of S-boxes * 3 exceeds block size!");
     exit(-1);
   }
+  if (params[5] < 0) {
+    printf("Number of threads is negative!\n");
+    exit(-1);
+  }
 }
 
-static void fis_sign_verify(int args[5]) {
+static void fis_sign_verify(int args[6]) {
   static const uint8_t m[] = {1,  2,  3,  4,  5,  6,  7,  8,  9,  10, 11, 12, 13, 14, 15, 16,
                               17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31, 32};
 
@@ -94,19 +101,21 @@ static void fis_sign_verify(int args[5]) {
 
     fis_signature_t* sig = fis_sign(&pp, &private_key, m, sizeof(m));
     if (sig) {
-      unsigned len        = 0;
-      unsigned char* data = fis_sig_to_char_array(&pp, sig, &len);
+      const size_t cap    = fis_sig_serialized_size(&pp, sig);
+      unsigned char* data = malloc(cap);
+      const size_t len    = fis_sig_serialize_into(&pp, sig, data, cap);
       timing_and_size->size =
           fis_compute_sig_size(pp.lowmc->m, pp.lowmc->n, pp.lowmc->r, pp.lowmc->k);
       fis_free_signature(&pp, sig);
-      sig = fis_sig_from_char_array(&pp, data);
-      free(data);
 
-      if (fis_verify(&pp, &public_key, m, sizeof(m), sig)) {
+      fis_signature_t parsed = {NULL};
+      if (!fis_sig_parse_view(&pp, data, len, &parsed) ||
+          fis_verify(&pp, &public_key, m, sizeof(m), &parsed)) {
         printf("fis_verify: failed\n");
       }
+      free(data);
 
-      fis_free_signature(&pp, sig);
+      fis_clear_signature(&pp, &parsed);
     } else {
       printf("fis_sign: failed\n");
     }
@@ -130,11 +139,16 @@ int main(int argc, char** argv) {
   init_EVP();
   openmp_thread_setup();
 
-  int args[5];
+  int args[6];
   parse_args(args, argc, argv);
+  if (!fis_set_threads(args[5])) {
+    printf("Failed to start worker threads.\n");
+    exit(-1);
+  }
 
   fis_sign_verify(args);
 
+  fis_set_threads(0);
   openmp_thread_cleanup();
   cleanup_EVP();
   deinit_rand_bytes();
@@ -2,13 +2,11 @@
 #include "mzd_additional.h"
 #include "simd.h"
 
-#if 0
 void mpc_clear(mzd_t** res, unsigned sc) {
   for (unsigned int i = 0; i < sc; i++) {
     mzd_local_clear(res[i]);
   }
 }
-#endif
 
 void mpc_shift_right(mzd_t* const* res, mzd_t* const* val, unsigned count, unsigned sc) {
   for (unsigned i = 0; i < sc; ++i)
@@ -40,7 +38,7 @@ __attribute__((target("sse2"))) void mpc_and_sse(__m128i* res, __m128i const* fi
   for (unsigned m = 0; m < SC_PROOF; ++m) {
     const unsigned j = (m + 1) % SC_PROOF;
 
-    __m128i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 16);
+    __m128i* sm = __builtin_assume_aligned(view->s[m], 16);
 
     __m128i tmp1 = _mm_xor_si128(second[m], second[j]);
     __m128i tmp2 = _mm_and_si128(first[j], second[m]);
@@ -63,7 +61,7 @@ __attribute__((target("avx2"))) void mpc_and_avx(__m256i* res, __m256i const* fi
   for (unsigned m = 0; m < SC_PROOF; ++m) {
     const unsigned j = (m + 1) % SC_PROOF;
 
-    __m256i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 32);
+    __m256i* sm = __builtin_assume_aligned(view->s[m], 32);
 
     __m256i tmp1 = _mm256_xor_si256(second[m], second[j]);
     __m256i tmp2 = _mm256_and_si256(first[j], second[m]);
@@ -77,11 +75,32 @@ __attribute__((target("avx2"))) void mpc_and_avx(__m256i* res, __m256i const* fi
     *sm  = _mm256_xor_si256(tmp1, *sm);
   }
 }
+
+__attribute__((target("avx2"))) void mpc_and_avx_x2(__m256i* res, __m256i const* first,
+                                                    __m256i const* second, __m256i const* r,
+                                                    view_t const* view0, view_t const* view1,
+                                                    unsigned viewshift) {
+  for (unsigned m = 0; m < SC_PROOF; ++m) {
+    const unsigned j = (m + 1) % SC_PROOF;
+
+    __m256i tmp1 = _mm256_xor_si256(second[m], second[j]);
+    __m256i tmp2 = _mm256_and_si256(first[j], second[m]);
+    tmp1         = _mm256_and_si256(tmp1, first[m]);
+    tmp1         = _mm256_xor_si256(tmp1, tmp2);
+
+    tmp2   = _mm256_xor_si256(r[m], r[j]);
+    res[m] = tmp1 = _mm256_xor_si256(tmp1, tmp2);
+
+    tmp1 = mm256_shift_right_x2(tmp1, viewshift);
+    tmp2 = mm256_load_x2(view0->s[m], view1->s[m]);
+    mm256_store_x2(view0->s[m], view1->s[m], _mm256_xor_si256(tmp1, tmp2));
+  }
+}
 #endif
 #endif
 
 void mpc_and(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
-             view_t* view, unsigned viewshift, mzd_t* const* buffer) {
+             view_t const* view, unsigned viewshift, mzd_t* const* buffer) {
   mzd_t* b = buffer[0];
 
   for (unsigned m = 0; m < SC_PROOF; ++m) {
@@ -100,7 +119,13 @@ void mpc_and(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t
   }
 
   mpc_shift_right(buffer, res, viewshift, SC_PROOF);
-  mpc_xor(view->s, view->s, buffer, SC_PROOF);
+  for (unsigned m = 0; m < SC_PROOF; ++m) {
+    word* v       = view->s[m];
+    word const* t = CONST_FIRST_ROW(buffer[m]);
+    for (rci_t w = 0; w < buffer[m]->width; ++w) {
+      v[w] ^= t[w];
+    }
+  }
 }
 
 #ifdef WITH_OPT
@@ -112,7 +137,7 @@ __attribute__((target("sse2"))) void mpc_and_verify_sse(__m128i* res, __m128i co
   for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
     const unsigned j = (m + 1);
 
-    __m128i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 16);
+    __m128i* sm = __builtin_assume_aligned(view->s[m], 16);
 
     __m128i tmp1 = _mm_xor_si128(second[m], second[j]);
     __m128i tmp2 = _mm_and_si128(first[j], second[m]);
@@ -126,7 +151,7 @@ __attribute__((target("sse2"))) void mpc_and_verify_sse(__m128i* res, __m128i co
     *sm  = _mm_xor_si128(tmp1, *sm);
   }
 
-  __m128i const* s1  = __builtin_assume_aligned(CONST_FIRST_ROW(view->s[SC_VERIFY - 1]), 16);
+  __m128i const* s1  = __builtin_assume_aligned(view->s[SC_VERIFY - 1], 16);
   __m128i rsc        = mm128_shift_left(*s1, viewshift);
   res[SC_VERIFY - 1] = _mm_and_si128(rsc, mask);
 }
@@ -140,7 +165,7 @@ __attribute__((target("avx2"))) void mpc_and_verify_avx(__m256i* res, __m256i co
   for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
     const unsigned j = (m + 1);
 
-    __m256i* sm = __builtin_assume_aligned(FIRST_ROW(view->s[m]), 32);
+    __m256i* sm = __builtin_assume_aligned(view->s[m], 32);
 
     __m256i tmp1 = _mm256_xor_si256(second[m], second[j]);
     __m256i tmp2 = _mm256_and_si256(first[j], second[m]);
@@ -154,7 +179,7 @@ __attribute__((target("avx2"))) void mpc_and_verify_avx(__m256i* res, __m256i co
     *sm  = _mm256_xor_si256(tmp1, *sm);
   }
 
-  __m256i const* s1  = __builtin_assume_aligned(CONST_FIRST_ROW(view->s[SC_VERIFY - 1]), 32);
+  __m256i const* s1  = __builtin_assume_aligned(view->s[SC_VERIFY - 1], 32);
   __m256i rsc        = mm256_shift_left(*s1, viewshift);
   res[SC_VERIFY - 1] = _mm256_and_si256(rsc, mask);
 }
@@ -181,12 +206,18 @@ void mpc_and_verify(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second
     mzd_xor(res[m], res[m], r[j]);
   }
 
+  word const* t = CONST_FIRST_ROW(b);
   for (unsigned m = 0; m < (SC_VERIFY - 1); ++m) {
     mzd_shift_right(b, res[m], viewshift);
-    mzd_xor(view->s[m], view->s[m], b);
+
+    word* v = view->s[m];
+    for (rci_t w = 0; w < b->width; ++w) {
+      v[w] ^= t[w];
+    }
   }
 
-  mzd_shift_left(res[SC_VERIFY - 1], view->s[SC_VERIFY - 1], viewshift);
+  memcpy(FIRST_ROW(b), view->s[SC_VERIFY - 1], b->width * sizeof(word));
+  mzd_shift_left(res[SC_VERIFY - 1], b, viewshift);
   mzd_and(res[SC_VERIFY - 1], res[SC_VERIFY - 1], mask);
 }
 
@@ -262,15 +293,17 @@ mzd_t** mpc_const_mat_mul(mzd_t** result, mzd_t const* matrix, mzd_t** vector, u
   return result;
 }
 
-void mpc_const_addmat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc) {
+void mpc_const_addmat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc,
+                            mzd_mul_vl_fn addmul_vl) {
   for (unsigned i = 0; i < sc; ++i) {
-    mzd_addmul_vl(result[i], vector[i], matrix);
+    addmul_vl(result[i], vector[i], matrix);
   }
 }
 
-mzd_t** mpc_const_mat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc) {
+mzd_t** mpc_const_mat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc,
+                            mzd_mul_vl_fn mul_vl) {
   for (unsigned i = 0; i < sc; ++i) {
-    mzd_mul_vl(result[i], vector[i], matrix);
+    mul_vl(result[i], vector[i], matrix);
   }
   return result;
 }
@@ -281,6 +314,12 @@ void mpc_copy(mzd_t** out, mzd_t* const* in, unsigned sc) {
   }
 }
 
+void mpc_copy_to_view(word* const* view, mzd_t* const* in, unsigned sc) {
+  for (unsigned i = 0; i < sc; ++i) {
+    memcpy(view[i], CONST_FIRST_ROW(in[i]), in[i]->width * sizeof(word));
+  }
+}
+
 mzd_t* mpc_reconstruct_from_share(mzd_t* dst, mzd_t** shared_vec) {
   if (!dst) {
     dst = mzd_local_init_ex(shared_vec[0]->nrows, shared_vec[0]->ncols, false);
@@ -19,7 +19,7 @@ void mpc_xor(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, unsig
 void mpc_clear(mzd_t** res, unsigned sc) __attribute__((nonnull));
 
 void mpc_and(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
-             view_t* view, unsigned viewshift, mzd_t* const* buffer) __attribute__((nonnull));
+             view_t const* view, unsigned viewshift, mzd_t* const* buffer) __attribute__((nonnull));
 
 void mpc_and_verify(mzd_t* const* res, mzd_t* const* first, mzd_t* const* second, mzd_t* const* r,
                     view_t const* view, mzd_t const* mask, unsigned viewshift, mzd_t* const* buffer)
@@ -34,6 +34,13 @@ void mpc_and_sse(__m128i* res, __m128i const* first, __m128i const* second, __m1
 void mpc_and_avx(__m256i* res, __m256i const* first, __m256i const* second, __m256i const* r,
                  view_t const* view, unsigned viewshift) __attribute__((nonnull));
 
+/**
+ * Like mpc_and_sse for two independent repetitions, one in each 128 bit half of the operands.
+ */
+void mpc_and_avx_x2(__m256i* res, __m256i const* first, __m256i const* second, __m256i const* r,
+                    view_t const* view0, view_t const* view1, unsigned viewshift)
+    __attribute__((nonnull));
+
 void mpc_and_verify_sse(__m128i* res, __m128i const* first, __m128i const* second, __m128i const* r,
                         view_t const* view, __m128i const mask, unsigned viewshift)
     __attribute__((nonnull));
@@ -177,8 +184,8 @@ mzd_t** mpc_const_add(mzd_t** result, mzd_t** first, mzd_t const* second, unsign
 mzd_t** mpc_const_mat_mul(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc)
     __attribute__((nonnull));
 
-void mpc_const_addmat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc)
-    __attribute__((nonnull));
+void mpc_const_addmat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc,
+                            mzd_mul_vl_fn addmul_vl) __attribute__((nonnull));
 
 /**
  * Computes result = first * second in GF(2) of a
@@ -189,10 +196,11 @@ void mpc_const_addmat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector,
  * \param  matrix the matrix
  * \param  vector the secret shared vector
  * \param  sc     the share count
+ * \param  mul_vl the implementation of mzd_mul_vl to use
  * \return        the result of the computation
  */
-mzd_t** mpc_const_mat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc)
-    __attribute__((nonnull));
+mzd_t** mpc_const_mat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector, unsigned sc,
+                            mzd_mul_vl_fn mul_vl) __attribute__((nonnull));
 
 /**
  * Deep copies a secret shared vector
@@ -204,6 +212,15 @@ mzd_t** mpc_const_mat_mul_l(mzd_t** result, mzd_t const* matrix, mzd_t** vector,
  */
 void mpc_copy(mzd_t** out, mzd_t* const* in, unsigned sc) __attribute__((nonnull(2)));
 
+/**
+ * Copies a secret shared vector to the views of the parties
+ *
+ * \param view the views of the parties
+ * \param in   the source
+ * \param sc   the share count
+ */
+void mpc_copy_to_view(word* const* view, mzd_t* const* in, unsigned sc) __attribute__((nonnull));
+
 /**
  * Prints a secret shared vector
  *
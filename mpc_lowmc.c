@@ -1,51 +1,89 @@
 #include "mpc_lowmc.h"
 #include "hashing_util.h"
 #include "io.h"
+#include "lowmc.h"
 #include "lowmc_pars.h"
 #include "mpc.h"
 #include "mzd_additional.h"
+#include "mzd_fixed.h"
 
 #include <stdalign.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef WITH_OPT
 #include "simd.h"
 #endif
 
-typedef struct {
-  mzd_t* x0m[SC_PROOF];
-  mzd_t* x1m[SC_PROOF];
-  mzd_t* x2m[SC_PROOF];
-  mzd_t* r0m[SC_PROOF];
-  mzd_t* r1m[SC_PROOF];
-  mzd_t* r2m[SC_PROOF];
-  mzd_t* x0s[SC_PROOF];
-  mzd_t* r0s[SC_PROOF];
-  mzd_t* x1s[SC_PROOF];
-  mzd_t* r1s[SC_PROOF];
-  mzd_t* v[SC_PROOF];
-
-  mzd_t** storage;
-} sbox_vars_t;
-
-static sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, rci_t n, unsigned sc);
+static sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, mpc_lowmc_t const* lowmc, unsigned sc);
 static void sbox_vars_clear(sbox_vars_t* vars);
 
 typedef int (*BIT_and_ptr)(BIT*, BIT*, BIT*, view_t*, int*, unsigned, unsigned);
 typedef int (*and_ptr)(mzd_t**, mzd_t**, mzd_t**, mzd_t**, view_t*, mzd_t*, unsigned, mzd_t**);
 
-unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned* len,
-                                   bool store_ch) {
-  unsigned first_view_bytes = lowmc->k / 8;
-  unsigned full_mzd_size    = lowmc->n / 8;
-  unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
-  unsigned mzd_bytes        = lowmc->r * single_mzd_bytes + first_view_bytes + full_mzd_size;
-  *len =
-      NUM_ROUNDS * (COMMITMENT_LENGTH + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + mzd_bytes) +
-      (store_ch ? ((NUM_ROUNDS + 3) / 4) : 0);
-  unsigned char* result = (unsigned char*)malloc(*len * sizeof(unsigned char));
+size_t view_stride(mpc_lowmc_t const* lowmc) {
+  return mzd_local_rowstride(lowmc->n);
+}
+
+size_t view_key_stride(mpc_lowmc_t const* lowmc) {
+  // keep the following views aligned for the AVX2 code
+  const size_t stride = mzd_local_rowstride(lowmc->k);
+  return (view_stride(lowmc) % 4) ? stride : (stride + 3) & ~3;
+}
+
+size_t view_party_size(mpc_lowmc_t const* lowmc) {
+  return view_key_stride(lowmc) + (1 + lowmc->r) * view_stride(lowmc);
+}
+
+void view_assign(mpc_lowmc_t const* lowmc, view_t* views, word* store, unsigned int sc) {
+  const size_t key_stride = view_key_stride(lowmc);
+  const size_t stride     = view_stride(lowmc);
+  const size_t party_size = view_party_size(lowmc);
+
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    word* s = m < sc ? store + m * party_size : NULL;
+
+    views[0].s[m] = s;
+    if (s) {
+      s += key_stride;
+    }
+    for (unsigned int j = 1; j < 2 + lowmc->r; ++j) {
+      views[j].s[m] = s;
+      if (s) {
+        s += stride;
+      }
+    }
+  }
+}
+
+size_t proof_views_size(mpc_lowmc_t const* lowmc, unsigned int sc) {
+  const size_t view_array_size = ((2 + lowmc->r) * sizeof(view_t) + 31) & ~31;
+  const size_t views_size      = ((sc * view_party_size(lowmc) * sizeof(word)) + 31) & ~31;
+
+  return NUM_ROUNDS * (view_array_size + views_size);
+}
+
+size_t proof_serialized_size(mpc_lowmc_t const* lowmc, proof_t const* proof, bool store_ch) {
+  size_t size = NUM_ROUNDS * COMMITMENT_LENGTH + (store_ch ? ((NUM_ROUNDS + 3) / 4) : 0);
+  for (unsigned int i = 0; i < NUM_ROUNDS; ++i) {
+    size += proof_round_size(lowmc, getChAt(proof->ch, i));
+  }
+
+  return size;
+}
+
+size_t proof_serialize_into(mpc_lowmc_t const* lowmc, proof_t const* proof, unsigned char* out,
+                            size_t cap, bool store_ch) {
+  const size_t len = proof_serialized_size(lowmc, proof, store_ch);
+  if (cap < len) {
+    return 0;
+  }
+
+  const unsigned first_view_bytes = lowmc->k / 8;
+  const unsigned full_mzd_size    = lowmc->n / 8;
+  const unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
 
-  unsigned char* temp = result;
+  unsigned char* temp = out;
 
   if (store_ch) {
     memcpy(temp, proof->ch, (NUM_ROUNDS + 3) / 4);
@@ -66,94 +104,155 @@ unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned*
     memcpy(temp, proof->keys[i][1], PRNG_KEYSIZE * sizeof(unsigned char));
     temp += PRNG_KEYSIZE;
 
-    unsigned char* v0;
-
     if (getChAt(proof->ch, i) != 0) {
-      v0 = mzd_to_char_array(proof->views[i][0].s[getChAt(proof->ch, i) % 2], first_view_bytes);
-      memcpy(temp, v0, first_view_bytes);
+      mzd_row_to_char_array(temp, proof->views[i][0].s[getChAt(proof->ch, i) % 2], lowmc->k,
+                            first_view_bytes);
       temp += first_view_bytes;
-      free(v0);
     }
 
     for (unsigned j = 1; j < 1 + lowmc->r; j++) {
-      v0 = mzd_to_char_array(proof->views[i][j].s[0], single_mzd_bytes);
-
-      memcpy(temp, v0, single_mzd_bytes);
+      mzd_row_to_char_array(temp, proof->views[i][j].s[0], lowmc->n, single_mzd_bytes);
       temp += single_mzd_bytes;
-
-      free(v0);
     }
 
-    v0 = mzd_to_char_array(proof->views[i][1 + lowmc->r].s[1], full_mzd_size);
-
-    memcpy(temp, v0, full_mzd_size);
+    mzd_row_to_char_array(temp, proof->views[i][1 + lowmc->r].s[1], lowmc->n, full_mzd_size);
     temp += full_mzd_size;
+  }
 
-    free(v0);
+  return len;
+}
+
+unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned* len,
+                                   bool store_ch) {
+  *len                  = proof_serialized_size(lowmc, proof, store_ch);
+  unsigned char* result = (unsigned char*)malloc(*len * sizeof(unsigned char));
+  if (result) {
+    proof_serialize_into(lowmc, proof, result, *len, store_ch);
   }
 
   return result;
 }
 
-proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned char* data,
-                               unsigned* len, bool contains_ch) {
-  if (!proof)
-    proof = calloc(sizeof(proof_t), 1);
+size_t proof_round_size(mpc_lowmc_t const* lowmc, unsigned int ch) {
+  const size_t first_view_bytes = lowmc->k / 8;
+  const size_t full_mzd_size    = lowmc->n / 8;
+  const size_t single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
 
-  unsigned first_view_bytes = lowmc->k / 8;
-  unsigned full_mzd_size    = lowmc->n / 8;
-  unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
-  unsigned mzd_bytes        = lowmc->r * single_mzd_bytes + first_view_bytes + full_mzd_size;
-  *len =
-      NUM_ROUNDS * (COMMITMENT_LENGTH + 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + mzd_bytes) +
-      (contains_ch ? ((NUM_ROUNDS + 3) / 4) : 0);
+  return 2 * (COMMITMENT_RAND_LENGTH + PRNG_KEYSIZE) + (ch ? first_view_bytes : 0) +
+         lowmc->r * single_mzd_bytes + full_mzd_size;
+}
 
-  unsigned char* temp = data;
+unsigned char const* proof_parse_round(mpc_lowmc_t const* lowmc, view_t const* views,
+                                       unsigned char keys[SC_VERIFY][PRNG_KEYSIZE],
+                                       unsigned char r[SC_VERIFY][COMMITMENT_RAND_LENGTH],
+                                       unsigned int ch, unsigned char const* data,
+                                       aes_prng_t* aes_prng) {
+  const unsigned first_view_bytes = lowmc->k / 8;
+  const unsigned full_mzd_size    = lowmc->n / 8;
+  const unsigned single_mzd_bytes = ((3 * lowmc->m) + 7) / 8;
+
+  memcpy(r[0], data, COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
+  data += COMMITMENT_RAND_LENGTH;
+  memcpy(r[1], data, COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
+  data += COMMITMENT_RAND_LENGTH;
+
+  memcpy(keys[0], data, PRNG_KEYSIZE * sizeof(char));
+  data += PRNG_KEYSIZE;
+  memcpy(keys[1], data, PRNG_KEYSIZE * sizeof(char));
+  data += PRNG_KEYSIZE;
+
+  word* const* first_view = views[0].s;
+  if (ch == 0) {
+    mzd_row_randomize_from_seed_prng(first_view[0], lowmc->k, keys[0], aes_prng);
+    mzd_row_randomize_from_seed_prng(first_view[1], lowmc->k, keys[1], aes_prng);
+  } else if (ch == 1) {
+    mzd_row_randomize_from_seed_prng(first_view[0], lowmc->k, keys[0], aes_prng);
+    mzd_row_from_char_array(first_view[1], lowmc->k, data, first_view_bytes);
+    data += first_view_bytes;
+  } else {
+    mzd_row_from_char_array(first_view[0], lowmc->k, data, first_view_bytes);
+    mzd_row_randomize_from_seed_prng(first_view[1], lowmc->k, keys[1], aes_prng);
+    data += first_view_bytes;
+  }
+  for (unsigned j = 1; j < 1 + lowmc->r; j++) {
+    mzd_row_from_char_array(views[j].s[1], lowmc->n, data, single_mzd_bytes);
+    data += single_mzd_bytes;
+  }
+  mzd_row_from_char_array(views[1 + lowmc->r].s[1], lowmc->n, data, full_mzd_size);
+  data += full_mzd_size;
+
+  return data;
+}
+
+size_t proof_parse(mpc_lowmc_t const* lowmc, proof_t* proof, unsigned char const* data,
+                   size_t len, bool contains_ch) {
+  unsigned char const* temp = data;
 
   if (contains_ch) {
+    if (len < (NUM_ROUNDS + 3) / 4) {
+      return 0;
+    }
     memcpy(proof->ch, temp, (NUM_ROUNDS + 3) / 4);
     temp += (NUM_ROUNDS + 3) / 4;
   }
 
+  // check the length and the challenge before touching the views
+  size_t size = NUM_ROUNDS * COMMITMENT_LENGTH;
+  for (unsigned int i = 0; i < NUM_ROUNDS; ++i) {
+    const unsigned int ch = getChAt(proof->ch, i);
+    if (ch > 2) {
+      return 0;
+    }
+    size += proof_round_size(lowmc, ch);
+  }
+  if (len - (size_t)(temp - data) < size) {
+    return 0;
+  }
+
+  mzd_arena_t* arena      = &proof->arena;
+  const size_t party_size = view_party_size(lowmc);
+  if (arena->head) {
+    mzd_arena_reset(arena);
+  } else {
+    mzd_arena_init(arena, proof_views_size(lowmc, SC_VERIFY));
+  }
+
   memcpy(proof->hashes, temp, NUM_ROUNDS * COMMITMENT_LENGTH * sizeof(unsigned char));
   temp += NUM_ROUNDS * COMMITMENT_LENGTH;
 
+  aes_prng_t aes_prng;
+  aes_prng_init(&aes_prng, proof->keys[0][0]);
   for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
-    memcpy(proof->r[i][0], temp, COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
-    temp += COMMITMENT_RAND_LENGTH;
-    memcpy(proof->r[i][1], temp, COMMITMENT_RAND_LENGTH * sizeof(unsigned char));
-    temp += COMMITMENT_RAND_LENGTH;
-
-    memcpy(proof->keys[i][0], temp, PRNG_KEYSIZE * sizeof(char));
-    temp += PRNG_KEYSIZE;
-    memcpy(proof->keys[i][1], temp, PRNG_KEYSIZE * sizeof(char));
-    temp += PRNG_KEYSIZE;
-    proof->views[i] = malloc((2 + lowmc->r) * sizeof(view_t));
-
-    const unsigned char ch = getChAt(proof->ch, i);
-    if (ch == 0) {
-      proof->views[i][0].s[0] = mzd_init_random_vector_from_seed(proof->keys[i][0], lowmc->k);
-      proof->views[i][0].s[1] = mzd_init_random_vector_from_seed(proof->keys[i][1], lowmc->k);
-    } else if (ch == 1) {
-      proof->views[i][0].s[0] = mzd_init_random_vector_from_seed(proof->keys[i][0], lowmc->k);
-      proof->views[i][0].s[1] = mzd_from_char_array(temp, first_view_bytes, lowmc->k);
-      temp += first_view_bytes;
-    } else {
-      proof->views[i][0].s[0] = mzd_from_char_array(temp, first_view_bytes, lowmc->k);
-      proof->views[i][0].s[1] = mzd_init_random_vector_from_seed(proof->keys[i][1], lowmc->k);
-      temp += first_view_bytes;
-    }
-    proof->views[i][0].s[2] = NULL;
-    for (unsigned j = 1; j < 1 + lowmc->r; j++) {
-      proof->views[i][j].s[0] = mzd_local_init(1, lowmc->n);
-      proof->views[i][j].s[1] = mzd_from_char_array(temp, single_mzd_bytes, lowmc->n);
-      temp += single_mzd_bytes;
-      proof->views[i][j].s[2] = NULL;
+    word* store     = mzd_arena_alloc(arena, SC_VERIFY * party_size * sizeof(word));
+    proof->views[i] = mzd_arena_alloc(arena, (2 + lowmc->r) * sizeof(view_t));
+    if (!store || !proof->views[i]) {
+      aes_prng_clear(&aes_prng);
+      clear_proof(lowmc, proof);
+      return 0;
     }
-    proof->views[i][1 + lowmc->r].s[0] = mzd_local_init(1, lowmc->n);
-    proof->views[i][1 + lowmc->r].s[1] = mzd_from_char_array(temp, full_mzd_size, lowmc->n);
-    temp += full_mzd_size;
-    proof->views[i][1 + lowmc->r].s[2] = NULL;
+
+    memset(store, 0, SC_VERIFY * party_size * sizeof(word));
+    view_assign(lowmc, proof->views[i], store, SC_VERIFY);
+
+    temp = proof_parse_round(lowmc, proof->views[i], proof->keys[i], proof->r[i],
+                             getChAt(proof->ch, i), temp, &aes_prng);
+  }
+  aes_prng_clear(&aes_prng);
+
+  return temp - data;
+}
+
+proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned char* data,
+                               unsigned* len, bool contains_ch) {
+  proof_t* new_proof = NULL;
+  if (!proof) {
+    proof = new_proof = calloc(sizeof(proof_t), 1);
+  }
+
+  *len = proof_parse(lowmc, proof, data, SIZE_MAX, contains_ch);
+  if (!*len) {
+    free(new_proof);
+    return NULL;
   }
 
   return proof;
@@ -164,13 +263,23 @@ proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
                       unsigned char ch[NUM_ROUNDS],
                       unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH],
                       unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE],
-                      view_t* const views[NUM_ROUNDS]) {
-  if (!proof)
-    proof = calloc(sizeof(proof_t), 1);
+                      view_t* const views[NUM_ROUNDS], mzd_arena_t* arena) {
+  proof_t* new_proof = NULL;
+  if (!proof) {
+    proof = new_proof = calloc(sizeof(proof_t), 1);
+    if (!proof) {
+      mzd_arena_clear(arena);
+      return NULL;
+    }
+  }
 
   const size_t num_views  = 2 + lowmc->r;
   const size_t last_round = 1 + lowmc->r;
 
+  // unused views stay in the arena until the proof is cleared
+  proof->arena = *arena;
+  arena->head  = NULL;
+
   for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
     unsigned int a = ch[i];
     unsigned int b = (a + 1) % 3;
@@ -184,25 +293,70 @@ proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
     memcpy(proof->keys[i][0], keys[i][a], PRNG_KEYSIZE);
     memcpy(proof->keys[i][1], keys[i][b], PRNG_KEYSIZE);
 
-    proof->views[i]         = malloc(num_views * sizeof(view_t));
+    proof->views[i] = mzd_arena_alloc(&proof->arena, num_views * sizeof(view_t));
+    if (!proof->views[i]) {
+      clear_proof(lowmc, proof);
+      free(new_proof);
+      return NULL;
+    }
+    proof->views[i][0].s[0] = views[i][0].s[a];
+    proof->views[i][0].s[1] = views[i][0].s[b];
+    proof->views[i][0].s[2] = NULL;
+    for (unsigned j = 1; j < last_round; j++) {
+      proof->views[i][j].s[0] = views[i][j].s[b];
+      // Note that this reference is not serialized withing proof_to_char_array
+      proof->views[i][j].s[1] = views[i][j].s[a];
+      proof->views[i][j].s[2] = NULL;
+    }
+    proof->views[i][last_round].s[0] = NULL;
+    proof->views[i][last_round].s[1] = views[i][last_round].s[b];
+    proof->views[i][last_round].s[2] = NULL;
+
+    const unsigned int idx   = i / 4;
+    const unsigned int shift = (i % 4) << 1;
+
+    proof->ch[idx] |= a << shift;
+  }
+
+  return proof;
+}
+
+proof_t* create_proof_ref(proof_t* proof, mpc_lowmc_t const* lowmc,
+                          unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH],
+                          unsigned char ch[NUM_ROUNDS],
+                          unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH],
+                          unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE],
+                          view_t* const views[NUM_ROUNDS], view_t* view_storage) {
+  const size_t num_views  = 2 + lowmc->r;
+  const size_t last_round = 1 + lowmc->r;
+
+  memset(proof->ch, 0, sizeof(proof->ch));
+  for (unsigned int i = 0; i < NUM_ROUNDS; i++, view_storage += num_views) {
+    unsigned int a = ch[i];
+    unsigned int b = (a + 1) % 3;
+    unsigned int c = (a + 2) % 3;
+
+    memcpy(proof->hashes[i], hashes[i][c], COMMITMENT_LENGTH);
+
+    memcpy(proof->r[i][0], r[i][a], COMMITMENT_RAND_LENGTH);
+    memcpy(proof->r[i][1], r[i][b], COMMITMENT_RAND_LENGTH);
+
+    memcpy(proof->keys[i][0], keys[i][a], PRNG_KEYSIZE);
+    memcpy(proof->keys[i][1], keys[i][b], PRNG_KEYSIZE);
+
+    // same selection of views as in create_proof
+    proof->views[i]         = view_storage;
     proof->views[i][0].s[0] = views[i][0].s[a];
     proof->views[i][0].s[1] = views[i][0].s[b];
     proof->views[i][0].s[2] = NULL;
-    mzd_local_free(views[i][0].s[c]);
     for (unsigned j = 1; j < last_round; j++) {
       proof->views[i][j].s[0] = views[i][j].s[b];
-      // we keep the reference to this pointer here and free it later
-      // to circumvent the need for two clear functions. Note that
-      // this reference is not serialized withing proof_to_char_array
       proof->views[i][j].s[1] = views[i][j].s[a];
       proof->views[i][j].s[2] = NULL;
-      mzd_local_free(views[i][j].s[c]);
     }
     proof->views[i][last_round].s[0] = NULL;
     proof->views[i][last_round].s[1] = views[i][last_round].s[b];
     proof->views[i][last_round].s[2] = NULL;
-    mzd_local_free(views[i][last_round].s[a]);
-    mzd_local_free(views[i][last_round].s[c]);
 
     const unsigned int idx   = i / 4;
     const unsigned int shift = (i % 4) << 1;
@@ -245,7 +399,7 @@ proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
   mpc_xor(out, out, vars->x0s, sc);                                                                \
   mpc_xor(out, out, vars->x1s, sc)
 
-static void _mpc_sbox_layer_bitsliced(mzd_t** out, mzd_t* const* in, view_t* view,
+static void _mpc_sbox_layer_bitsliced(mzd_t** out, mzd_t* const* in, view_t const* view,
                                       mzd_t* const* rvec, mask_t const* mask,
                                       sbox_vars_t const* vars) {
   bitsliced_step_1(SC_PROOF);
@@ -269,6 +423,125 @@ static void _mpc_sbox_layer_bitsliced_verify(mzd_t** out, mzd_t* const* in, view
   bitsliced_step_2(SC_VERIFY);
 }
 
+/**
+ * mpc_and and mpc_and_verify for shares of width words.
+ */
+FN_ATTRIBUTES_FIXED void mpc_and_fixed(word res[][MZD_FIXED_MAX_WIDTH],
+                                       word const first[][MZD_FIXED_MAX_WIDTH],
+                                       word const second[][MZD_FIXED_MAX_WIDTH],
+                                       word const r[][MZD_FIXED_MAX_WIDTH], view_t const* view,
+                                       word const* mask, const unsigned int viewshift,
+                                       const unsigned int sc, const unsigned int width) {
+  const unsigned int count = sc == SC_PROOF ? SC_PROOF : SC_VERIFY - 1;
+  for (unsigned int m = 0; m < count; ++m) {
+    const unsigned int j = (m + 1) % SC_PROOF;
+
+    for (unsigned int i = 0; i < width; ++i) {
+      res[m][i] = (first[m][i] & (second[m][i] ^ second[j][i])) ^ (first[j][i] & second[m][i]) ^
+                  r[m][i] ^ r[j][i];
+    }
+
+    word tmp[MZD_FIXED_MAX_WIDTH];
+    mzd_fixed_shift_right(tmp, res[m], viewshift, width);
+    mzd_fixed_xor(view->s[m], view->s[m], tmp, width);
+  }
+
+  if (sc == SC_VERIFY) {
+    mzd_fixed_shift_left(res[SC_VERIFY - 1], view->s[SC_VERIFY - 1], viewshift, width);
+    mzd_fixed_and(res[SC_VERIFY - 1], res[SC_VERIFY - 1], mask, width);
+  }
+}
+
+/**
+ * The S-box layer of _mpc_sbox_layer_bitsliced and _mpc_sbox_layer_bitsliced_verify for states of
+ * width words. The intermediate values are kept on the stack instead of in sbox_vars_t.
+ */
+FN_ATTRIBUTES_FIXED void mpc_sbox_layer_fixed(mzd_t** out, mzd_t* const* in, view_t const* view,
+                                              mzd_t* const* rvec, mask_t const* mask,
+                                              const unsigned int sc, const unsigned int width) {
+  word r0m[SC_PROOF][MZD_FIXED_MAX_WIDTH], r0s[SC_PROOF][MZD_FIXED_MAX_WIDTH];
+  word r1m[SC_PROOF][MZD_FIXED_MAX_WIDTH], r1s[SC_PROOF][MZD_FIXED_MAX_WIDTH];
+  word r2m[SC_PROOF][MZD_FIXED_MAX_WIDTH], x0s[SC_PROOF][MZD_FIXED_MAX_WIDTH];
+  word x1s[SC_PROOF][MZD_FIXED_MAX_WIDTH], x2m[SC_PROOF][MZD_FIXED_MAX_WIDTH];
+
+  word const* mx0 = CONST_FIRST_ROW(mask->x0);
+  word const* mx1 = CONST_FIRST_ROW(mask->x1);
+  word const* mx2 = CONST_FIRST_ROW(mask->x2);
+
+  for (unsigned int m = 0; m < sc; ++m) {
+    word const* inm   = CONST_FIRST_ROW(in[m]);
+    word const* rvecm = CONST_FIRST_ROW(rvec[m]);
+
+    mzd_fixed_and(x0s[m], inm, mx0, width);
+    mzd_fixed_and(x1s[m], inm, mx1, width);
+    mzd_fixed_and(x2m[m], inm, mx2, width);
+
+    mzd_fixed_shift_left(x0s[m], x0s[m], 2, width);
+    mzd_fixed_shift_left(x1s[m], x1s[m], 1, width);
+
+    mzd_fixed_and(r0m[m], rvecm, mx0, width);
+    mzd_fixed_and(r1m[m], rvecm, mx1, width);
+    mzd_fixed_and(r2m[m], rvecm, mx2, width);
+
+    mzd_fixed_shift_left(r0s[m], r0m[m], 2, width);
+    mzd_fixed_shift_left(r1s[m], r1m[m], 1, width);
+  }
+
+  mpc_and_fixed(r0m, x0s, x1s, r2m, view, mx2, 0, sc, width);
+  mpc_and_fixed(r2m, x1s, x2m, r0s, view, mx2, 2, sc, width);
+  mpc_and_fixed(r1m, x0s, x2m, r1s, view, mx2, 1, sc, width);
+
+  word const* maskm = CONST_FIRST_ROW(mask->mask);
+  for (unsigned int m = 0; m < sc; ++m) {
+    word tmp1[MZD_FIXED_MAX_WIDTH], tmp2[MZD_FIXED_MAX_WIDTH], tmp3[MZD_FIXED_MAX_WIDTH];
+    word* outm = FIRST_ROW(out[m]);
+
+    mzd_fixed_xor(tmp1, r2m[m], x0s[m], width);
+    mzd_fixed_xor(tmp2, x0s[m], x1s[m], width);
+    mzd_fixed_xor(tmp3, tmp2, r1m[m], width);
+
+    mzd_fixed_xor(tmp2, tmp2, r0m[m], width);
+    mzd_fixed_xor(tmp2, tmp2, x2m[m], width);
+
+    mzd_fixed_shift_right(tmp1, tmp1, 2, width);
+    mzd_fixed_shift_right(tmp3, tmp3, 1, width);
+
+    mzd_fixed_and(outm, maskm, CONST_FIRST_ROW(in[m]), width);
+    mzd_fixed_xor(outm, outm, tmp2, width);
+    mzd_fixed_xor(outm, outm, tmp1, width);
+    mzd_fixed_xor(outm, outm, tmp3, width);
+  }
+}
+
+/**
+ * Instantiates mpc_sbox_layer_fixed for block size n as name_n and name_n_verify.
+ */
+#define mpc_sbox_layer_fixed_instantiate(attr, name, n)                                            \
+  attr static void name##_##n(mzd_t** out, mzd_t* const* in, view_t const* view,                  \
+                              mzd_t* const* rvec, mask_t const* mask, sbox_vars_t const* vars) {  \
+    (void)vars;                                                                                    \
+    mpc_sbox_layer_fixed(out, in, view, rvec, mask, SC_PROOF, (n) / (sizeof(word) * 8));          \
+  }                                                                                                \
+  attr static void name##_##n##_verify(mzd_t** out, mzd_t* const* in, view_t const* view,         \
+                                       mzd_t* const* rvec, mask_t const* mask,                     \
+                                       sbox_vars_t const* vars) {                                  \
+    (void)vars;                                                                                    \
+    mpc_sbox_layer_fixed(out, in, view, rvec, mask, SC_VERIFY, (n) / (sizeof(word) * 8));         \
+  }
+
+mpc_sbox_layer_fixed_instantiate(, _mpc_sbox_layer_fixed, 128)
+mpc_sbox_layer_fixed_instantiate(, _mpc_sbox_layer_fixed, 192)
+mpc_sbox_layer_fixed_instantiate(, _mpc_sbox_layer_fixed, 256)
+mpc_sbox_layer_fixed_instantiate(, _mpc_sbox_layer_fixed, 384)
+mpc_sbox_layer_fixed_instantiate(, _mpc_sbox_layer_fixed, 512)
+
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+mpc_sbox_layer_fixed_instantiate(__attribute__((target("avx2"))), _mpc_sbox_layer_fixed_avx, 384)
+mpc_sbox_layer_fixed_instantiate(__attribute__((target("avx2"))), _mpc_sbox_layer_fixed_avx, 512)
+#endif
+
+#undef mpc_sbox_layer_fixed_instantiate
+
 #ifdef WITH_OPT
 #define bitsliced_mm_step_1(sc, type, and, shift_left)                                             \
   type r0m[sc] __attribute__((aligned(alignof(type))));                                            \
@@ -339,7 +612,8 @@ static void _mpc_sbox_layer_bitsliced_verify(mzd_t** out, mzd_t* const* in, view
 #ifdef WITH_SSE2
 __attribute__((target("sse2"))) static void
 _mpc_sbox_layer_bitsliced_sse(mzd_t** out, mzd_t* const* in, view_t const* view, mzd_t* const* rvec,
-                              mask_t const* mask) {
+                              mask_t const* mask, sbox_vars_t const* vars) {
+  (void)vars;
   bitsliced_mm_step_1(SC_PROOF, __m128i, _mm_and_si128, mm128_shift_left);
 
   mpc_and_sse(r0m, x0s, x1s, r2m, view, 0);
@@ -351,7 +625,9 @@ _mpc_sbox_layer_bitsliced_sse(mzd_t** out, mzd_t* const* in, view_t const* view,
 
 __attribute__((target("sse2"))) static void
 _mpc_sbox_layer_bitsliced_sse_verify(mzd_t** out, mzd_t* const* in, view_t const* view,
-                                     mzd_t** rvec, mask_t const* mask) {
+                                     mzd_t* const* rvec, mask_t const* mask,
+                                     sbox_vars_t const* vars) {
+  (void)vars;
   bitsliced_mm_step_1(SC_VERIFY, __m128i, _mm_and_si128, mm128_shift_left);
 
   mpc_and_verify_sse(r0m, x0s, x1s, r2m, view, mx2, 0);
@@ -365,7 +641,8 @@ _mpc_sbox_layer_bitsliced_sse_verify(mzd_t** out, mzd_t* const* in, view_t const
 #ifdef WITH_AVX2
 __attribute__((target("avx2"))) static void
 _mpc_sbox_layer_bitsliced_avx(mzd_t** out, mzd_t* const* in, view_t const* view, mzd_t* const* rvec,
-                              mask_t const* mask) {
+                              mask_t const* mask, sbox_vars_t const* vars) {
+  (void)vars;
   bitsliced_mm_step_1(SC_PROOF, __m256i, _mm256_and_si256, mm256_shift_left);
 
   mpc_and_avx(r0m, x0s, x1s, r2m, view, 0);
@@ -376,8 +653,10 @@ _mpc_sbox_layer_bitsliced_avx(mzd_t** out, mzd_t* const* in, view_t const* view,
 }
 
 __attribute__((target("avx2"))) static void
-_mpc_sbox_layer_bitsliced_avx_verify(mzd_t** out, mzd_t** in, view_t const* view,
-                                     mzd_t* const* rvec, mask_t const* mask) {
+_mpc_sbox_layer_bitsliced_avx_verify(mzd_t** out, mzd_t* const* in, view_t const* view,
+                                     mzd_t* const* rvec, mask_t const* mask,
+                                     sbox_vars_t const* vars) {
+  (void)vars;
   bitsliced_mm_step_1(SC_VERIFY, __m256i, _mm256_and_si256, mm256_shift_left);
 
   mpc_and_verify_avx(r0m, x0s, x1s, r2m, view, mx2, 0);
@@ -386,6 +665,69 @@ _mpc_sbox_layer_bitsliced_avx_verify(mzd_t** out, mzd_t** in, view_t const* view
 
   bitsliced_mm_step_2(SC_VERIFY, __m256i, _mm256_and_si256, _mm256_xor_si256, mm256_shift_right);
 }
+
+/**
+ * S-box layer of two independent repetitions with n <= 128. The states of the first repetition
+ * are stored in the lower and the states of the second one in the upper 128 bit of the registers.
+ */
+__attribute__((target("avx2"))) static void
+_mpc_sbox_layer_bitsliced_avx_x2(mzd_t** const out[2], mzd_t** const in[2],
+                                 view_t const* const view[2], mzd_t** const rvec[2],
+                                 mask_t const* mask) {
+  const __m256i mx0 = _mm256_broadcastsi128_si256(
+      *(__m128i const*)__builtin_assume_aligned(CONST_FIRST_ROW(mask->x0), 16));
+  const __m256i mx1 = _mm256_broadcastsi128_si256(
+      *(__m128i const*)__builtin_assume_aligned(CONST_FIRST_ROW(mask->x1), 16));
+  const __m256i mx2 = _mm256_broadcastsi128_si256(
+      *(__m128i const*)__builtin_assume_aligned(CONST_FIRST_ROW(mask->x2), 16));
+  const __m256i maskm = _mm256_broadcastsi128_si256(
+      *(__m128i const*)__builtin_assume_aligned(CONST_FIRST_ROW(mask->mask), 16));
+
+  __m256i inm[SC_PROOF], r0m[SC_PROOF], r0s[SC_PROOF], r1m[SC_PROOF], r1s[SC_PROOF],
+      r2m[SC_PROOF], x0s[SC_PROOF], x1s[SC_PROOF], x2m[SC_PROOF];
+
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    inm[m] = mm256_load_x2(CONST_FIRST_ROW(in[0][m]), CONST_FIRST_ROW(in[1][m]));
+    const __m256i rvecm =
+        mm256_load_x2(CONST_FIRST_ROW(rvec[0][m]), CONST_FIRST_ROW(rvec[1][m]));
+
+    __m256i tmp1 = _mm256_and_si256(inm[m], mx0);
+    __m256i tmp2 = _mm256_and_si256(inm[m], mx1);
+    x2m[m]       = _mm256_and_si256(inm[m], mx2);
+
+    x0s[m] = mm256_shift_left_x2(tmp1, 2);
+    x1s[m] = mm256_shift_left_x2(tmp2, 1);
+
+    r0m[m] = tmp1 = _mm256_and_si256(rvecm, mx0);
+    r1m[m] = tmp2 = _mm256_and_si256(rvecm, mx1);
+    r2m[m]        = _mm256_and_si256(rvecm, mx2);
+
+    r0s[m] = mm256_shift_left_x2(tmp1, 2);
+    r1s[m] = mm256_shift_left_x2(tmp2, 1);
+  }
+
+  mpc_and_avx_x2(r0m, x0s, x1s, r2m, view[0], view[1], 0);
+  mpc_and_avx_x2(r2m, x1s, x2m, r0s, view[0], view[1], 2);
+  mpc_and_avx_x2(r1m, x0s, x2m, r1s, view[0], view[1], 1);
+
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    __m256i tmp1 = _mm256_xor_si256(r2m[m], x0s[m]);
+    __m256i tmp2 = _mm256_xor_si256(x0s[m], x1s[m]);
+    __m256i tmp3 = _mm256_xor_si256(tmp2, r1m[m]);
+
+    __m256i mout = _mm256_and_si256(maskm, inm[m]);
+
+    __m256i tmp4 = _mm256_xor_si256(tmp2, r0m[m]);
+    tmp4         = _mm256_xor_si256(tmp4, x2m[m]);
+    mout         = _mm256_xor_si256(mout, tmp4);
+
+    tmp2 = mm256_shift_right_x2(tmp1, 2);
+    mout = _mm256_xor_si256(mout, tmp2);
+
+    tmp1 = mm256_shift_right_x2(tmp3, 1);
+    mm256_store_x2(FIRST_ROW(out[0][m]), FIRST_ROW(out[1][m]), _mm256_xor_si256(mout, tmp1));
+  }
+}
 #endif
 #endif
 
@@ -489,68 +831,282 @@ static mzd_t** _mpc_lowmc_call(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_
 }
 #endif
 
-static mzd_t** _mpc_lowmc_call_bitsliced(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
-                                         mzd_t const* p, view_t* views, mzd_t*** rvec,
-                                         unsigned ch) {
-  mpc_copy(views->s, lowmc_key->shared, SC_PROOF);
-  ++views;
+/**
+ * Adds the shares of the round key of round i to x. The shares of the key schedule are stored with
+ * stride sc as filled by lowmc_expand_key.
+ */
+static void mpc_lowmc_add_round_key(mpc_lowmc_t const* lowmc, mzd_t** x, mzd_t* const* round_keys,
+                                    unsigned int i, unsigned int sc) {
+  for (unsigned int j = 0; j < sc; ++j) {
+    lowmc_add_round_key(lowmc, x[j], &round_keys[j], i, sc);
+  }
+}
 
-  sbox_vars_t vars = {{NULL}};
-  sbox_vars_init(&vars, lowmc->n, SC_PROOF);
+/**
+ * Evaluates the linear layer of round i on the shares y, stores the result in x and adds the
+ * constant of the round to the share ch.
+ */
+static void mpc_lowmc_linear_layer(mpc_lowmc_t const* lowmc, mzd_t** x, mzd_t* const* y,
+                                   unsigned int i, unsigned int sc, unsigned int ch) {
+  for (unsigned int j = 0; j < sc; ++j) {
+    lowmc_linear_layer(lowmc, x[j], y[j], i);
+  }
+  mpc_const_add(x, x, lowmc_round_constant(lowmc, i), sc, ch);
+}
 
-  mzd_t** x = mpc_init_empty_share_vector(lowmc->n, SC_PROOF);
-  mzd_t* y[SC_PROOF];
-  mzd_local_init_multiple_ex(y, SC_PROOF, 1, lowmc->n, false);
+/**
+ * Computes the key schedules of all shares of the key. The i-th vector of the schedule of the j-th
+ * share is stored in round_keys[i * sc + j]. The key schedule is linear in the key. Hence, if the
+ * schedule of the key itself is known, the schedule of the last share follows from those of the
+ * other shares without any matrix-vector products.
+ *
+ * \param key_schedule the key schedule of the key or NULL
+ */
+static void mpc_lowmc_expand_key(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t const* lowmc_key,
+                                 mzd_t* const* key_schedule, mzd_t** round_keys, unsigned int sc) {
+  const unsigned int expanded = key_schedule ? sc - 1 : sc;
+  for (unsigned int j = 0; j < expanded; ++j) {
+    lowmc_expand_key(lowmc, lowmc_key->shared[j], &round_keys[j], sc);
+  }
 
-#ifdef NOSCR
-  mpc_const_mat_mul_l(x, lowmc->k0_lookup, lowmc_key->shared, SC_PROOF);
-#else
-  mpc_const_mat_mul(x, lowmc->k0_matrix, lowmc_key->shared, SC_PROOF);
-#endif
-  mpc_const_add(x, x, p, SC_PROOF, ch);
+  if (key_schedule) {
+    const unsigned int length = lowmc_key_schedule_length(lowmc);
+    for (unsigned int i = 0; i < length; ++i) {
+      mzd_t** round_key = &round_keys[i * sc];
+      mzd_xor(round_key[sc - 1], key_schedule[i], round_key[0]);
+      for (unsigned int j = 1; j < sc - 1; ++j) {
+        mzd_xor(round_key[sc - 1], round_key[sc - 1], round_key[j]);
+      }
+    }
+  }
+}
 
-  lowmc_round_t const* round = lowmc->rounds;
-  for (unsigned i = 0; i < lowmc->r; ++i, ++views, ++round) {
-    // TODO: fix for SC_PROOF != 3
-    mzd_t* r[SC_PROOF] = {rvec[0][i], rvec[1][i], rvec[2][i]};
+#if defined(WITH_OPT) && defined(WITH_AVX2) && defined(NOSCR)
+/**
+ * mpc_and_avx for operands held in registers.
+ */
+__attribute__((target("avx2"), always_inline)) static inline void
+mpc_and_avx_reg(__m256i res[SC_PROOF], __m256i const first[SC_PROOF],
+                __m256i const second[SC_PROOF], __m256i const r[SC_PROOF], view_t const* view,
+                const unsigned int viewshift) {
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    const unsigned int j = (m + 1) % SC_PROOF;
 
-#ifdef WITH_OPT
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && lowmc->n <= 128) {
-      _mpc_sbox_layer_bitsliced_sse(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && lowmc->n <= 256) {
-      _mpc_sbox_layer_bitsliced_avx(y, x, views, r, &lowmc->mask);
-    } else
+    __m256i* sm = __builtin_assume_aligned(view->s[m], 32);
+
+    __m256i tmp1 = _mm256_xor_si256(second[m], second[j]);
+    __m256i tmp2 = _mm256_and_si256(first[j], second[m]);
+    tmp1         = _mm256_and_si256(tmp1, first[m]);
+    tmp1         = _mm256_xor_si256(tmp1, tmp2);
+
+    tmp2   = _mm256_xor_si256(r[m], r[j]);
+    res[m] = tmp1 = _mm256_xor_si256(tmp1, tmp2);
+
+    *sm = _mm256_xor_si256(mm256_shift_right(tmp1, viewshift), *sm);
+  }
+}
+
+#define mm256_first_row(v) (*(__m256i const*)__builtin_assume_aligned(CONST_FIRST_ROW(v), 32))
+
+/**
+ * Evaluates all rounds of the prover for n = 256. The states of the three shares stay in AVX2
+ * registers for the whole encryption: the key addition, the S-box layer, the product with the
+ * lookup table of the linear layer and the constant addition of a round are evaluated without
+ * storing intermediate states. Only the outputs of the AND gates are written to the views and the
+ * output shares to x and the last view.
+ */
+__attribute__((target("avx2"))) static inline void
+mpc_rounds_avx_256(lowmc_t const* lowmc, mzd_t** x, mzd_t const* p, view_t* views, mzd_t*** rvec,
+                   mzd_t* const* round_keys, unsigned int ch, const unsigned int bits) {
+  const __m256i mx0        = mm256_first_row(lowmc->mask.x0);
+  const __m256i mx1        = mm256_first_row(lowmc->mask.x1);
+  const __m256i mx2        = mm256_first_row(lowmc->mask.x2);
+  const __m256i maskm      = mm256_first_row(lowmc->mask.mask);
+  const unsigned int moff2 = 1 << bits;
+  const word combmask      = moff2 - 1;
+#ifdef REDUCED_ROUND_KEYS
+  // the rrk_words words of the reduced round key are loaded into the lowest lanes and rotated up to
+  // the lanes starting at rrk_word. The lanes below rrk_word receive the upper lanes, which the
+  // masked load cleared, since rrk_word + rrk_words <= 4.
+  const __m256i rrk_load = _mm256_cmpgt_epi64(_mm256_set1_epi64x(lowmc->rrk_words),
+                                              _mm256_set_epi64x(3, 2, 1, 0));
+  const __m256i rrk_perm = _mm256_sub_epi32(_mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0),
+                                            _mm256_set1_epi32(2 * lowmc->rrk_word));
 #endif
+
+  __m256i s[SC_PROOF];
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    s[m] = m == ch ? mm256_first_row(p) : _mm256_setzero_si256();
+  }
+
+  lowmc_round_t const* round = lowmc->rounds;
+  for (unsigned int i = 0; i < lowmc->r; ++i, ++views, ++round) {
+    __m256i r0m[SC_PROOF], r0s[SC_PROOF], r1m[SC_PROOF], r1s[SC_PROOF], r2m[SC_PROOF],
+        x0s[SC_PROOF], x1s[SC_PROOF], x2m[SC_PROOF];
+
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+#ifdef REDUCED_ROUND_KEYS
+      long long const* kptr =
+          (long long const*)(CONST_FIRST_ROW(round_keys[m]) + i * lowmc->rrk_words);
+      const __m256i key = _mm256_maskload_epi64(kptr, rrk_load);
+      s[m]              = _mm256_xor_si256(s[m], _mm256_permutevar8x32_epi32(key, rrk_perm));
+#else
+      s[m] = _mm256_xor_si256(s[m], mm256_first_row(round_keys[i * SC_PROOF + m]));
 #endif
-    {
-      _mpc_sbox_layer_bitsliced(y, x, views, r, &lowmc->mask, &vars);
+      const __m256i rvecm = mm256_first_row(rvec[m][i]);
+
+      __m256i tmp1 = _mm256_and_si256(s[m], mx0);
+      __m256i tmp2 = _mm256_and_si256(s[m], mx1);
+      x2m[m]       = _mm256_and_si256(s[m], mx2);
+
+      x0s[m] = mm256_shift_left(tmp1, 2);
+      x1s[m] = mm256_shift_left(tmp2, 1);
+
+      r0m[m] = tmp1 = _mm256_and_si256(rvecm, mx0);
+      r1m[m] = tmp2 = _mm256_and_si256(rvecm, mx1);
+      r2m[m]        = _mm256_and_si256(rvecm, mx2);
+
+      r0s[m] = mm256_shift_left(tmp1, 2);
+      r1s[m] = mm256_shift_left(tmp2, 1);
     }
 
-#ifdef NOSCR
-    mpc_const_mat_mul_l(x, round->l_lookup, y, SC_PROOF);
+    mpc_and_avx_reg(r0m, x0s, x1s, r2m, views, 0);
+    mpc_and_avx_reg(r2m, x1s, x2m, r0s, views, 2);
+    mpc_and_avx_reg(r1m, x0s, x2m, r1s, views, 1);
+
+    word y[SC_PROOF][4] __attribute__((aligned(32)));
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      __m256i tmp1 = _mm256_xor_si256(r2m[m], x0s[m]);
+      __m256i tmp2 = _mm256_xor_si256(x0s[m], x1s[m]);
+      __m256i tmp3 = _mm256_xor_si256(tmp2, r1m[m]);
+
+      __m256i mout = _mm256_and_si256(maskm, s[m]);
+
+      __m256i tmp4 = _mm256_xor_si256(tmp2, r0m[m]);
+      tmp4         = _mm256_xor_si256(tmp4, x2m[m]);
+      mout         = _mm256_xor_si256(mout, tmp4);
+
+      tmp2 = mm256_shift_right(tmp1, 2);
+      mout = _mm256_xor_si256(mout, tmp2);
+
+      tmp1 = mm256_shift_right(tmp3, 1);
+      _mm256_store_si256((__m256i*)y[m], _mm256_xor_si256(mout, tmp1));
+
+      // the constant is added to the share ch only
+      s[m] = m == ch ? mm256_first_row(round->constant) : _mm256_setzero_si256();
+    }
+
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      __m256i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(round->l_lookup), 32);
+      __m256i mc           = s[m];
+      for (unsigned int w = 0; w < 4; ++w) {
+        word idx = y[m][w];
+        for (unsigned int c = sizeof(word) * 8 / bits; c; --c, idx >>= bits, mAptr += moff2) {
+          mc = _mm256_xor_si256(mc, mAptr[idx & combmask]);
+        }
+      }
+      s[m] = mc;
+    }
+  }
+
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+#ifdef REDUCED_ROUND_KEYS
+    mzd_t const* round_key = round_keys[SC_PROOF + m];
 #else
-    mpc_const_mat_mul(x, round->l_matrix, y, SC_PROOF);
+    mzd_t const* round_key = round_keys[lowmc->r * SC_PROOF + m];
 #endif
-    mpc_const_add(x, x, round->constant, SC_PROOF, ch);
-#ifdef NOSCR
-    mpc_const_addmat_mul_l(x, round->k_lookup, lowmc_key->shared, SC_PROOF);
-#else
-    mpc_const_mat_mul(y, round->k_matrix, lowmc_key->shared, SC_PROOF);
-    mpc_add(x, x, y, SC_PROOF);
+    s[m] = _mm256_xor_si256(s[m], mm256_first_row(round_key));
+    *(__m256i*)__builtin_assume_aligned(FIRST_ROW(x[m]), 32) = s[m];
+    *(__m256i*)__builtin_assume_aligned(views->s[m], 32)      = s[m];
+  }
+}
+
+#define mpc_rounds_instantiate(attr, name, expr)                                                   \
+  attr static void name##_4(lowmc_t const* lowmc, mzd_t** x, mzd_t const* p, view_t* views,       \
+                            mzd_t*** rvec, mzd_t* const* round_keys, unsigned int ch) {            \
+    const unsigned int bits = 4;                                                                   \
+    expr;                                                                                          \
+  }                                                                                                \
+  attr static void name##_8(lowmc_t const* lowmc, mzd_t** x, mzd_t const* p, view_t* views,       \
+                            mzd_t*** rvec, mzd_t* const* round_keys, unsigned int ch) {            \
+    const unsigned int bits = 8;                                                                   \
+    expr;                                                                                          \
+  }
+
+mpc_rounds_instantiate(__attribute__((target("avx2"))), mpc_rounds_avx_256,
+                       mpc_rounds_avx_256(lowmc, x, p, views, rvec, round_keys, ch, bits))
+
+#undef mpc_rounds_instantiate
+#undef mm256_first_row
 #endif
+
+static void _mpc_lowmc_call_bitsliced(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
+                                      mzd_t const* p, view_t* views, mzd_t*** rvec, unsigned ch,
+                                      mzd_t** x, mzd_t** y, sbox_vars_t* vars,
+                                      mzd_t* const* round_keys) {
+  mpc_copy_to_view(views->s, lowmc_key->shared, SC_PROOF);
+  ++views;
+
+  if (lowmc->kernels.mpc_rounds) {
+    lowmc->kernels.mpc_rounds(lowmc, x, p, views, rvec, round_keys, ch);
+    return;
   }
 
-  mpc_copy(views->s, x, SC_PROOF);
-  sbox_vars_clear(&vars);
+  mpc_clear(x, SC_PROOF);
+  mpc_const_add(x, x, p, SC_PROOF, ch);
 
-  mzd_local_free_multiple(y);
-  return x;
+  for (unsigned i = 0; i < lowmc->r; ++i, ++views) {
+    // TODO: fix for SC_PROOF != 3
+    mzd_t* r[SC_PROOF] = {rvec[0][i], rvec[1][i], rvec[2][i]};
+
+    mpc_lowmc_add_round_key(lowmc, x, round_keys, i, SC_PROOF);
+    lowmc->kernels.mpc_sbox(y, x, views, r, &lowmc->mask, vars);
+    mpc_lowmc_linear_layer(lowmc, x, y, i, SC_PROOF, ch);
+  }
+  mpc_lowmc_add_round_key(lowmc, x, round_keys, lowmc->r, SC_PROOF);
+
+  mpc_copy_to_view(views->s, x, SC_PROOF);
 }
 
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+/**
+ * Runs two repetitions in lockstep such that their S-box layers share the AVX2 registers. Only
+ * valid for n <= 128.
+ */
+static void _mpc_lowmc_call_bitsliced_x2(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key[2],
+                                         mzd_t const* p, view_t* views[2], mzd_t*** const rvec[2],
+                                         mzd_t** x[2], mzd_t** y[2], mzd_t** round_keys[2]) {
+  for (unsigned int k = 0; k < 2; ++k) {
+    mpc_copy_to_view(views[k]->s, lowmc_key[k]->shared, SC_PROOF);
+
+    mpc_clear(x[k], SC_PROOF);
+    mpc_const_add(x[k], x[k], p, SC_PROOF, 0);
+  }
+
+  for (unsigned i = 0; i < lowmc->r; ++i) {
+    // TODO: fix for SC_PROOF != 3
+    mzd_t* r0[SC_PROOF]          = {rvec[0][0][i], rvec[0][1][i], rvec[0][2][i]};
+    mzd_t* r1[SC_PROOF]          = {rvec[1][0][i], rvec[1][1][i], rvec[1][2][i]};
+    mzd_t** r[2]                 = {r0, r1};
+    view_t const* round_views[2] = {&views[0][1 + i], &views[1][1 + i]};
+
+    for (unsigned int k = 0; k < 2; ++k) {
+      mpc_lowmc_add_round_key(lowmc, x[k], round_keys[k], i, SC_PROOF);
+    }
+    lowmc->kernels.mpc_sbox_x2(y, x, round_views, r, &lowmc->mask);
+
+    for (unsigned int k = 0; k < 2; ++k) {
+      mpc_lowmc_linear_layer(lowmc, x[k], y[k], i, SC_PROOF, 0);
+    }
+  }
+
+  for (unsigned int k = 0; k < 2; ++k) {
+    mpc_lowmc_add_round_key(lowmc, x[k], round_keys[k], lowmc->r, SC_PROOF);
+    mpc_copy_to_view(views[k][1 + lowmc->r].s, x[k], SC_PROOF);
+  }
+}
+#endif
+
 static mzd_t** _mpc_lowmc_call_bitsliced_verify(mpc_lowmc_t const* lowmc,
                                                 mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
                                                 view_t const* views, mzd_t*** rvec,
@@ -558,56 +1114,30 @@ static mzd_t** _mpc_lowmc_call_bitsliced_verify(mpc_lowmc_t const* lowmc,
   ++views;
 
   sbox_vars_t vars = {{NULL}};
-  sbox_vars_init(&vars, lowmc->n, SC_VERIFY);
+  sbox_vars_init(&vars, lowmc, SC_VERIFY);
 
   mzd_t** x           = mpc_init_empty_share_vector(lowmc->n, SC_VERIFY);
   mzd_t* y[SC_VERIFY] = {NULL};
   mzd_local_init_multiple_ex(y, SC_VERIFY, 1, lowmc->n, false);
 
-#ifdef NOSCR
-  mpc_const_mat_mul_l(x, lowmc->k0_lookup, lowmc_key->shared, SC_VERIFY);
-#else
-  mpc_const_mat_mul(x, lowmc->k0_matrix, lowmc_key->shared, SC_VERIFY);
-#endif
+  mzd_t** round_keys = lowmc_key_schedule_init_multiple(lowmc, SC_VERIFY);
+  mpc_lowmc_expand_key(lowmc, lowmc_key, NULL, round_keys, SC_VERIFY);
+
   mpc_const_add(x, x, p, SC_VERIFY, ch);
 
-  lowmc_round_t const* round = lowmc->rounds;
-  for (unsigned i = 0; i < lowmc->r; ++i, ++views, ++round) {
+  for (unsigned i = 0; i < lowmc->r; ++i, ++views) {
     // TODO: fix for SC_VERIFY != 2
     mzd_t* r[SC_VERIFY] = {rvec[0][i], rvec[1][i]};
 
-#ifdef WITH_OPT
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2 && lowmc->n <= 128) {
-      _mpc_sbox_layer_bitsliced_sse_verify(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2 && lowmc->n <= 256) {
-      _mpc_sbox_layer_bitsliced_avx_verify(y, x, views, r, &lowmc->mask);
-    } else
-#endif
-#endif
-    {
-      _mpc_sbox_layer_bitsliced_verify(y, x, views, r, &lowmc->mask, &vars);
-    }
-
-#ifdef NOSCR
-    mpc_const_mat_mul_l(x, round->l_lookup, y, SC_VERIFY);
-#else
-    mpc_const_mat_mul(x, round->l_matrix, y, SC_VERIFY);
-#endif
-    mpc_const_add(x, x, round->constant, SC_VERIFY, ch);
-#ifdef NOSCR
-    mpc_const_addmat_mul_l(x, round->k_lookup, lowmc_key->shared, SC_VERIFY);
-#else
-    mpc_const_mat_mul(y, round->k_matrix, lowmc_key->shared, SC_VERIFY);
-    mpc_add(x, x, y, SC_VERIFY);
-#endif
+    mpc_lowmc_add_round_key(lowmc, x, round_keys, i, SC_VERIFY);
+    lowmc->kernels.mpc_sbox_verify(y, x, views, r, &lowmc->mask, &vars);
+    mpc_lowmc_linear_layer(lowmc, x, y, i, SC_VERIFY, ch);
   }
+  mpc_lowmc_add_round_key(lowmc, x, round_keys, lowmc->r, SC_VERIFY);
 
-  mzd_copy(views->s[0], x[0]);
+  mpc_copy_to_view(views->s, x, 1);
 
+  lowmc_key_schedule_free_multiple(round_keys, SC_VERIFY);
   sbox_vars_clear(&vars);
   mzd_local_free_multiple(y);
   return x;
@@ -615,7 +1145,76 @@ static mzd_t** _mpc_lowmc_call_bitsliced_verify(mpc_lowmc_t const* lowmc,
 
 mzd_t** mpc_lowmc_call(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
                        view_t* views, mzd_t*** rvec) {
-  return _mpc_lowmc_call_bitsliced(lowmc, lowmc_key, p, views, rvec, 0);
+  sbox_vars_t vars = {{NULL}};
+  sbox_vars_init(&vars, lowmc, SC_PROOF);
+
+  mzd_t** x = mpc_init_empty_share_vector(lowmc->n, SC_PROOF);
+  mzd_t* y[SC_PROOF];
+  mzd_local_init_multiple_ex(y, SC_PROOF, 1, lowmc->n, false);
+  mzd_t** round_keys = lowmc_key_schedule_init_multiple(lowmc, SC_PROOF);
+
+  mpc_lowmc_expand_key(lowmc, lowmc_key, NULL, round_keys, SC_PROOF);
+  _mpc_lowmc_call_bitsliced(lowmc, lowmc_key, p, views, rvec, 0, x, y, &vars, round_keys);
+
+  lowmc_key_schedule_free_multiple(round_keys, SC_PROOF);
+  sbox_vars_clear(&vars);
+  mzd_local_free_multiple(y);
+  return x;
+}
+
+bool mpc_lowmc_scratch_init(mpc_lowmc_scratch_t* scratch, mpc_lowmc_t const* lowmc) {
+  const bool x        = mzd_local_init_multiple(scratch->x, SC_PROOF, 1, lowmc->n);
+  const bool y        = mzd_local_init_multiple_ex(scratch->y, SC_PROOF, 1, lowmc->n, false);
+  const bool vars     = sbox_vars_init(&scratch->vars, lowmc, SC_PROOF) != NULL;
+  scratch->round_keys = lowmc_key_schedule_init_multiple(lowmc, SC_PROOF);
+  return x && y && vars && scratch->round_keys;
+}
+
+void mpc_lowmc_scratch_clear(mpc_lowmc_scratch_t* scratch) {
+  lowmc_key_schedule_free_multiple(scratch->round_keys, SC_PROOF);
+  sbox_vars_clear(&scratch->vars);
+  mzd_local_free_multiple(scratch->y);
+  mzd_local_free_multiple(scratch->x);
+}
+
+void mpc_lowmc_call_scratch(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
+                            mzd_t* const* key_schedule, mzd_t const* p, view_t* views,
+                            mzd_t*** rvec, mpc_lowmc_scratch_t* scratch) {
+  // the and gates accumulate into the views, which are stored contiguously per party
+  for (unsigned int j = 0; j < SC_PROOF; ++j) {
+    memset(views[1].s[j], 0, lowmc->r * view_stride(lowmc) * sizeof(word));
+  }
+
+  mpc_lowmc_expand_key(lowmc, lowmc_key, key_schedule, scratch->round_keys, SC_PROOF);
+  _mpc_lowmc_call_bitsliced(lowmc, lowmc_key, p, views, rvec, 0, scratch->x, scratch->y,
+                            &scratch->vars, scratch->round_keys);
+}
+
+void mpc_lowmc_call_scratch_x2(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key[2],
+                               mzd_t* const* key_schedule, mzd_t const* p, view_t* views[2],
+                               mzd_t*** const rvec[2], mpc_lowmc_scratch_t* scratch[2]) {
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+  if (lowmc->kernels.mpc_sbox_x2) {
+    for (unsigned int k = 0; k < 2; ++k) {
+      for (unsigned int j = 0; j < SC_PROOF; ++j) {
+        memset(views[k][1].s[j], 0, lowmc->r * view_stride(lowmc) * sizeof(word));
+      }
+    }
+
+    mzd_t** x[2] = {scratch[0]->x, scratch[1]->x};
+    mzd_t** y[2] = {scratch[0]->y, scratch[1]->y};
+    mzd_t** round_keys[2] = {scratch[0]->round_keys, scratch[1]->round_keys};
+    for (unsigned int k = 0; k < 2; ++k) {
+      mpc_lowmc_expand_key(lowmc, lowmc_key[k], key_schedule, round_keys[k], SC_PROOF);
+    }
+    _mpc_lowmc_call_bitsliced_x2(lowmc, lowmc_key, p, views, rvec, x, y, round_keys);
+    return;
+  }
+#endif
+
+  for (unsigned int k = 0; k < 2; ++k) {
+    mpc_lowmc_call_scratch(lowmc, lowmc_key[k], key_schedule, p, views[k], rvec[k], scratch[k]);
+  }
 }
 
 static int _mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
@@ -638,11 +1237,20 @@ static int _mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_ke
   return status;
 }
 
+static void mpc_lowmc_key_from_view(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
+                                    view_t const* view) {
+  lowmc_key->share_count = SC_VERIFY;
+  mzd_local_init_multiple_ex(lowmc_key->shared, SC_PROOF, 1, lowmc->k, false);
+  for (unsigned int i = 0; i < SC_VERIFY; ++i) {
+    memcpy(FIRST_ROW(lowmc_key->shared[i]), view->s[i],
+           lowmc_key->shared[i]->width * sizeof(word));
+  }
+}
+
 int mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* views,
                      mzd_t*** rvec, int c) {
   mpc_lowmc_key_t lowmc_key;
-  mzd_shared_from_shares(&lowmc_key, views[0].s, SC_VERIFY);
-  lowmc_key.share_count = 2;
+  mpc_lowmc_key_from_view(lowmc, &lowmc_key, &views[0]);
 
   return _mpc_lowmc_verify(lowmc, &lowmc_key, p, views, rvec, c);
 }
@@ -650,12 +1258,85 @@ int mpc_lowmc_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* vie
 int mpc_lowmc_verify_keys(mpc_lowmc_t const* lowmc, mzd_t const* p, view_t const* views,
                           mzd_t*** rvec, int c, const unsigned char keys[2][16]) {
   mpc_lowmc_key_t lowmc_key;
-  mzd_shared_from_shares(&lowmc_key, views[0].s, SC_VERIFY);
-  lowmc_key.share_count = 2;
+  mpc_lowmc_key_from_view(lowmc, &lowmc_key, &views[0]);
 
   return _mpc_lowmc_verify(lowmc, &lowmc_key, p, views, rvec, c);
 }
 
+void mpc_lowmc_select_kernels(lowmc_kernels_t* kernels, rci_t n, unsigned int bits) {
+  kernels->mpc_sbox_x2 = NULL;
+  kernels->mpc_rounds  = NULL;
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+  if (CPU_SUPPORTS_AVX2 && n <= 128) {
+    kernels->mpc_sbox_x2 = _mpc_sbox_layer_bitsliced_avx_x2;
+  }
+#ifdef NOSCR
+  if (CPU_SUPPORTS_AVX2 && n == 256) {
+    kernels->mpc_rounds = bits == 4 ? mpc_rounds_avx_256_4 : mpc_rounds_avx_256_8;
+  }
+#endif
+#endif
+
+#ifdef WITH_OPT
+#ifdef WITH_SSE2
+  if (CPU_SUPPORTS_SSE2 && n <= 128) {
+    kernels->mpc_sbox        = _mpc_sbox_layer_bitsliced_sse;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_bitsliced_sse_verify;
+    kernels->mpc_sbox_vars   = false;
+    return;
+  }
+#endif
+#ifdef WITH_AVX2
+  if (CPU_SUPPORTS_AVX2 && n <= 256) {
+    kernels->mpc_sbox        = _mpc_sbox_layer_bitsliced_avx;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_bitsliced_avx_verify;
+    kernels->mpc_sbox_vars   = false;
+    return;
+  }
+  if (CPU_SUPPORTS_AVX2 && n == 384) {
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_avx_384;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_avx_384_verify;
+    kernels->mpc_sbox_vars   = false;
+    return;
+  }
+  if (CPU_SUPPORTS_AVX2 && n == 512) {
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_avx_512;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_avx_512_verify;
+    kernels->mpc_sbox_vars   = false;
+    return;
+  }
+#endif
+#endif
+
+  kernels->mpc_sbox_vars = false;
+  switch (n) {
+  case 128:
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_128;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_128_verify;
+    break;
+  case 192:
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_192;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_192_verify;
+    break;
+  case 256:
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_256;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_256_verify;
+    break;
+  case 384:
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_384;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_384_verify;
+    break;
+  case 512:
+    kernels->mpc_sbox        = _mpc_sbox_layer_fixed_512;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_fixed_512_verify;
+    break;
+  default:
+    kernels->mpc_sbox        = _mpc_sbox_layer_bitsliced;
+    kernels->mpc_sbox_verify = _mpc_sbox_layer_bitsliced_verify;
+    kernels->mpc_sbox_vars   = true;
+  }
+}
+
 void sbox_vars_clear(sbox_vars_t* vars) {
   if (vars->storage) {
     mzd_local_free_multiple(vars->storage);
@@ -664,24 +1345,20 @@ void sbox_vars_clear(sbox_vars_t* vars) {
   }
 }
 
-sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, rci_t n, unsigned sc) {
-#ifdef WITH_OPT
-#ifdef WITH_AVX2
-  if (CPU_SUPPORTS_AVX2 && n <= 256) {
-    vars->storage = NULL;
-    return vars;
-  }
-#endif
-#ifdef WITH_SSE2
-  if (CPU_SUPPORTS_SSE2 && n <= 128) {
+sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, mpc_lowmc_t const* lowmc, unsigned sc) {
+  if (!lowmc->kernels.mpc_sbox_vars) {
     vars->storage = NULL;
     return vars;
   }
-#endif
-#endif
+
+  const rci_t n = lowmc->n;
 
   vars->storage = calloc(11 * sc, sizeof(mzd_t*));
-  mzd_local_init_multiple_ex(vars->storage, 11 * sc, 1, n, false);
+  if (!vars->storage || !mzd_local_init_multiple_ex(vars->storage, 11 * sc, 1, n, false)) {
+    free(vars->storage);
+    vars->storage = NULL;
+    return NULL;
+  }
 
   for (unsigned int i = 0; i < sc; ++i) {
     vars->x0m[i] = vars->storage[11 * i + 0];
@@ -700,18 +1377,12 @@ sbox_vars_t* sbox_vars_init(sbox_vars_t* vars, rci_t n, unsigned sc) {
   return vars;
 }
 
-void clear_proof(mpc_lowmc_t const* lowmc, proof_t const* proof) {
-  const size_t numrounds = lowmc->r + 2;
+void clear_proof(mpc_lowmc_t const* lowmc, proof_t* proof) {
+  (void)lowmc;
 
-  for (unsigned int i = 0; i < NUM_ROUNDS; ++i) {
-    for (unsigned int j = 0; j < numrounds; ++j) {
-      for (unsigned int k = 0; k < SC_PROOF; ++k) {
-        mzd_local_free(proof->views[i][j].s[k]);
-        proof->views[i][j].s[k] = NULL;
-      }
-    }
-    free(proof->views[i]);
-  }
+  // all views and view arrays are stored in the arena
+  mzd_arena_clear(&proof->arena);
+  memset(proof->views, 0, sizeof(proof->views));
 }
 
 void free_proof(mpc_lowmc_t const* mpc_lowmc, proof_t* proof) {
@@ -7,12 +7,67 @@
 #include "lowmc_pars.h"
 #include "mzd_shared.h"
 #include "parameters.h"
+#include "randomness.h"
 
 typedef mzd_shared_t mpc_lowmc_key_t;
 
 typedef lowmc_t mpc_lowmc_t;
 
-typedef struct { mzd_t* s[SC_PROOF]; } view_t;
+/**
+ * One view per party. s[i] points to the words of the i-th party's view in a view store.
+ *
+ * A view store holds the views of one party and one repetition contiguously: the share of the key
+ * (view_key_stride words) followed by the r views of the S-box layers and the share of the output
+ * (view_stride words each). If the strides match the widths of the vectors, all views of a party
+ * can be hashed in one go.
+ */
+typedef struct view_s { word* s[SC_PROOF]; } view_t;
+
+size_t view_key_stride(mpc_lowmc_t const* lowmc);
+size_t view_stride(mpc_lowmc_t const* lowmc);
+/**
+ * Number of words of all views of one party in one repetition.
+ */
+size_t view_party_size(mpc_lowmc_t const* lowmc);
+
+/**
+ * Sets up the r + 2 views to point into a view store for sc parties. The store has to be 32 byte
+ * aligned and hold sc * view_party_size(lowmc) words.
+ */
+void view_assign(mpc_lowmc_t const* lowmc, view_t* views, word* store, unsigned int sc);
+
+typedef struct sbox_vars_s {
+  mzd_t* x0m[SC_PROOF];
+  mzd_t* x1m[SC_PROOF];
+  mzd_t* x2m[SC_PROOF];
+  mzd_t* r0m[SC_PROOF];
+  mzd_t* r1m[SC_PROOF];
+  mzd_t* r2m[SC_PROOF];
+  mzd_t* x0s[SC_PROOF];
+  mzd_t* r0s[SC_PROOF];
+  mzd_t* x1s[SC_PROOF];
+  mzd_t* r1s[SC_PROOF];
+  mzd_t* v[SC_PROOF];
+
+  mzd_t** storage;
+} sbox_vars_t;
+
+/**
+ * Buffers used during one MPC LowMC encryption. Allocating them once allows to run multiple
+ * encryptions without touching the heap.
+ */
+typedef struct {
+  mzd_t* x[SC_PROOF];
+  mzd_t* y[SC_PROOF];
+  sbox_vars_t vars;
+  // key schedules of the shares from lowmc_key_schedule_init_multiple
+  mzd_t** round_keys;
+} mpc_lowmc_scratch_t;
+
+/**
+ * Selects the MPC kernels for block size n and lookup tables combining bits bits per row.
+ */
+void mpc_lowmc_select_kernels(lowmc_kernels_t* kernels, rci_t n, unsigned int bits);
 
 typedef struct {
   view_t* views[NUM_ROUNDS];
@@ -20,22 +75,94 @@ typedef struct {
   unsigned char r[NUM_ROUNDS][SC_VERIFY][COMMITMENT_RAND_LENGTH];
   unsigned char hashes[NUM_ROUNDS][COMMITMENT_LENGTH];
   unsigned char ch[(NUM_ROUNDS + 3) / 4];
+  // memory of the views if they were allocated from an arena
+  mzd_arena_t arena;
 } proof_t;
 
+/**
+ * Number of bytes required to store the views of a proof with sc parties, including the view
+ * arrays.
+ */
+size_t proof_views_size(mpc_lowmc_t const* lowmc, unsigned int sc);
+
 proof_t* proof_from_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned char* data,
                                unsigned* len, bool contains_ch);
 
 unsigned char* proof_to_char_array(mpc_lowmc_t* lowmc, proof_t* proof, unsigned* len,
                                    bool store_ch);
 
+/**
+ * Number of bytes written by proof_serialize_into for this proof.
+ */
+size_t proof_serialized_size(mpc_lowmc_t const* lowmc, proof_t const* proof, bool store_ch);
+
+/**
+ * Serializes a proof into a caller provided buffer.
+ *
+ * \param out the output buffer
+ * \param cap the size of the output buffer
+ * \return    the number of bytes written or 0 if the buffer is too small
+ */
+size_t proof_serialize_into(mpc_lowmc_t const* lowmc, proof_t const* proof, unsigned char* out,
+                            size_t cap, bool store_ch);
+
+/**
+ * Parses a proof from at most len bytes of data. The views are read directly into the view stores
+ * of the proof. Memory from a previous parse into the same proof is reused.
+ *
+ * \param proof a zero-initialized proof or a proof from a previous call
+ * \return      the number of bytes read or 0 if the data is malformed. If the views cannot be
+ *              allocated, 0 is returned and the memory of the proof is released.
+ */
+size_t proof_parse(mpc_lowmc_t const* lowmc, proof_t* proof, unsigned char const* data,
+                   size_t len, bool contains_ch);
+
+/**
+ * Number of bytes of one serialized repetition with challenge ch, excluding its commitment.
+ */
+size_t proof_round_size(mpc_lowmc_t const* lowmc, unsigned int ch);
+
+/**
+ * Parses one repetition with challenge ch into views pointing to a cleared view store for
+ * SC_VERIFY parties.
+ *
+ * \param aes_prng PRNG used to expand the seeded views
+ * \return         the first byte after the repetition
+ */
+unsigned char const* proof_parse_round(mpc_lowmc_t const* lowmc, view_t const* views,
+                                       unsigned char keys[SC_VERIFY][PRNG_KEYSIZE],
+                                       unsigned char r[SC_VERIFY][COMMITMENT_RAND_LENGTH],
+                                       unsigned int ch, unsigned char const* data,
+                                       aes_prng_t* aes_prng);
+
+/**
+ * Creates a proof taking ownership of the views.
+ *
+ * \param arena the arena the view stores were allocated from. The proof takes ownership of the
+ *              arena.
+ * \return      the proof or NULL if memory could not be allocated. The arena is released in that
+ *              case.
+ */
 proof_t* create_proof(proof_t* proof, mpc_lowmc_t const* lowmc,
                       unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH],
                       unsigned char ch[NUM_ROUNDS],
                       unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH],
                       unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE],
-                      view_t* const views[NUM_ROUNDS]);
+                      view_t* const views[NUM_ROUNDS], mzd_arena_t* arena);
 
-void clear_proof(mpc_lowmc_t const* lowmc, proof_t const* proof);
+/**
+ * Like create_proof, but the proof only references the views instead of taking ownership of them.
+ * The view arrays of the proof are placed in view_storage which needs to hold NUM_ROUNDS *
+ * (lowmc->r + 2) elements. Such a proof must not be passed to clear_proof or free_proof.
+ */
+proof_t* create_proof_ref(proof_t* proof, mpc_lowmc_t const* lowmc,
+                          unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH],
+                          unsigned char ch[NUM_ROUNDS],
+                          unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH],
+                          unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE],
+                          view_t* const views[NUM_ROUNDS], view_t* view_storage);
+
+void clear_proof(mpc_lowmc_t const* lowmc, proof_t* proof);
 void free_proof(mpc_lowmc_t const* lowmc, proof_t* proof);
 
 /**
@@ -52,6 +179,36 @@ void free_proof(mpc_lowmc_t const* lowmc, proof_t* proof);
 mzd_t** mpc_lowmc_call(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key, mzd_t const* p,
                        view_t* views, mzd_t*** rvec);
 
+/**
+ * Allocates the buffers of scratch. They have to be released with mpc_lowmc_scratch_clear even if
+ * the allocation failed.
+ *
+ * \return false if the memory could not be allocated
+ */
+bool mpc_lowmc_scratch_init(mpc_lowmc_scratch_t* scratch, mpc_lowmc_t const* lowmc);
+void mpc_lowmc_scratch_clear(mpc_lowmc_scratch_t* scratch);
+
+/**
+ * Like mpc_lowmc_call, but all intermediate values are stored in scratch. The output shares are
+ * only available in the last view. The views may be reused from a previous call.
+ *
+ * \param  key_schedule the key schedule of the shared key from lowmc_key_schedule_init or NULL.
+ *                      If given, the key schedule of one share is derived from the others.
+ * \param  scratch      buffers initialized with mpc_lowmc_scratch_init
+ */
+void mpc_lowmc_call_scratch(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key,
+                            mzd_t* const* key_schedule, mzd_t const* p, view_t* views,
+                            mzd_t*** rvec, mpc_lowmc_scratch_t* scratch);
+
+/**
+ * Like mpc_lowmc_call_scratch for two independent repetitions. If AVX2 is available and n <= 128,
+ * the S-box layers of both repetitions are evaluated together in the two halves of the AVX2
+ * registers.
+ */
+void mpc_lowmc_call_scratch_x2(mpc_lowmc_t const* lowmc, mpc_lowmc_key_t* lowmc_key[2],
+                               mzd_t* const* key_schedule, mzd_t const* p, view_t* views[2],
+                               mzd_t*** const rvec[2], mpc_lowmc_scratch_t* scratch[2]);
+
 /**
  * Verifies a ZKBoo execution of a LowMC encryption
  *
@@ -6,9 +6,115 @@
 
 #include "mpc_test.h"
 
+#include "lowmc.h"
+#include "lowmc_pars.h"
 #include "mpc.h"
+#include "mpc_lowmc.h"
 #include "mzd_additional.h"
 #include "multithreading.h"
+#include "randomness.h"
+#include "sha256_multi.h"
+#include "signature_fis.h"
+#include "timing.h"
+
+#include <errno.h>
+#include <openssl/crypto.h>
+#include <openssl/sha.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+// the linker redirects all allocations of the library and of the tests to the wrappers below
+static _Thread_local uint64_t heap_allocations;
+// the allocations of the library and of the tests, which can be made to fail
+static _Thread_local uint64_t library_allocations;
+// if not 0, the library allocation with this number fails
+static _Thread_local uint64_t failing_allocation;
+// the allocated blocks which have not been freed yet
+static _Thread_local int64_t live_allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t count, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void* __real_aligned_alloc(size_t alignment, size_t size);
+int __real_posix_memalign(void** ptr, size_t alignment, size_t size);
+void __real_free(void* ptr);
+
+static bool allocation_fails(void) {
+  ++heap_allocations;
+  return ++library_allocations == failing_allocation;
+}
+
+static void* count_allocation(void* ptr) {
+  live_allocations += ptr != NULL;
+  return ptr;
+}
+
+void* __wrap_malloc(size_t size) {
+  return allocation_fails() ? NULL : count_allocation(__real_malloc(size));
+}
+
+void* __wrap_calloc(size_t count, size_t size) {
+  return allocation_fails() ? NULL : count_allocation(__real_calloc(count, size));
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+  if (allocation_fails()) {
+    return NULL;
+  }
+  void* res = __real_realloc(ptr, size);
+  return ptr ? res : count_allocation(res);
+}
+
+void* __wrap_aligned_alloc(size_t alignment, size_t size) {
+  return allocation_fails() ? NULL : count_allocation(__real_aligned_alloc(alignment, size));
+}
+
+int __wrap_posix_memalign(void** ptr, size_t alignment, size_t size) {
+  if (allocation_fails()) {
+    return ENOMEM;
+  }
+  const int ret = __real_posix_memalign(ptr, alignment, size);
+  count_allocation(ret ? NULL : *ptr);
+  return ret;
+}
+
+void __wrap_free(void* ptr) {
+  live_allocations -= ptr != NULL;
+  __real_free(ptr);
+}
+
+// OpenSSL is linked dynamically, so its allocations are passed to the wrappers explicitly. They
+// never fail, since the library does not check the OpenSSL calls of its temporary PRNGs.
+static void* openssl_malloc(size_t size, const char* file, int line) {
+  (void)file;
+  (void)line;
+  ++heap_allocations;
+  return count_allocation(__real_malloc(size));
+}
+
+static void* openssl_realloc(void* ptr, size_t size, const char* file, int line) {
+  (void)file;
+  (void)line;
+  ++heap_allocations;
+  void* res = __real_realloc(ptr, size);
+  return ptr ? res : count_allocation(res);
+}
+
+static void openssl_free(void* ptr, const char* file, int line) {
+  (void)file;
+  (void)line;
+  free(ptr);
+}
+
+static bool count_openssl_allocations(void) {
+  return CRYPTO_set_mem_functions(openssl_malloc, openssl_realloc, openssl_free) == 1;
+}
+#endif
 
 static void test_mpc_share(void) {
   mzd_t* t1    = mzd_init_random_vector(10);
@@ -65,6 +171,53 @@ void test_mzd_local_equal(void) {
   }
 }
 
+static bool aligned_32(void const* ptr) {
+  return ptr && !((uintptr_t)ptr % 32);
+}
+
+/**
+ * Allocations from an arena are 32 byte aligned and fill a block before the next one is allocated.
+ * Requests larger than the block size get a block of their own. After a reset, the most recent
+ * block is reused.
+ */
+static void test_mzd_arena(void) {
+  const uint64_t allocations = mzd_local_allocation_count();
+
+  mzd_arena_t arena;
+  mzd_arena_init(&arena, 256);
+
+  // the sizes are rounded up to multiples of 32, so that a, b and c fill the first block
+  unsigned char* a = mzd_arena_alloc(&arena, 1);
+  unsigned char* b = mzd_arena_alloc(&arena, 33);
+  unsigned char* c = mzd_arena_alloc(&arena, 160);
+  bool ok          = aligned_32(a) && b == a + 32 && c == a + 96;
+  ok               = ok && mzd_local_allocation_count() == allocations + 1;
+
+  unsigned char* d = mzd_arena_alloc(&arena, 1);
+  ok               = ok && aligned_32(d) && d != a + 256;
+  ok               = ok && mzd_local_allocation_count() == allocations + 2;
+
+  unsigned char* e = mzd_arena_alloc(&arena, 1000);
+  ok               = ok && aligned_32(e) && mzd_local_allocation_count() == allocations + 3;
+  if (e) {
+    memset(e, 0xff, 1000);
+  }
+
+  mzd_arena_reset(&arena);
+  unsigned char* f = mzd_arena_alloc(&arena, 1000);
+  ok               = ok && f == e && mzd_local_allocation_count() == allocations + 3;
+
+  mzd_t* zero = mzd_local_init(1, 256);
+  mzd_t* v    = mzd_arena_init_mzd(&arena, 1, 256, true);
+  ok          = ok && v && aligned_32(CONST_FIRST_ROW(v)) && mzd_local_equal(v, zero);
+  ok          = ok && mzd_local_allocation_count() == allocations + 5;
+  mzd_local_free(zero);
+
+  mzd_arena_clear(&arena);
+  ok = ok && !arena.head;
+  printf("mzd arena: %s\n", ok ? "ok" : "fail");
+}
+
 static void test_mzd_mul(void) {
   for (unsigned int i = 1; i <= 10; ++i) {
     for (unsigned int j = 1; j <= 10; ++j) {
@@ -201,15 +354,1251 @@ static void test_mzd_shift(void) {
 #endif
 }
 
+static void test_mzd_mul_vl(void) {
+  static const rci_t sizes[]       = {128, 192, 256, 384, 512};
+  static const unsigned int bits[] = {4, 8};
+
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    const rci_t n = sizes[s];
+    mzd_t* A      = mzd_local_init(n, n);
+    mzd_t* v      = mzd_local_init(1, n);
+    mzd_t* c      = mzd_local_init(1, n);
+    mzd_t* c2     = mzd_local_init(1, n);
+    mzd_randomize_ssl(A);
+    mzd_randomize_ssl(v);
+
+    // the kernels selected for the CPU, e.g. the AVX-512 ones, against the product without tables
+    for (size_t b = 0; b < sizeof(bits) / sizeof(bits[0]); ++b) {
+      mzd_t* lookup = mzd_precompute_matrix_lookup(A, bits[b]);
+
+      mzd_mul_vl_select(n, n, bits[b])(c, v, lookup);
+      mzd_mul_v(c2, v, A);
+      bool equal = mzd_lookup_bits(lookup, n) == bits[b] && mzd_local_equal(c, c2);
+
+      mzd_randomize_ssl(c);
+      mzd_local_copy(c2, c);
+      mzd_addmul_vl_select(n, n, bits[b])(c, v, lookup);
+      mzd_addmul_v(c2, v, A);
+      equal = equal && mzd_local_equal(c, c2);
+
+      if (!equal) {
+        printf("mul vl: fail [%d x %d, %u bits]\n", n, n, bits[b]);
+        ok = false;
+      }
+      mzd_local_free(lookup);
+    }
+
+    mzd_local_free(c2);
+    mzd_local_free(c);
+    mzd_local_free(v);
+    mzd_local_free(A);
+  }
+
+  if (ok) {
+    printf("mul vl: ok\n");
+  }
+}
+
+/**
+ * mzd_randomize_prng fills the rows with the stream of the PRNG and leaves their padding untouched,
+ * so matrices sampled with the same key are equal. The copies of matrices with padded rows are
+ * equal as well.
+ */
+static void test_mzd_randomize_prng(void) {
+  static const unsigned char keys[2][16] = {{'p', 'r', 'n', 'g'}, {'p', 'r', 'n', 'g', 1}};
+  static const rci_t sizes[]             = {64, 100, 192, 320};
+
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    // A and B are sampled with the same key, C with another one
+    mzd_t* A[3];
+    for (unsigned int i = 0; i < 3; ++i) {
+      aes_prng_t aes_prng;
+      A[i] = mzd_local_init(10, sizes[s]);
+      ok   = aes_prng_init(&aes_prng, keys[i / 2]) && ok;
+      mzd_randomize_prng(A[i], &aes_prng);
+      aes_prng_clear(&aes_prng);
+    }
+    mzd_t* copy = mzd_local_copy(NULL, A[0]);
+    ok = ok && mzd_local_equal(A[0], A[1]) && !mzd_local_equal(A[0], A[2]) &&
+         mzd_local_equal(A[0], copy);
+
+    const word high_bitmask = __M4RI_LEFT_BITMASK(sizes[s] % m4ri_radix);
+    for (rci_t i = 0; i < A[0]->nrows; ++i) {
+      word const* row = A[0]->rows[i];
+      ok              = ok && !(row[A[0]->width - 1] & ~high_bitmask);
+      for (wi_t w = A[0]->width; w < A[0]->rowstride; ++w) {
+        ok = ok && !row[w];
+      }
+    }
+
+    mzd_local_free(copy);
+    for (unsigned int i = 0; i < 3; ++i) {
+      mzd_local_free(A[i]);
+    }
+  }
+  printf("mzd randomize prng: %s\n", ok ? "ok" : "fail");
+}
+
+/**
+ * The views of a party are stored contiguously: its share of the key is followed by the views of
+ * the S-box layers and its share of the output. The parties beyond the share count get no views.
+ */
+static void test_view_assign(void) {
+  static const size_t sizes[][2] = {{128, 128}, {192, 192}, {256, 256}, {128, 192}, {192, 128}};
+
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    // only the sizes are needed for the layout
+    const lowmc_t lowmc     = {.m = 10, .n = sizes[s][0], .r = 4, .k = sizes[s][1]};
+    const size_t key_stride = view_key_stride(&lowmc);
+    const size_t stride     = view_stride(&lowmc);
+    const size_t party_size = view_party_size(&lowmc);
+    // the views after the key share stay aligned if their stride is a multiple of 32 bytes
+    ok = ok && key_stride * 64 >= lowmc.k && stride * 64 >= lowmc.n &&
+         (stride % 4 || !(key_stride % 4));
+    ok = ok && party_size == key_stride + (lowmc.r + 1) * stride;
+
+    word* store = aligned_alloc(32, (SC_PROOF * party_size * sizeof(word) + 31) & ~31);
+    view_t views[4 + 2];
+    for (unsigned int sc = SC_VERIFY; sc <= SC_PROOF; ++sc) {
+      view_assign(&lowmc, views, store, sc);
+      for (unsigned int m = 0; m < SC_PROOF; ++m) {
+        word* base = m < sc ? store + m * party_size : NULL;
+        ok         = ok && views[0].s[m] == base;
+        for (unsigned int j = 1; j < lowmc.r + 2; ++j) {
+          ok = ok && views[j].s[m] == (base ? base + key_stride + (j - 1) * stride : NULL);
+        }
+      }
+    }
+
+    mzd_t* shares[SC_PROOF];
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      shares[m] = mzd_init_random_vector(lowmc.k);
+    }
+    mpc_copy_to_view(views[0].s, shares, SC_PROOF);
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      const size_t size = shares[m]->width * sizeof(word);
+      ok                = ok && !memcmp(views[0].s[m], CONST_FIRST_ROW(shares[m]), size);
+      mzd_local_free(shares[m]);
+    }
+    free(store);
+  }
+  printf("view assign: %s\n", ok ? "ok" : "fail");
+}
+
+/**
+ * Removes the file lowmc_init_from_seed caches the instance in.
+ */
+static void remove_instance_file(size_t m, size_t n, size_t r, size_t k,
+                                 const unsigned char seed[PRNG_KEYSIZE]) {
+  char file_name[64];
+  char* pos = file_name + sprintf(file_name, "%zu-%zu-%zu-%zu-", m, n, r, k);
+  for (unsigned int i = 0; i < PRNG_KEYSIZE; ++i) {
+    pos += sprintf(pos, "%02x", seed[i]);
+  }
+  remove(file_name);
+}
+
+static bool lowmc_matrices_equal(lowmc_t const* a, lowmc_t const* b) {
+  bool ret = mzd_local_equal(a->mask.x0, b->mask.x0) && mzd_local_equal(a->mask.x1, b->mask.x1) &&
+             mzd_local_equal(a->mask.x2, b->mask.x2) &&
+             mzd_local_equal(a->mask.mask, b->mask.mask) &&
+             mzd_local_equal(a->k0_matrix, b->k0_matrix);
+  for (size_t i = 0; ret && i < a->r; ++i) {
+    ret = mzd_local_equal(a->rounds[i].k_matrix, b->rounds[i].k_matrix) &&
+          mzd_local_equal(a->rounds[i].l_matrix, b->rounds[i].l_matrix) &&
+          mzd_local_equal(a->rounds[i].constant, b->rounds[i].constant);
+  }
+#ifdef REDUCED_ROUND_KEYS
+  ret = ret && mzd_local_equal(a->rrk_matrix, b->rrk_matrix) &&
+        mzd_local_equal(a->kf_matrix, b->kf_matrix);
+#endif
+  return ret;
+}
+
+static void test_lowmc_init_from_seed(void) {
+  unsigned char seed[PRNG_KEYSIZE]  = {'l', 'o', 'w', 'm', 'c'};
+  unsigned char other[PRNG_KEYSIZE] = {'l' ^ 1, 'o', 'w', 'm', 'c'};
+
+  // a is generated and written to the file, b is read from it
+  remove_instance_file(10, 128, 4, 128, seed);
+  lowmc_t* a = lowmc_init_from_seed(10, 128, 4, 128, seed);
+  lowmc_t* b = lowmc_init_from_seed(10, 128, 4, 128, seed);
+  // c is generated from the seed again
+  remove_instance_file(10, 128, 4, 128, seed);
+  lowmc_t* c = lowmc_init_from_seed(10, 128, 4, 128, seed);
+  lowmc_t* d = lowmc_init_from_seed(10, 128, 4, 128, other);
+
+  lowmc_key_t* key = lowmc_keygen(a);
+  mzd_t* p         = mzd_init_random_vector(128);
+  mzd_t* ca        = lowmc_call(a, key, p);
+  mzd_t* cb        = lowmc_call(b, key, p);
+  mzd_t* cc        = lowmc_call(c, key, p);
+  mzd_t* cd        = lowmc_call(d, key, p);
+
+  if (lowmc_matrices_equal(a, b) && lowmc_matrices_equal(a, c) && !lowmc_matrices_equal(a, d) &&
+      mzd_local_equal(ca, cb) && mzd_local_equal(ca, cc) && !mzd_local_equal(ca, cd)) {
+    printf("lowmc from seed: ok\n");
+  } else {
+    printf("lowmc from seed: fail\n");
+  }
+
+  mzd_local_free(cd);
+  mzd_local_free(cc);
+  mzd_local_free(cb);
+  mzd_local_free(ca);
+  mzd_local_free(p);
+  lowmc_key_free(key);
+  lowmc_free(d);
+  lowmc_free(c);
+  lowmc_free(b);
+  lowmc_free(a);
+  remove_instance_file(10, 128, 4, 128, other);
+  remove_instance_file(10, 128, 4, 128, seed);
+}
+
+/**
+ * Generates the instance with block size n, key size k and 4 rounds used by the kernel tests. It is
+ * not kept in a file, so that its lookup tables can be replaced.
+ */
+static lowmc_t* kernel_test_instance(size_t n, size_t k) {
+  static const unsigned char seed[PRNG_KEYSIZE] = {'k', 'e', 'r', 'n', 'e', 'l'};
+
+  remove_instance_file(10, n, 4, k, seed);
+  lowmc_t* lowmc = lowmc_init_from_seed(10, n, 4, k, seed);
+  remove_instance_file(10, n, 4, k, seed);
+  return lowmc;
+}
+
+/**
+ * Calls fn for the kernel test instances of all block sizes with specialized kernels, each with 4
+ * and 8 bit lookup tables, and prints the result.
+ */
+static void test_kernels(const char* name, bool (*fn)(lowmc_t* lowmc)) {
+  static const size_t sizes[] = {128, 192, 256, 384, 512};
+#ifdef NOSCR
+  static const unsigned int bits[] = {4, 8};
+#else
+  // without lookup tables, the instance is only tested once
+  static const unsigned int bits[] = {0};
+#endif
+
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    lowmc_t* lowmc = kernel_test_instance(sizes[s], sizes[s]);
+    if (!lowmc) {
+      printf("%s: fail [n = %zu]\n", name, sizes[s]);
+      ok = false;
+      continue;
+    }
+
+    for (size_t b = 0; b < sizeof(bits) / sizeof(bits[0]); ++b) {
+#ifdef NOSCR
+      lowmc_precompute_lookups(lowmc, bits[b]);
+#endif
+      if (!fn(lowmc)) {
+        printf("%s: fail [n = %zu, %u bits]\n", name, sizes[s], bits[b]);
+        ok = false;
+      }
+    }
+    lowmc_free(lowmc);
+  }
+
+  if (ok) {
+    printf("%s: ok\n", name);
+  }
+}
+
+/**
+ * Encrypts p with the key matrices of the rounds, i.e. without reduced round keys and lookup
+ * tables.
+ */
+static mzd_t* lowmc_call_reference(lowmc_t const* lowmc, mzd_t const* key, mzd_t const* p) {
+  mzd_t* x = mzd_local_init(1, lowmc->n);
+  mzd_t* y = mzd_local_init(1, lowmc->n);
+
+  mzd_local_copy(x, p);
+  mzd_addmul_v(x, key, lowmc->k0_matrix);
+  for (size_t i = 0; i < lowmc->r; ++i) {
+    lowmc->kernels.sbox(y, x, &lowmc->mask);
+    mzd_mul_v(x, y, lowmc->rounds[i].l_matrix);
+    mzd_xor(x, x, lowmc->rounds[i].constant);
+    mzd_addmul_v(x, key, lowmc->rounds[i].k_matrix);
+  }
+
+  mzd_local_free(y);
+  return x;
+}
+
+/**
+ * The encryption with the kernels selected for the instance against the reference. The products of
+ * the instances whose block or key size is not a multiple of 64 use the portable kernels.
+ */
+static void test_lowmc_kernels(void) {
+  static const size_t sizes[][2] = {{128, 128}, {192, 192}, {256, 256},
+                                    {160, 160}, {128, 160}, {160, 128}};
+
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    lowmc_t* lowmc = kernel_test_instance(sizes[s][0], sizes[s][1]);
+    if (!lowmc) {
+      printf("lowmc kernels: fail [n = %zu, k = %zu]\n", sizes[s][0], sizes[s][1]);
+      ok = false;
+      continue;
+    }
+
+    mzd_t* key      = mzd_init_random_vector(lowmc->k);
+    mzd_t* p        = mzd_init_random_vector(lowmc->n);
+    mzd_t* c        = lowmc_call(lowmc, key, p);
+    mzd_t* expected = lowmc_call_reference(lowmc, key, p);
+    bool equal      = mzd_local_equal(c, expected);
+#ifdef NOSCR
+    // the chunk width chosen by the calibration
+    const unsigned int bits = mzd_lookup_bits(lowmc->k0_lookup, lowmc->k);
+    equal                   = equal && (bits == 4 || bits == 8);
+#endif
+    if (!equal) {
+      printf("lowmc kernels: fail [n = %zu, k = %zu]\n", sizes[s][0], sizes[s][1]);
+      ok = false;
+    }
+
+    mzd_local_free(expected);
+    mzd_local_free(c);
+    mzd_local_free(p);
+    mzd_local_free(key);
+    lowmc_free(lowmc);
+  }
+
+  if (ok) {
+    printf("lowmc kernels: ok\n");
+  }
+}
+
+/**
+ * Runs the prover for two repetitions with the given kernels. The views of the i-th repetition are
+ * stored in store[i], which holds SC_PROOF * view_party_size(lowmc) words.
+ */
+static void kernel_test_prove(lowmc_t* lowmc, lowmc_kernels_t const* kernels, mzd_t const* key,
+                              mzd_t const* p, word* const store[2]) {
+  const lowmc_kernels_t selected = lowmc->kernels;
+  lowmc->kernels                 = *kernels;
+
+  unsigned char keys[2][SC_PROOF][PRNG_KEYSIZE];
+  for (unsigned int k = 0; k < 2; ++k) {
+    for (unsigned int j = 0; j < SC_PROOF; ++j) {
+      memset(keys[k][j], 1 + k * SC_PROOF + j, PRNG_KEYSIZE);
+    }
+  }
+  mzd_t** key_schedule = lowmc_key_schedule_init(lowmc, key);
+
+  mpc_lowmc_key_t shares[2];
+  view_t* views[2];
+  mzd_t** rvec[2][SC_PROOF];
+  mpc_lowmc_scratch_t scratch[2];
+  for (unsigned int k = 0; k < 2; ++k) {
+    shares[k].share_count = SC_PROOF;
+    mzd_local_init_multiple_ex(shares[k].shared, SC_PROOF, 1, lowmc->k, false);
+    mzd_local_copy(shares[k].shared[2], key);
+    mzd_shared_share_from_keys(&shares[k], keys[k]);
+
+    views[k] = malloc((lowmc->r + 2) * sizeof(view_t));
+    view_assign(lowmc, views[k], store[k], SC_PROOF);
+    for (unsigned int j = 0; j < SC_PROOF; ++j) {
+      rvec[k][j] = malloc(sizeof(mzd_t*) * lowmc->r);
+      mzd_local_init_multiple_ex(rvec[k][j], lowmc->r, 1, lowmc->n, false);
+    }
+    mpc_lowmc_scratch_init(&scratch[k], lowmc);
+  }
+  mzd_randomize_multiple_from_seeds(&rvec[0][0], lowmc->r, keys[0][0], 2 * SC_PROOF);
+
+  mpc_lowmc_key_t* pair_keys[2]        = {&shares[0], &shares[1]};
+  mzd_t*** const pair_rvec[2]          = {rvec[0], rvec[1]};
+  mpc_lowmc_scratch_t* pair_scratch[2] = {&scratch[0], &scratch[1]};
+  mpc_lowmc_call_scratch_x2(lowmc, pair_keys, key_schedule, p, views, pair_rvec, pair_scratch);
+
+  for (unsigned int k = 0; k < 2; ++k) {
+    mpc_lowmc_scratch_clear(&scratch[k]);
+    for (unsigned int j = 0; j < SC_PROOF; ++j) {
+      mzd_local_free_multiple(rvec[k][j]);
+      free(rvec[k][j]);
+    }
+    free(views[k]);
+    mzd_shared_clear(&shares[k]);
+  }
+  lowmc_key_schedule_free(key_schedule);
+
+  lowmc->kernels = selected;
+}
+
+/**
+ * Compares the views of the prover for lowmc with those for other, a copy of lowmc with different
+ * kernels or linear layers.
+ */
+static bool kernel_test_views_equal(lowmc_t* lowmc, lowmc_t* other) {
+  static const unsigned char key_seed[PRNG_KEYSIZE] = {'k', 'e', 'y'};
+  static const unsigned char p_seed[PRNG_KEYSIZE]   = {'p'};
+
+  mzd_t* key = mzd_init_random_vector_from_seed(key_seed, lowmc->k);
+  mzd_t* p   = mzd_init_random_vector_from_seed(p_seed, lowmc->n);
+
+  // the padding of the views is hashed as well, so the stores are compared as a whole
+  const size_t size = (SC_PROOF * view_party_size(lowmc) * sizeof(word) + 31) & ~31;
+  unsigned char* a  = aligned_alloc(32, 4 * size);
+  unsigned char* b  = a + 2 * size;
+  memset(a, 0, 4 * size);
+
+  word* store_a[2] = {(word*)a, (word*)(a + size)};
+  word* store_b[2] = {(word*)b, (word*)(b + size)};
+  kernel_test_prove(lowmc, &lowmc->kernels, key, p, store_a);
+  kernel_test_prove(other, &other->kernels, key, p, store_b);
+  const bool ret = !memcmp(a, b, 2 * size);
+
+  free(a);
+  mzd_local_free(p);
+  mzd_local_free(key);
+  return ret;
+}
+
+/**
+ * The S-box layers selected for the instance, in the clear and for the prover and the verifier,
+ * against sbox_layer_bitsliced. The shares of the prover have to reconstruct the S-box layer of the
+ * reconstructed input. The verifier has to recompute the outputs and the view of the first party
+ * from the view of the second one.
+ */
+static bool test_sbox_instance(lowmc_t* lowmc) {
+  const rci_t n         = lowmc->n;
+  const size_t stride   = view_stride(lowmc);
+  const unsigned int sc = SC_PROOF + SC_VERIFY;
+  const size_t size     = (sc * stride * sizeof(word) + 31) & ~31;
+
+  // the kernels of the tested block sizes do not use the buffers of sbox_vars_t
+  sbox_vars_t vars;
+  memset(&vars, 0, sizeof(vars));
+
+  word* store = aligned_alloc(32, size);
+  mzd_t* in[SC_PROOF];
+  mzd_t* r[SC_PROOF];
+  mzd_t* out[SC_PROOF + SC_VERIFY];
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    in[m] = mzd_init_random_vector(n);
+    r[m]  = mzd_init_random_vector(n);
+  }
+  for (unsigned int m = 0; m < sc; ++m) {
+    out[m] = mzd_local_init(1, n);
+  }
+  mzd_t* x        = mpc_reconstruct_from_share(NULL, in);
+  mzd_t* expected = mzd_local_init(1, n);
+  mzd_t* y        = mzd_local_init(1, n);
+
+  memset(store, 0, size);
+  view_t view   = {{store, store + stride, store + 2 * stride}};
+  view_t verify = {{store + 3 * stride, store + 4 * stride}};
+
+  sbox_layer_bitsliced(expected, x, &lowmc->mask);
+  lowmc->kernels.sbox(y, x, &lowmc->mask);
+  bool ok = mzd_local_equal(y, expected);
+
+  lowmc->kernels.mpc_sbox(out, in, &view, r, &lowmc->mask, &vars);
+  mpc_reconstruct_from_share(y, out);
+  ok = ok && mzd_local_equal(y, expected);
+
+  memcpy(verify.s[1], view.s[1], stride * sizeof(word));
+  lowmc->kernels.mpc_sbox_verify(&out[SC_PROOF], in, &verify, r, &lowmc->mask, &vars);
+  for (unsigned int m = 0; m < SC_VERIFY; ++m) {
+    ok = ok && mzd_local_equal(out[SC_PROOF + m], out[m]);
+  }
+  ok = ok && !memcmp(verify.s[0], view.s[0], stride * sizeof(word));
+
+  mzd_local_free(y);
+  mzd_local_free(expected);
+  mzd_local_free(x);
+  for (unsigned int m = 0; m < sc; ++m) {
+    mzd_local_free(out[m]);
+  }
+  for (unsigned int m = 0; m < SC_PROOF; ++m) {
+    mzd_local_free(r[m]);
+    mzd_local_free(in[m]);
+  }
+  free(store);
+  return ok;
+}
+
+static void test_sbox(void) {
+  test_kernels("sbox layers", test_sbox_instance);
+}
+
+/**
+ * The S-box layers of two repetitions evaluated together against separate repetitions.
+ */
+static bool test_mpc_sbox_x2_instance(lowmc_t* lowmc) {
+  lowmc_t other             = *lowmc;
+  other.kernels.mpc_sbox_x2 = NULL;
+  return kernel_test_views_equal(lowmc, &other);
+}
+
+static void test_mpc_sbox_x2(void) {
+  test_kernels("mpc sbox x2", test_mpc_sbox_x2_instance);
+}
+
+/**
+ * The rounds of the prover with the states kept in registers against the rounds evaluated one by
+ * one.
+ */
+static bool test_mpc_rounds_instance(lowmc_t* lowmc) {
+  lowmc_t other            = *lowmc;
+  other.kernels.mpc_rounds = NULL;
+  return kernel_test_views_equal(lowmc, &other);
+}
+
+static void test_mpc_rounds(void) {
+  test_kernels("mpc rounds", test_mpc_rounds_instance);
+}
+
+#ifdef REDUCED_ROUND_KEYS
+/**
+ * The views of the prover with folded linear layers against those with the linear layers of the
+ * instance. The S-box bits are not affected by the folding, so the views have to be identical.
+ * Only the instances with n > 256 are folded.
+ */
+static bool test_lowmc_folded_instance(lowmc_t* lowmc) {
+  if (lowmc->folded != (lowmc->n > 256)) {
+    return false;
+  }
+
+  lowmc_t other = *lowmc;
+  other.folded  = false;
+  return kernel_test_views_equal(lowmc, &other);
+}
+
+static void test_lowmc_folded(void) {
+  test_kernels("lowmc folded linear layers", test_lowmc_folded_instance);
+}
+#endif
+
+/**
+ * The key schedule is linear, so the prover can derive the key schedule of the last key share from
+ * the cached one of the key and those of the other shares. The encryption with the key schedule of
+ * a key matches the one with the key.
+ */
+static bool test_lowmc_key_schedule_linear_instance(lowmc_t* lowmc) {
+  mzd_t* a = mzd_init_random_vector(lowmc->k);
+  mzd_t* b = mzd_init_random_vector(lowmc->k);
+  mzd_t* p = mzd_init_random_vector(lowmc->n);
+
+  mzd_t* ab = mzd_local_copy(NULL, a);
+  mzd_xor(ab, ab, b);
+
+  mzd_t** schedule_a  = lowmc_key_schedule_init(lowmc, a);
+  mzd_t** schedule_b  = lowmc_key_schedule_init(lowmc, b);
+  mzd_t** schedule_ab = lowmc_key_schedule_init(lowmc, ab);
+
+  mzd_t* c  = lowmc_call(lowmc, a, p);
+  mzd_t* cs = lowmc_call_key_schedule(lowmc, schedule_a, p);
+  bool ret  = mzd_local_equal(c, cs);
+  for (unsigned int i = 0; i < lowmc_key_schedule_length(lowmc); ++i) {
+    mzd_xor(schedule_a[i], schedule_a[i], schedule_b[i]);
+    ret = ret && mzd_local_equal(schedule_a[i], schedule_ab[i]);
+  }
+
+  mzd_local_free(cs);
+  mzd_local_free(c);
+  lowmc_key_schedule_free(schedule_ab);
+  lowmc_key_schedule_free(schedule_b);
+  lowmc_key_schedule_free(schedule_a);
+  mzd_local_free(ab);
+  mzd_local_free(p);
+  mzd_local_free(b);
+  mzd_local_free(a);
+  return ret;
+}
+
+static void test_lowmc_key_schedule_linear(void) {
+  test_kernels("lowmc key schedule linearity", test_lowmc_key_schedule_linear_instance);
+}
+
+/**
+ * The encryption with the key schedule, in the clear and by the prover, against the reference.
+ */
+static bool test_lowmc_key_schedule_instance(lowmc_t* lowmc) {
+  mzd_t* key = mzd_init_random_vector(lowmc->k);
+  mzd_t* p   = mzd_init_random_vector(lowmc->n);
+  mzd_t* c   = lowmc_call_reference(lowmc, key, p);
+
+  mzd_t* ca            = lowmc_call(lowmc, key, p);
+  mzd_t** key_schedule = lowmc_key_schedule_init(lowmc, key);
+  mzd_t* cb            = lowmc_call_key_schedule(lowmc, key_schedule, p);
+  bool ret             = mzd_local_equal(c, ca) && mzd_local_equal(c, cb);
+
+  // the output shares of the prover are stored in the last view of each party
+  const size_t party_size = view_party_size(lowmc);
+  const size_t size       = (SC_PROOF * party_size * sizeof(word) + 31) & ~31;
+  unsigned char* store    = aligned_alloc(32, 2 * size);
+  word* stores[2]         = {(word*)store, (word*)(store + size)};
+  kernel_test_prove(lowmc, &lowmc->kernels, key, p, stores);
+
+  mzd_t* cc = mzd_local_init(1, lowmc->n);
+  for (unsigned int k = 0; k < 2; ++k) {
+    mzd_local_clear(cc);
+    for (unsigned int m = 0; m < SC_PROOF; ++m) {
+      word const* s = stores[k] + m * party_size + view_key_stride(lowmc) +
+                      lowmc->r * view_stride(lowmc);
+      for (rci_t w = 0; w < cc->width; ++w) {
+        FIRST_ROW(cc)[w] ^= s[w];
+      }
+    }
+    ret = ret && mzd_local_equal(c, cc);
+  }
+
+  mzd_local_free(cc);
+  free(store);
+  lowmc_key_schedule_free(key_schedule);
+  mzd_local_free(cb);
+  mzd_local_free(ca);
+  mzd_local_free(c);
+  mzd_local_free(p);
+  mzd_local_free(key);
+  return ret;
+}
+
+static void test_lowmc_key_schedule(void) {
+  test_kernels("lowmc key schedule", test_lowmc_key_schedule_instance);
+}
+
+static void test_aes_prng(void) {
+  static const unsigned char iv[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                       '8', '9', '0', '1', '2', '3', '4', '5'};
+  // request sizes covering partial blocks and the bulk path of the native implementation
+  static const size_t sizes[] = {1, 15, 16, 17, 5, 128, 129, 300, 7, 1000, 3};
+
+  unsigned char key[PRNG_KEYSIZE] = {'a', 'e', 's'};
+  unsigned char a[1000], b[1000];
+
+  aes_prng_t prng;
+  aes_prng_init(&prng, key);
+
+  // reference stream generated by EVP
+  aes_prng_t ref = prng;
+  ref.ctx        = EVP_CIPHER_CTX_new();
+  EVP_EncryptInit_ex(ref.ctx, EVP_aes_128_ctr(), NULL, key, iv);
+
+  bool ok = true;
+  for (unsigned int r = 0; r < 2; ++r) {
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i) {
+      aes_prng_get_randomness(&prng, a, sizes[i]);
+      aes_prng_get_randomness(&ref, b, sizes[i]);
+      ok = ok && !memcmp(a, b, sizes[i]);
+    }
+
+    key[0] ^= 1;
+    aes_prng_reseed(&prng, key);
+    aes_prng_reseed(&ref, key);
+  }
+
+  printf("aes prng: %s\n", ok ? "ok" : "fail");
+
+  aes_prng_clear(&ref);
+  aes_prng_clear(&prng);
+}
+
+static void* rand_bytes_thread(void* arg) {
+  rand_bytes(arg, 32);
+  return NULL;
+}
+
+static void test_rand_bytes(void) {
+  unsigned char a[32], b[32], c[32];
+
+  // a new thread draws from a DRBG of its own
+  pthread_t thread;
+  pthread_create(&thread, NULL, rand_bytes_thread, b);
+  rand_bytes(a, sizeof(a));
+  pthread_join(thread, NULL);
+  bool ok = memcmp(a, b, sizeof(a)) != 0;
+
+  // the child reseeds instead of repeating the output of the parent
+  int fds[2];
+  if (pipe(fds) == 0) {
+    const pid_t pid = fork();
+    if (!pid) {
+      rand_bytes(c, sizeof(c));
+      _exit(write(fds[1], c, sizeof(c)) != sizeof(c));
+    }
+    rand_bytes(a, sizeof(a));
+    ok = ok && pid > 0 && read(fds[0], c, sizeof(c)) == sizeof(c) && memcmp(a, c, sizeof(a));
+    if (pid > 0) {
+      waitpid(pid, NULL, 0);
+    }
+    close(fds[0]);
+    close(fds[1]);
+  }
+
+  printf("rand bytes: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_aes_prng_multiple(void) {
+  static const size_t sizes[] = {1, 15, 16, 17, 5, 128, 129, 300, 7, 1000, 3};
+  // more streams than are interleaved at once
+  enum { prngs = 10 };
+
+  unsigned char keys[prngs][PRNG_KEYSIZE] = {{0}};
+  unsigned char a[prngs][1000], b[1000];
+  unsigned char* dst[prngs];
+
+  aes_prng_t multiple[prngs], single[prngs];
+  for (unsigned int i = 0; i < prngs; ++i) {
+    keys[i][0] = i;
+    aes_prng_init(&multiple[i], keys[i]);
+    aes_prng_init(&single[i], keys[i]);
+    dst[i] = a[i];
+  }
+
+  bool ok = true;
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    aes_prng_get_randomness_multiple(multiple, prngs, dst, sizes[s]);
+    for (unsigned int i = 0; i < prngs; ++i) {
+      aes_prng_get_randomness(&single[i], b, sizes[s]);
+      ok = ok && !memcmp(a[i], b, sizes[s]);
+    }
+  }
+
+  printf("aes prng multiple: %s\n", ok ? "ok" : "fail");
+
+  for (unsigned int i = 0; i < prngs; ++i) {
+    aes_prng_clear(&single[i]);
+    aes_prng_clear(&multiple[i]);
+  }
+}
+
+static bool test_sha256_multi_backend(sha256_multi_backend_t backend) {
+  // lengths ending in the different cases of the padding, updated in chunks of various sizes
+  static const size_t sizes[]  = {0, 1, 55, 56, 64, 119, 120, 1000};
+  static const size_t chunks[] = {1, 7, 64, 100};
+
+  unsigned char msgs[SHA256_MULTI_LANES][1000];
+  for (unsigned int l = 0; l < SHA256_MULTI_LANES; ++l) {
+    rand_bytes(msgs[l], sizeof(msgs[l]));
+  }
+
+  bool ok = true;
+  for (unsigned int lanes = 1; lanes <= SHA256_MULTI_LANES; ++lanes) {
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+      for (size_t c = 0; c < sizeof(chunks) / sizeof(chunks[0]); ++c) {
+        sha256_multi_ctx ctx;
+        sha256_multi_init_backend(&ctx, lanes, backend);
+        for (size_t offset = 0; offset < sizes[s]; offset += chunks[c]) {
+          unsigned char const* data[SHA256_MULTI_LANES];
+          for (unsigned int l = 0; l < lanes; ++l) {
+            data[l] = msgs[l] + offset;
+          }
+          sha256_multi_update(&ctx, data, MIN(chunks[c], sizes[s] - offset));
+        }
+
+        unsigned char digests[SHA256_MULTI_LANES][SHA256_DIGEST_LENGTH];
+        unsigned char* dst[SHA256_MULTI_LANES];
+        for (unsigned int l = 0; l < SHA256_MULTI_LANES; ++l) {
+          dst[l] = digests[l];
+        }
+        sha256_multi_final(&ctx, dst);
+
+        for (unsigned int l = 0; l < lanes; ++l) {
+          unsigned char digest[SHA256_DIGEST_LENGTH];
+          SHA256(msgs[l], sizes[s], digest);
+          ok = ok && !memcmp(digest, digests[l], sizeof(digest));
+        }
+      }
+    }
+  }
+  return ok;
+}
+
+static void test_sha256_multi(void) {
+  static const struct {
+    sha256_multi_backend_t backend;
+    const char* name;
+  } backends[] = {{SHA256_MULTI_AUTO, "auto"},
+                  {SHA256_MULTI_OPENSSL, "openssl"},
+                  {SHA256_MULTI_AVX2, "avx2"},
+                  {SHA256_MULTI_SHANI, "sha-ni"}};
+
+  for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); ++i) {
+    // backends missing in this build or on this CPU are skipped
+    sha256_multi_ctx ctx;
+    if (sha256_multi_init_backend(&ctx, 1, backends[i].backend)) {
+      printf("sha256 multi %s: %s\n", backends[i].name,
+             test_sha256_multi_backend(backends[i].backend) ? "ok" : "fail");
+    }
+  }
+}
+
+// instance used by the signature tests
+#define TEST_M 10
+#define TEST_N 128
+#define TEST_R 20
+#define TEST_K 128
+
+static const unsigned char test_seed[PRNG_KEYSIZE] = {'f', 'i', 's', 'h'};
+
+typedef struct {
+  public_parameters_t pp;
+  fis_private_key_t private_key;
+  fis_public_key_t public_key;
+} test_signer_t;
+
+static bool test_signer_init(test_signer_t* signer) {
+  signer->pp.lowmc = lowmc_init_from_seed(TEST_M, TEST_N, TEST_R, TEST_K, test_seed);
+  if (!signer->pp.lowmc) {
+    return false;
+  }
+  if (!fis_create_key(&signer->pp, &signer->private_key, &signer->public_key)) {
+    destroy_instance(&signer->pp);
+    remove_instance_file(TEST_M, TEST_N, TEST_R, TEST_K, test_seed);
+    return false;
+  }
+  return true;
+}
+
+static void test_signer_clear(test_signer_t* signer) {
+  fis_destroy_key(&signer->private_key, &signer->public_key);
+  destroy_instance(&signer->pp);
+  remove_instance_file(TEST_M, TEST_N, TEST_R, TEST_K, test_seed);
+}
+
+/**
+ * Verifies sig after serializing and parsing it.
+ */
+static bool test_verify(test_signer_t* signer, const uint8_t* msg, size_t msglen,
+                        fis_signature_t* sig) {
+  unsigned int len    = 0;
+  unsigned char* data = fis_sig_to_char_array(&signer->pp, sig, &len);
+  fis_signature_t* parsed = fis_sig_from_char_array(&signer->pp, data);
+  free(data);
+
+  const bool ret = parsed && !fis_verify(&signer->pp, &signer->public_key, msg, msglen, parsed);
+  if (parsed) {
+    fis_free_signature(&signer->pp, parsed);
+  }
+  return ret;
+}
+
+/**
+ * Signs and verifies two messages and frees the signatures.
+ */
+static bool test_sign_verify(test_signer_t* signer, uint8_t id) {
+  bool ok = true;
+  for (uint8_t i = 0; i < 2; ++i) {
+    const uint8_t msg[] = {id, i};
+    fis_signature_t* sig = fis_sign(&signer->pp, &signer->private_key, msg, sizeof(msg));
+    ok = ok && sig && test_verify(signer, msg, sizeof(msg), sig);
+    if (sig) {
+      fis_free_signature(&signer->pp, sig);
+    }
+  }
+  return ok;
+}
+
+typedef struct {
+  test_signer_t* signer;
+  uint8_t id;
+  bool ok;
+} test_fis_thread_t;
+
+static void* test_fis_thread(void* arg) {
+  test_fis_thread_t* thread = arg;
+  thread->ok                = test_sign_verify(thread->signer, thread->id);
+  return NULL;
+}
+
+static void test_fis_threads(test_signer_t* signer) {
+  enum { threads = 3 };
+
+  bool ok = fis_set_threads(2);
+
+  // the repetitions of the concurrent calls are computed by the same workers
+  pthread_t ids[threads];
+  test_fis_thread_t args[threads];
+  for (unsigned int i = 0; i < threads; ++i) {
+    args[i] = (test_fis_thread_t){signer, i, false};
+    ok      = ok && !pthread_create(&ids[i], NULL, test_fis_thread, &args[i]);
+  }
+  for (unsigned int i = 0; i < threads && ok; ++i) {
+    pthread_join(ids[i], NULL);
+    ok = args[i].ok;
+  }
+
+  // the child has none of the workers, so it computes everything itself
+  const pid_t pid = fork();
+  if (!pid) {
+    _exit(!test_sign_verify(signer, threads));
+  }
+  int status = 0;
+  ok         = ok && pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+       !WEXITSTATUS(status);
+
+  fis_set_threads(0);
+  printf("fis threads: %s\n", ok ? "ok" : "fail");
+}
+
+/**
+ * Signs and verifies a message with a presignature of the pool.
+ */
+static bool test_sign_with_pool(test_signer_t* signer, fis_presig_pool_t* pool) {
+  const uint8_t msg[] = {'p', 'o', 'o', 'l'};
+  fis_signature_t* sig = fis_sign_with_pool(pool, msg, sizeof(msg));
+  const bool ok        = sig && test_verify(signer, msg, sizeof(msg), sig);
+  if (sig) {
+    fis_free_signature(&signer->pp, sig);
+  }
+  return ok;
+}
+
+static void test_fis_presig_pool(test_signer_t* signer) {
+  fis_presig_pool_t* pool = fis_presig_pool_init(&signer->pp, &signer->private_key, 2, 1);
+  if (!pool) {
+    printf("fis presig pool: fail\n");
+    return;
+  }
+
+  for (unsigned int i = 0; i < 2000 && fis_presig_pool_available(pool) < 2; ++i) {
+    const struct timespec delay = {0, 5000000};
+    nanosleep(&delay, NULL);
+  }
+  bool ok = fis_presig_pool_available(pool) == 2;
+  ok      = test_sign_with_pool(signer, pool) && ok;
+
+  // the child must not use the presignatures of the parent
+  const pid_t pid = fork();
+  if (!pid) {
+    _exit(fis_presig_pool_available(pool) || !test_sign_with_pool(signer, pool));
+  }
+  int status = 0;
+  ok         = ok && pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) &&
+       !WEXITSTATUS(status);
+
+  ok = test_sign_with_pool(signer, pool) && !fis_presig_pool_failures(pool) && ok;
+  fis_presig_pool_free(pool);
+  printf("fis presig pool: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_fis_sign_batch(test_signer_t* signer) {
+  enum { count = 3 };
+  static const uint8_t data[count][2] = {{'b', 0}, {'b', 1}, {'b', 2}};
+
+  const uint8_t* msgs[count];
+  size_t msglens[count];
+  for (unsigned int i = 0; i < count; ++i) {
+    msgs[i]    = data[i];
+    msglens[i] = sizeof(data[i]);
+  }
+
+  fis_signature_t* sigs[count] = {NULL};
+  bool ok = fis_sign_batch(&signer->pp, &signer->private_key, msgs, msglens, count, sigs);
+  // each signature of the batch is accepted like one from fis_sign, but only for its own message
+  for (unsigned int i = 0; ok && i < count; ++i) {
+    const unsigned int j = (i + 1) % count;
+    ok = test_verify(signer, msgs[i], msglens[i], sigs[i]) &&
+         !test_verify(signer, msgs[j], msglens[j], sigs[i]);
+  }
+  fis_signature_t* single = fis_sign(&signer->pp, &signer->private_key, msgs[0], msglens[0]);
+  ok = ok && single && test_verify(signer, msgs[0], msglens[0], single) &&
+       !test_verify(signer, msgs[1], msglens[1], single);
+  // the buffers of a batch this large cannot be allocated
+  ok = ok && !fis_sign_batch(&signer->pp, &signer->private_key, msgs, msglens, SIZE_MAX / 4, sigs);
+
+  if (single) {
+    fis_free_signature(&signer->pp, single);
+  }
+  for (unsigned int i = 0; i < count; ++i) {
+    if (sigs[i]) {
+      fis_free_signature(&signer->pp, sigs[i]);
+    }
+  }
+  printf("fis sign batch: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_fis_verify_batch(test_signer_t* signer) {
+  enum { count = 3 };
+  static const uint8_t data[count][2] = {{'v', 0}, {'v', 1}, {'v', 2}};
+
+  const uint8_t* msgs[count];
+  size_t msglens[count];
+  fis_public_key_t* public_keys[count];
+  fis_signature_t* sigs[count] = {NULL};
+  bool ok                      = true;
+  for (unsigned int i = 0; i < count; ++i) {
+    msgs[i]        = data[i];
+    msglens[i]     = sizeof(data[i]);
+    public_keys[i] = &signer->public_key;
+
+    fis_signature_t* sig = fis_sign(&signer->pp, &signer->private_key, msgs[i], msglens[i]);
+    if (!sig) {
+      ok = false;
+      continue;
+    }
+    unsigned int len          = 0;
+    unsigned char* serialized = fis_sig_to_char_array(&signer->pp, sig, &len);
+    fis_free_signature(&signer->pp, sig);
+    // the signature in the middle is tampered with
+    if (i == 1) {
+      serialized[len - 1] ^= 1;
+    }
+    sigs[i] = fis_sig_from_char_array(&signer->pp, serialized);
+    free(serialized);
+  }
+
+  uint8_t valid = 0;
+  ok = ok && fis_verify_batch(&signer->pp, public_keys, msgs, msglens, sigs, count, &valid) &&
+       valid == 0x5;
+  // the bitmap agrees with the results of fis_verify
+  for (unsigned int i = 0; ok && i < count; ++i) {
+    ok = (fis_verify(&signer->pp, &signer->public_key, msgs[i], msglens[i], sigs[i]) == 0) ==
+         ((valid >> i) & 1);
+  }
+
+  // a batch of the valid signatures only
+  const uint8_t* valid_msgs[]         = {msgs[0], msgs[2]};
+  const size_t valid_msglens[]        = {msglens[0], msglens[2]};
+  fis_signature_t* const valid_sigs[] = {sigs[0], sigs[2]};
+  uint8_t all_valid                   = 0;
+  ok = ok && !fis_verify_batch(&signer->pp, public_keys, valid_msgs, valid_msglens, valid_sigs, 2,
+                               &all_valid) &&
+       all_valid == 0x3;
+
+  for (unsigned int i = 0; i < count; ++i) {
+    if (sigs[i]) {
+      fis_free_signature(&signer->pp, sigs[i]);
+    }
+  }
+  printf("fis verify batch: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_fis_sign_with_ctx(test_signer_t* signer) {
+  fis_sign_ctx_t* ctx = fis_sign_ctx_init(&signer->pp);
+  bool ok             = ctx != NULL;
+
+  // the context is reused for every signature, so signing does not touch the heap at all
+  for (uint8_t i = 0; ok && i < 2; ++i) {
+    const uint8_t msg[]       = {'c', i};
+    timing_and_size_t timings = {.mzd_allocations = 1};
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+    const uint64_t allocations = heap_allocations;
+#endif
+    timing_and_size      = &timings;
+    fis_signature_t* sig = fis_sign_with_ctx(ctx, &signer->private_key, msg, sizeof(msg));
+    timing_and_size      = NULL;
+#ifdef COUNT_HEAP_ALLOCATIONS
+    ok = heap_allocations == allocations;
+#endif
+
+    ok = ok && sig && !timings.mzd_allocations && test_verify(signer, msg, sizeof(msg), sig);
+  }
+
+  fis_sign_ctx_free(ctx);
+  printf("fis sign with ctx: %s\n", ok ? "ok" : "fail");
+}
+
+#ifdef COUNT_HEAP_ALLOCATIONS
+static void test_fis_sign_ctx_init_failure(test_signer_t* signer) {
+  fis_sign_ctx_t* ctx = NULL;
+  bool ok             = true;
+
+  // the i-th allocation fails until all allocations of the context succeed
+  for (uint64_t i = 1; ok && !ctx; ++i) {
+    const int64_t live = live_allocations;
+
+    failing_allocation = library_allocations + i;
+    ctx                = fis_sign_ctx_init(&signer->pp);
+    failing_allocation = 0;
+
+    ok = ctx || live_allocations == live;
+  }
+
+  fis_sign_ctx_free(ctx);
+  printf("fis sign ctx init failure: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_fis_sign_batch_failure(test_signer_t* signer) {
+  enum { count = 2 };
+  static const uint8_t data[count][2] = {{'f', 0}, {'f', 1}};
+  const uint8_t* msgs[count]          = {data[0], data[1]};
+  const size_t msglens[count]         = {sizeof(data[0]), sizeof(data[1])};
+
+  fis_signature_t* sigs[count] = {NULL};
+  bool done                    = false;
+  bool ok                      = true;
+
+  // the i-th allocation of the calling thread fails until the batch can be signed
+  for (uint64_t i = 1; ok && !done; ++i) {
+    const int64_t live = live_allocations;
+
+    failing_allocation = library_allocations + i;
+    done = fis_sign_batch(&signer->pp, &signer->private_key, msgs, msglens, count, sigs);
+    failing_allocation = 0;
+
+    ok = done || (live_allocations == live && !sigs[0] && !sigs[1]);
+  }
+
+  for (unsigned int i = 0; ok && i < count; ++i) {
+    ok = test_verify(signer, msgs[i], msglens[i], sigs[i]);
+  }
+  for (unsigned int i = 0; i < count; ++i) {
+    if (sigs[i]) {
+      fis_free_signature(&signer->pp, sigs[i]);
+    }
+  }
+  printf("fis sign batch failure: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_fis_sig_parse_view_failure(test_signer_t* signer) {
+  const uint8_t msg[]  = {'p'};
+  fis_signature_t* sig = fis_sign(&signer->pp, &signer->private_key, msg, sizeof(msg));
+  unsigned int len     = 0;
+  unsigned char* data  = sig ? fis_sig_to_char_array(&signer->pp, sig, &len) : NULL;
+
+  bool done = false;
+  bool ok   = data != NULL;
+
+  // the i-th allocation fails until the signature can be parsed. A failed parse keeps at most the
+  // proof itself.
+  for (uint64_t i = 1; ok && !done; ++i) {
+    const int64_t live     = live_allocations;
+    fis_signature_t parsed = {NULL};
+
+    failing_allocation = library_allocations + i;
+    done               = fis_sig_parse_view(&signer->pp, data, len, &parsed);
+    failing_allocation = 0;
+
+    if (done) {
+      ok = !fis_verify(&signer->pp, &signer->public_key, msg, sizeof(msg), &parsed);
+    } else {
+      ok = live_allocations == live + (parsed.proof != NULL);
+    }
+    fis_clear_signature(&signer->pp, &parsed);
+  }
+
+  free(data);
+  if (sig) {
+    fis_free_signature(&signer->pp, sig);
+  }
+  printf("fis sig parse view failure: %s\n", ok ? "ok" : "fail");
+}
+#endif
+
+static void test_fis_sig_serialize(test_signer_t* signer) {
+  const uint8_t msg[]  = {'s'};
+  fis_signature_t* sig = fis_sign(&signer->pp, &signer->private_key, msg, sizeof(msg));
+  if (!sig) {
+    printf("fis serialize: fail\n");
+    return;
+  }
+
+  // serialize_into writes the same bytes as fis_sig_to_char_array if the buffer is large enough
+  const size_t size   = fis_sig_serialized_size(&signer->pp, sig);
+  unsigned int len    = 0;
+  unsigned char* data = fis_sig_to_char_array(&signer->pp, sig, &len);
+  uint8_t* out        = malloc(size + 1);
+
+  bool ok = len == size && !fis_sig_serialize_into(&signer->pp, sig, out, size - 1);
+  ok      = ok && fis_sig_serialize_into(&signer->pp, sig, out, size + 1) == size;
+  ok      = ok && !memcmp(out, data, size);
+  fis_free_signature(&signer->pp, sig);
+
+  fis_signature_t parsed = {NULL};
+  ok = ok && fis_sig_parse_view(&signer->pp, out, size, &parsed) &&
+       !fis_verify(&signer->pp, &signer->public_key, msg, sizeof(msg), &parsed);
+  // buffers of the wrong length and invalid challenges are rejected
+  ok = ok && !fis_sig_parse_view(&signer->pp, out, size - 1, &parsed) &&
+       !fis_sig_parse_view(&signer->pp, out, size + 1, &parsed) &&
+       !fis_sig_parse_view(&signer->pp, out, 1, &parsed);
+  out[0] = 0xff;
+  ok     = ok && !fis_sig_parse_view(&signer->pp, out, size, &parsed);
+
+  fis_clear_signature(&signer->pp, &parsed);
+  free(out);
+  free(data);
+  printf("fis serialize: %s\n", ok ? "ok" : "fail");
+}
+
+static void test_fis_verify_from_char_array(test_signer_t* signer) {
+  const uint8_t msg[]   = {'a'};
+  const uint8_t other[] = {'b'};
+  fis_signature_t* sig  = fis_sign(&signer->pp, &signer->private_key, msg, sizeof(msg));
+  if (!sig) {
+    printf("fis verify from char array: fail\n");
+    return;
+  }
+
+  unsigned int len    = 0;
+  unsigned char* data = fis_sig_to_char_array(&signer->pp, sig, &len);
+  fis_free_signature(&signer->pp, sig);
+
+  fis_public_key_t* pk = &signer->public_key;
+  bool ok = !fis_verify_from_char_array(&signer->pp, pk, msg, sizeof(msg), data, len) &&
+            fis_verify_from_char_array(&signer->pp, pk, other, sizeof(other), data, len);
+  // buffers of the wrong length and invalid challenges are rejected
+  ok = ok && fis_verify_from_char_array(&signer->pp, pk, msg, sizeof(msg), data, len - 1) &&
+       fis_verify_from_char_array(&signer->pp, pk, msg, sizeof(msg), data, 1);
+  data[0] = 0xff;
+  ok      = ok && fis_verify_from_char_array(&signer->pp, pk, msg, sizeof(msg), data, len);
+
+  free(data);
+  printf("fis verify from char array: %s\n", ok ? "ok" : "fail");
+}
+
 void run_tests(void) {
   test_mpc_share();
   test_mpc_add();
   test_mzd_local_equal();
+  test_mzd_arena();
   test_mzd_mul();
   test_mzd_shift();
+  test_mzd_mul_vl();
+  test_mzd_randomize_prng();
+  test_view_assign();
+  test_lowmc_init_from_seed();
+  test_lowmc_kernels();
+  test_sbox();
+  test_mpc_sbox_x2();
+  test_lowmc_key_schedule_linear();
+  test_lowmc_key_schedule();
+  test_mpc_rounds();
+#ifdef REDUCED_ROUND_KEYS
+  test_lowmc_folded();
+#endif
+  test_aes_prng();
+  test_aes_prng_multiple();
+  test_rand_bytes();
+  test_sha256_multi();
+
+  test_signer_t signer;
+  if (!test_signer_init(&signer)) {
+    printf("signer: fail\n");
+    return;
+  }
+  test_fis_threads(&signer);
+  test_fis_presig_pool(&signer);
+  test_fis_sign_batch(&signer);
+  test_fis_verify_batch(&signer);
+  test_fis_sign_with_ctx(&signer);
+#ifdef COUNT_HEAP_ALLOCATIONS
+  test_fis_sign_ctx_init_failure(&signer);
+  test_fis_sign_batch_failure(&signer);
+  test_fis_sig_parse_view_failure(&signer);
+#endif
+  test_fis_sig_serialize(&signer);
+  test_fis_verify_from_char_array(&signer);
+  test_signer_clear(&signer);
 }
 
 int main() {
+#ifdef COUNT_HEAP_ALLOCATIONS
+  // has to happen before OpenSSL allocates anything
+  if (!count_openssl_allocations()) {
+    printf("counting OpenSSL allocations: fail\n");
+  }
+#endif
   init_rand_bytes();
   init_EVP();
   openmp_thread_setup();
@@ -37,6 +37,14 @@ static rci_t calculate_rowstride(rci_t width) {
   }
 }
 
+// Number of memory blocks allocated by mzd_local_init_ex, mzd_local_init_multiple_ex and arenas in
+// the current thread.
+static _Thread_local uint64_t mzd_local_allocations;
+
+uint64_t mzd_local_allocation_count(void) {
+  return mzd_local_allocations;
+}
+
 // Notes on the memory layout: mzd_init allocates multiple memory blocks (one
 // for mzd_t, one for rows and multiple for the buffers). We use one memory
 // block for mzd_t, rows and the buffer. This improves memory locality and
@@ -45,17 +53,31 @@ static rci_t calculate_rowstride(rci_t width) {
 // In mzd_local_init_multiple we do the same, but store n mzd_t instances in one
 // memory block.
 
-mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
+rci_t mzd_local_rowstride(rci_t c) {
+  return calculate_rowstride((c + m4ri_radix - 1) / m4ri_radix);
+}
+
+size_t mzd_local_size(rci_t r, rci_t c) {
+  const rci_t width     = (c + m4ri_radix - 1) / m4ri_radix;
+  const rci_t rowstride = calculate_rowstride(width);
+
+  const size_t buffer_size = r * rowstride * sizeof(word);
+  const size_t rows_size   = r * sizeof(word*);
+
+  return (mzd_t_size + buffer_size + rows_size + 31) & ~31;
+}
+
+// Sets up an mzd_t instance in buffer, which needs to be 32 byte aligned and hold the mzd_t
+// followed by the rows. The row pointers are stored in rows.
+static mzd_t* mzd_local_setup_rows(unsigned char* buffer, rci_t r, rci_t c, bool clear,
+                                   word** rows) {
   const rci_t width       = (c + m4ri_radix - 1) / m4ri_radix;
   const rci_t rowstride   = calculate_rowstride(width);
   const word high_bitmask = __M4RI_LEFT_BITMASK(c % m4ri_radix);
   const uint8_t flags =
       mzd_flag_custom_layout | ((high_bitmask != m4ri_ffff) ? mzd_flag_nonzero_excess : 0);
 
-  const size_t buffer_size   = r * rowstride * sizeof(word);
-  const size_t rows_size     = r * sizeof(word*);
-
-  unsigned char* buffer = aligned_alloc(32, (mzd_t_size + buffer_size + rows_size + 31) & ~31);
+  const size_t buffer_size = r * rowstride * sizeof(word);
 
   mzd_t* A = (mzd_t*)buffer;
   buffer += mzd_t_size;
@@ -64,7 +86,7 @@ mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
     memset(buffer, 0, buffer_size);
   }
 
-  A->rows = (word**)(buffer + buffer_size);
+  A->rows = rows;
   for (rci_t i = 0; i < r; ++i, buffer += rowstride * sizeof(word)) {
     A->rows[i] = (word*)(buffer);
   }
@@ -94,69 +116,118 @@ mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
   return A;
 }
 
+// Sets up an mzd_t instance in buffer, which needs to be 32 byte aligned and of size
+// mzd_local_size(r, c).
+static mzd_t* mzd_local_setup(unsigned char* buffer, rci_t r, rci_t c, bool clear) {
+  const size_t buffer_size = r * mzd_local_rowstride(c) * sizeof(word);
+  return mzd_local_setup_rows(buffer, r, c, clear, (word**)(buffer + mzd_t_size + buffer_size));
+}
+
+mzd_t* mzd_local_setup_in_place(void* buffer, rci_t r, rci_t c, word** rows) {
+  return mzd_local_setup_rows(buffer, r, c, false, rows);
+}
+
+mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) {
+  unsigned char* buffer = aligned_alloc(32, mzd_local_size(r, c));
+  if (!buffer) {
+    return NULL;
+  }
+  ++mzd_local_allocations;
+
+  return mzd_local_setup(buffer, r, c, clear);
+}
+
 void mzd_local_free(mzd_t* v) {
   // assert(!v || (v->flags & mzd_flag_custom_layout));
   free(v);
 }
 
-void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear) {
-  const rci_t width       = (c + m4ri_radix - 1) / m4ri_radix;
-  const rci_t rowstride   = calculate_rowstride(width);
-  const word high_bitmask = __M4RI_LEFT_BITMASK(c % m4ri_radix);
-  const uint8_t flags =
-      mzd_flag_custom_layout | ((high_bitmask != m4ri_ffff) ? mzd_flag_nonzero_excess : 0);
-
-  const size_t buffer_size   = r * rowstride * sizeof(word);
-  const size_t rows_size     = r * sizeof(word*);
-  const size_t size_per_elem = (mzd_t_size + buffer_size + rows_size + 31) & ~31;
+bool mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear) {
+  const size_t size_per_elem = mzd_local_size(r, c);
 
-  unsigned char* full_buffer = aligned_alloc(32, size_per_elem * n);
+  unsigned char* full_buffer =
+      n <= SIZE_MAX / size_per_elem ? aligned_alloc(32, size_per_elem * n) : NULL;
+  if (!full_buffer) {
+    memset(dst, 0, n * sizeof(mzd_t*));
+    return false;
+  }
+  ++mzd_local_allocations;
 
   for (size_t s = 0; s < n; ++s, full_buffer += size_per_elem) {
-    unsigned char* buffer = full_buffer;
-    mzd_t* A              = (mzd_t*)buffer;
-    dst[s]                = A;
+    dst[s] = mzd_local_setup(full_buffer, r, c, clear);
+  }
+  return true;
+}
 
-    buffer += mzd_t_size;
+void mzd_local_free_multiple(mzd_t** vs) {
+  if (vs) {
+    // assert(!vs[0] || (vs[0]->flags & mzd_flag_custom_layout));
+    free(vs[0]);
+  }
+}
 
-    if (clear) {
-      memset(buffer, 0, buffer_size);
-    }
+struct mzd_arena_block_s {
+  mzd_arena_block_t* next;
+  size_t size;
+  size_t used;
+};
 
-    A->rows = (word**)(buffer + buffer_size);
-    for (rci_t i = 0; i < r; ++i, buffer += rowstride * sizeof(word)) {
-      A->rows[i] = (word*)(buffer);
-    }
+static const size_t arena_header_size = (sizeof(mzd_arena_block_t) + 31) & ~31;
 
-    // assign in order
-    A->nrows         = r;
-    A->ncols         = c;
-    A->width         = width;
-    A->rowstride     = rowstride;
-    A->offset_vector = 0;
-    A->row_offset    = 0;
-    A->flags         = flags;
-    A->blockrows_log = 0;
-    A->high_bitmask  = high_bitmask;
-    A->blocks        = NULL;
+void mzd_arena_init(mzd_arena_t* arena, size_t block_size) {
+  arena->head       = NULL;
+  arena->block_size = block_size;
+}
 
-#if M4RI_VERSION < 20130808
-    // workaround for old m4ri versions (untested)
-    A->offset = 0;
-    if (width == 1) {
-      A->low_bitmask = A->high_bitmask = __M4RI_MIDDLE_BITMASK(c, 0);
-    } else {
-      A->low_bitmask = m4ri_ffff;
-    }
-#endif
+void mzd_arena_clear(mzd_arena_t* arena) {
+  mzd_arena_block_t* block = arena->head;
+  while (block) {
+    mzd_arena_block_t* next = block->next;
+    free(block);
+    block = next;
   }
+  arena->head = NULL;
 }
 
-void mzd_local_free_multiple(mzd_t** vs) {
-  if (vs) {
-    // assert(!vs[0] || (vs[0]->flags & mzd_flag_custom_layout));
-    free(vs[0]);
+void mzd_arena_reset(mzd_arena_t* arena) {
+  mzd_arena_block_t* head = arena->head;
+  if (head) {
+    arena->head = head->next;
+    mzd_arena_clear(arena);
+
+    head->next  = NULL;
+    head->used  = 0;
+    arena->head = head;
+  }
+}
+
+void* mzd_arena_alloc(mzd_arena_t* arena, size_t size) {
+  size = (size + 31) & ~31;
+
+  mzd_arena_block_t* block = arena->head;
+  if (!block || block->size - block->used < size) {
+    const size_t block_size = size > arena->block_size ? size : arena->block_size;
+
+    block = aligned_alloc(32, arena_header_size + block_size);
+    if (!block) {
+      return NULL;
+    }
+    ++mzd_local_allocations;
+
+    block->next = arena->head;
+    block->size = block_size;
+    block->used = 0;
+    arena->head = block;
   }
+
+  void* ptr = (unsigned char*)block + arena_header_size + block->used;
+  block->used += size;
+  return ptr;
+}
+
+mzd_t* mzd_arena_init_mzd(mzd_arena_t* arena, rci_t r, rci_t c, bool clear) {
+  unsigned char* buffer = mzd_arena_alloc(arena, mzd_local_size(r, c));
+  return buffer ? mzd_local_setup(buffer, r, c, clear) : NULL;
 }
 
 mzd_t* mzd_local_copy(mzd_t* dst, mzd_t const* src) {
@@ -173,7 +244,7 @@ mzd_t* mzd_local_copy(mzd_t* dst, mzd_t const* src) {
     if (src->flags & mzd_flag_custom_layout) {
       memcpy(__builtin_assume_aligned(FIRST_ROW(dst), 32),
              __builtin_assume_aligned(CONST_FIRST_ROW(src), 32),
-             src->nrows * sizeof(word) * src->width);
+             src->nrows * sizeof(word) * src->rowstride);
     } else {
       // src can be a mzd_t* from mzd_init, so we can only copy row wise
       for (rci_t i = 0; i < src->nrows; ++i) {
@@ -221,15 +292,30 @@ static void mzd_randomize_aes_prng(mzd_t* v, aes_prng_t* aes_prng) {
   }
 }
 
+static void mzd_row_randomize_aes_prng(word* row, rci_t c, aes_prng_t* aes_prng) {
+  const rci_t width       = (c + m4ri_radix - 1) / m4ri_radix;
+  const word high_bitmask = __M4RI_LEFT_BITMASK(c % m4ri_radix);
+
+  aes_prng_get_randomness(aes_prng, (unsigned char*)row, width * sizeof(word));
+  row[width - 1] &= high_bitmask;
+}
+
+void mzd_randomize_prng(mzd_t* A, aes_prng_t* aes_prng) {
+  for (rci_t i = 0; i < A->nrows; ++i) {
+    mzd_row_randomize_aes_prng(A->rows[i], A->ncols, aes_prng);
+  }
+}
+
 mzd_t* mzd_init_random_vector(rci_t n) {
-  mzd_t* A = mzd_local_init_ex(1, n, false);
+  // the padding is processed by the SIMD implementations and needs to be cleared
+  mzd_t* A = mzd_local_init_ex(1, n, true);
   mzd_randomize_ssl(A);
 
   return A;
 }
 
 mzd_t* mzd_init_random_vector_prng(rci_t n, aes_prng_t* aes_prng) {
-  mzd_t* v = mzd_local_init_ex(1, n, false);
+  mzd_t* v = mzd_local_init_ex(1, n, true);
   mzd_randomize_aes_prng(v, aes_prng);
   return v;
 }
@@ -241,6 +327,19 @@ void mzd_randomize_from_seed(mzd_t* vector, const unsigned char key[16]) {
   aes_prng_clear(&aes_prng);
 }
 
+void mzd_row_randomize_from_seed(word* row, rci_t c, const unsigned char key[16]) {
+  aes_prng_t aes_prng;
+  aes_prng_init(&aes_prng, key);
+  mzd_row_randomize_aes_prng(row, c, &aes_prng);
+  aes_prng_clear(&aes_prng);
+}
+
+void mzd_row_randomize_from_seed_prng(word* row, rci_t c, const unsigned char key[16],
+                                      aes_prng_t* aes_prng) {
+  aes_prng_reseed(aes_prng, key);
+  mzd_row_randomize_aes_prng(row, c, aes_prng);
+}
+
 mzd_t* mzd_init_random_vector_from_seed(const unsigned char key[16], rci_t n) {
   mzd_t* vector = mzd_local_init_ex(1, n, false);
   mzd_randomize_from_seed(vector, key);
@@ -259,6 +358,58 @@ void mzd_randomize_multiple_from_seed(mzd_t** vectors, unsigned int count,
   aes_prng_clear(&aes_prng);
 }
 
+void mzd_randomize_multiple_from_seed_prng(mzd_t** vectors, unsigned int count,
+                                           const unsigned char key[16], aes_prng_t* aes_prng) {
+  aes_prng_reseed(aes_prng, key);
+
+  for (unsigned int v = 0; v < count; ++v) {
+    mzd_randomize_aes_prng(vectors[v], aes_prng);
+  }
+}
+
+void mzd_randomize_multiple_from_seeds_prng(mzd_t** const* vectors, unsigned int count,
+                                            const unsigned char* keys, unsigned int seeds,
+                                            aes_prng_t* aes_prngs) {
+  unsigned char* dst[MZD_RANDOMIZE_MAX_SEEDS];
+  for (unsigned int s = 0; s < seeds; ++s) {
+    aes_prng_reseed(&aes_prngs[s], keys + s * PRNG_KEYSIZE);
+  }
+
+  for (unsigned int v = 0; v < count; ++v) {
+    // all vectors with the same index have the same dimensions
+    mzd_t const* first  = vectors[0][v];
+    const word mask_end = first->high_bitmask;
+    const size_t len1   = first->width - 1;
+
+    for (unsigned int s = 0; s < seeds; ++s) {
+      dst[s] = (unsigned char*)FIRST_ROW(vectors[s][v]);
+    }
+    aes_prng_get_randomness_multiple(aes_prngs, seeds, dst,
+                                     first->width * sizeof(word) * first->nrows);
+    if (mask_end != m4ri_ffff) {
+      for (unsigned int s = 0; s < seeds; ++s) {
+        for (rci_t i = 0; i < first->nrows; ++i) {
+          vectors[s][v]->rows[i][len1] &= mask_end;
+        }
+      }
+    }
+  }
+}
+
+void mzd_randomize_multiple_from_seeds(mzd_t** const* vectors, unsigned int count,
+                                       const unsigned char* keys, unsigned int seeds) {
+  aes_prng_t aes_prngs[MZD_RANDOMIZE_MAX_SEEDS];
+  for (unsigned int s = 0; s < seeds; ++s) {
+    aes_prng_init(&aes_prngs[s], keys + s * PRNG_KEYSIZE);
+  }
+
+  mzd_randomize_multiple_from_seeds_prng(vectors, count, keys, seeds, aes_prngs);
+
+  for (unsigned int s = 0; s < seeds; ++s) {
+    aes_prng_clear(&aes_prngs[s]);
+  }
+}
+
 mzd_t** mzd_init_random_vectors_from_seed(const unsigned char key[16], rci_t n,
                                           unsigned int count) {
   mzd_t** vectors = malloc(count * sizeof(mzd_t*));
@@ -926,16 +1077,17 @@ static void xor_comb(const unsigned int len, const word mask, word* Brow, word**
  * Pre-compute matrices for faster mzd_addmul_v computions.
  *
  */
-mzd_t* mzd_precompute_matrix_lookup(mzd_t const* A) {
-  mzd_t* B = mzd_local_init_ex(32 * A->nrows, A->ncols, true);
+mzd_t* mzd_precompute_matrix_lookup(mzd_t const* A, unsigned int bits) {
+  mzd_t* B = mzd_local_init_ex(((1 << bits) / bits) * A->nrows, A->ncols, true);
 
-  const unsigned int len = A->width;
-  const word mask        = A->high_bitmask;
-  word** const Arows     = A->rows;
+  const unsigned int len      = A->width;
+  const word mask             = A->high_bitmask;
+  word** const Arows          = A->rows;
+  const unsigned int combmask = (1 << bits) - 1;
 
   for (unsigned int r = 0; r < B->nrows; ++r) {
-    const unsigned int comb     = r & 0xff;
-    const unsigned int r_offset = (r >> 8) * 8;
+    const unsigned int comb     = r & combmask;
+    const unsigned int r_offset = (r >> bits) * bits;
     if (!comb) {
       continue;
     }
@@ -946,21 +1098,36 @@ mzd_t* mzd_precompute_matrix_lookup(mzd_t const* A) {
   return B;
 }
 
+unsigned int mzd_lookup_bits(mzd_t const* A, rci_t vcols) {
+  if (A->nrows == 32 * vcols) {
+    return 8;
+  }
+  if (A->nrows == 4 * vcols) {
+    return 4;
+  }
+  return 0;
+}
+
+/**
+ * The lookup table based products process the vector in chunks of bits bits. The table holds
+ * 1 << bits rows for each chunk, so the rows for the i-th chunk start at i << bits.
+ */
 #ifdef WITH_OPT
 #ifdef WITH_SSE2
-__attribute__((target("sse2"))) static inline mzd_t* mzd_mul_vl_sse_128(mzd_t* c, mzd_t const* v,
-                                                                        mzd_t const* A) {
-  word const* vptr                = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
-  const unsigned int width        = v->width;
-  static const unsigned int moff2 = 256;
+__attribute__((target("sse2"))) static inline mzd_t*
+mzd_mul_vl_sse_128(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
+  word const* vptr         = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
+  const unsigned int width = v->width;
+  const unsigned int moff2 = 1 << bits;
+  const word combmask      = moff2 - 1;
 
   __m128i mc           = _mm_setzero_si128();
   __m128i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 16);
 
   for (unsigned int w = width; w; --w, ++vptr) {
-    word idx              = *vptr;
-    for (unsigned int s = sizeof(word); s; --s, idx >>= 8, mAptr += moff2) {
-      const word comb = idx & 0xff;
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, mAptr += moff2) {
+      const word comb = idx & combmask;
       mc              = _mm_xor_si128(mc, mAptr[comb]);
     }
   }
@@ -970,20 +1137,21 @@ __attribute__((target("sse2"))) static inline mzd_t* mzd_mul_vl_sse_128(mzd_t* c
   return c;
 }
 
-__attribute__((target("sse2"))) static inline mzd_t* mzd_addmul_vl_sse_128(mzd_t* c, mzd_t const* v,
-                                                                           mzd_t const* A) {
-  word const* vptr                = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
-  const unsigned int width        = v->width;
-  static const unsigned int moff2 = 256;
+__attribute__((target("sse2"))) static inline mzd_t*
+mzd_addmul_vl_sse_128(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
+  word const* vptr         = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
+  const unsigned int width = v->width;
+  const unsigned int moff2 = 1 << bits;
+  const word combmask      = moff2 - 1;
 
   __m128i* mcptr       = __builtin_assume_aligned(FIRST_ROW(c), 16);
   __m128i mc           = *mcptr;
   __m128i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 16);
 
   for (unsigned int w = width; w; --w, ++vptr) {
-    word idx              = *vptr;
-    for (unsigned int s = sizeof(word); s; --s, idx >>= 8, mAptr += moff2) {
-      const word comb = idx & 0xff;
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, mAptr += moff2) {
+      const word comb = idx & combmask;
       mc              = _mm_xor_si128(mc, mAptr[comb]);
     }
   }
@@ -992,44 +1160,52 @@ __attribute__((target("sse2"))) static inline mzd_t* mzd_addmul_vl_sse_128(mzd_t
   return c;
 }
 
-__attribute__((target("sse2"))) static inline mzd_t* mzd_addmul_vl_sse(mzd_t* c, mzd_t const* v,
-                                                                       mzd_t const* A) {
+__attribute__((target("sse2"))) static inline mzd_t*
+mzd_addmul_vl_sse(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
   const unsigned int len        = A->width * sizeof(word) / sizeof(__m128i);
   word const* vptr              = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
   const unsigned int width      = v->width;
   const unsigned int rowstride  = A->rowstride;
   const unsigned int mrowstride = rowstride * sizeof(word) / sizeof(__m128i);
-  const unsigned int moff2      = 256 * mrowstride;
+  const unsigned int moff2      = mrowstride << bits;
+  const word combmask           = (1 << bits) - 1;
 
   __m128i* mcptr       = __builtin_assume_aligned(FIRST_ROW(c), 16);
   __m128i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 16);
 
   for (unsigned int w = width; w; --w, ++vptr) {
-    word idx              = *vptr;
-    for (unsigned int s = sizeof(word); s; --s, idx >>= 8, mAptr += moff2) {
-      const word comb = idx & 0xff;
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, mAptr += moff2) {
+      const word comb = idx & combmask;
       mm128_xor_region(mcptr, mAptr + comb * mrowstride, len);
     }
   }
 
   return c;
 }
+
+__attribute__((target("sse2"))) static inline mzd_t*
+mzd_mul_vl_sse(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
+  mzd_local_clear(c);
+  return mzd_addmul_vl_sse(c, v, A, bits);
+}
 #endif
 
 #ifdef WITH_AVX2
-__attribute__((target("avx2"))) static inline mzd_t* mzd_mul_vl_avx_256(mzd_t* c, mzd_t const* v,
-                                                                        mzd_t const* A) {
-  word const* vptr                = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
-  const unsigned int width        = v->width;
-  static const unsigned int moff2 = 256;
+__attribute__((target("avx2"))) static inline mzd_t*
+mzd_mul_vl_avx_256(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
+  word const* vptr         = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
+  const unsigned int width = v->width;
+  const unsigned int moff2 = 1 << bits;
+  const word combmask      = moff2 - 1;
 
-  __m256i mc = _mm256_setzero_si256();
+  __m256i mc           = _mm256_setzero_si256();
   __m256i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 32);
 
   for (unsigned int w = width; w; --w, ++vptr) {
-    word idx              = *vptr;
-    for (unsigned int s = sizeof(word); s; --s, idx >>= 8, mAptr += moff2) {
-      const word comb = idx & 0xff;
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, mAptr += moff2) {
+      const word comb = idx & combmask;
       mc              = _mm256_xor_si256(mc, mAptr[comb]);
     }
   }
@@ -1039,20 +1215,21 @@ __attribute__((target("avx2"))) static inline mzd_t* mzd_mul_vl_avx_256(mzd_t* c
   return c;
 }
 
-__attribute__((target("avx2"))) static inline mzd_t* mzd_addmul_vl_avx_256(mzd_t* c, mzd_t const* v,
-                                                                           mzd_t const* A) {
-  word const* vptr                = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
-  const unsigned int width        = v->width;
-  static const unsigned int moff2 = 256;
+__attribute__((target("avx2"))) static inline mzd_t*
+mzd_addmul_vl_avx_256(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
+  word const* vptr         = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
+  const unsigned int width = v->width;
+  const unsigned int moff2 = 1 << bits;
+  const word combmask      = moff2 - 1;
 
   __m256i* mcptr       = __builtin_assume_aligned(FIRST_ROW(c), 32);
   __m256i mc           = *mcptr;
   __m256i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 32);
 
   for (unsigned int w = width; w; --w, ++vptr) {
-    word idx              = *vptr;
-    for (unsigned int s = sizeof(word); s; --s, idx >>= 8, mAptr += moff2) {
-      const word comb = idx & 0xff;
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, mAptr += moff2) {
+      const word comb = idx & combmask;
       mc              = _mm256_xor_si256(mc, mAptr[comb]);
     }
   }
@@ -1061,114 +1238,301 @@ __attribute__((target("avx2"))) static inline mzd_t* mzd_addmul_vl_avx_256(mzd_t
   return c;
 }
 
-__attribute__((target("avx2"))) static inline mzd_t* mzd_addmul_vl_avx(mzd_t* c, mzd_t const* v,
-                                                                       mzd_t const* A) {
+__attribute__((target("avx2"))) static inline mzd_t*
+mzd_addmul_vl_avx(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
   const unsigned int len        = A->width * sizeof(word) / sizeof(__m256i);
   word const* vptr              = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);
   const unsigned int width      = v->width;
   const unsigned int rowstride  = A->rowstride;
   const unsigned int mrowstride = rowstride * sizeof(word) / sizeof(__m256i);
-  const unsigned int moff2      = 256 * mrowstride;
+  const unsigned int moff2      = mrowstride << bits;
+  const word combmask           = (1 << bits) - 1;
 
   __m256i* mcptr       = __builtin_assume_aligned(FIRST_ROW(c), 32);
   __m256i const* mAptr = __builtin_assume_aligned(CONST_FIRST_ROW(A), 32);
 
   for (unsigned int w = width; w; --w, ++vptr) {
-    word idx              = *vptr;
-    for (unsigned int s = sizeof(word); s; --s, idx >>= 8, mAptr += moff2) {
-      const word comb = idx & 0xff;
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, mAptr += moff2) {
+      const word comb = idx & combmask;
       mm256_xor_region(mcptr, mAptr + comb * mrowstride, len);
     }
   }
 
   return c;
 }
+
+__attribute__((target("avx2"))) static inline mzd_t*
+mzd_mul_vl_avx(mzd_t* c, mzd_t const* v, mzd_t const* A, const unsigned int bits) {
+  mzd_local_clear(c);
+  return mzd_addmul_vl_avx(c, v, A, bits);
+}
 #endif
 #endif
 
-mzd_t* mzd_mul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
-  if (A->nrows != 32 * v->ncols) {
-    // number of columns does not match
-    return NULL;
-  }
+#ifdef WITH_AVX512
+/**
+ * Lookup table based products for AVX-512. Each output row fits into one register of size 128, 256
+ * or 512 bits. Two table entries are combined per step with a single ternary logic instruction,
+ * which halves the length of the dependency chain on the accumulator.
+ */
+#define mzd_addmul_vl_avx512_impl(type, load, xor3)                                                \
+  do {                                                                                             \
+    word const* vptr         = __builtin_assume_aligned(CONST_FIRST_ROW(v), 16);                   \
+    const unsigned int width = v->width;                                                           \
+    const unsigned int moff2 = 1 << bits;                                                          \
+    const word combmask      = moff2 - 1;                                                          \
+                                                                                                   \
+    type const* mAptr = (type const*)CONST_FIRST_ROW(A);                                           \
+                                                                                                   \
+    for (unsigned int w = width; w; --w, ++vptr) {                                                 \
+      word idx = *vptr;                                                                            \
+      for (unsigned int s = sizeof(word) * 4 / bits; s; --s, idx >>= 2 * bits,                     \
+                        mAptr += 2 * moff2) {                                                      \
+        const word comb0 = idx & combmask;                                                         \
+        const word comb1 = (idx >> bits) & combmask;                                               \
+        mc               = xor3(mc, load(mAptr + comb0), load(mAptr + moff2 + comb1), 0x96);       \
+      }                                                                                            \
+    }                                                                                              \
+  } while (0)
+
+__attribute__((target("avx512f,avx512vl"))) static inline mzd_t*
+mzd_addmul_vl_avx512_128(mzd_t* c, mzd_t const* v, mzd_t const* A, bool add,
+                         const unsigned int bits) {
+  __m128i* mcptr = __builtin_assume_aligned(FIRST_ROW(c), 16);
+  __m128i mc     = add ? *mcptr : _mm_setzero_si128();
+  mzd_addmul_vl_avx512_impl(__m128i, _mm_load_si128, _mm_ternarylogic_epi64);
+  *mcptr = mc;
+  return c;
+}
 
-#ifdef WITH_OPT
-  if (A->nrows % (sizeof(word) * 8) == 0) {
-#ifdef WITH_AVX2
-    if (CPU_SUPPORTS_AVX2) {
-      if (A->ncols == 256) {
-        return mzd_mul_vl_avx_256(c, v, A);
-      }
-    }
+__attribute__((target("avx512f,avx512vl"))) static inline mzd_t*
+mzd_addmul_vl_avx512_256(mzd_t* c, mzd_t const* v, mzd_t const* A, bool add,
+                         const unsigned int bits) {
+  __m256i* mcptr = __builtin_assume_aligned(FIRST_ROW(c), 32);
+  __m256i mc     = add ? *mcptr : _mm256_setzero_si256();
+  mzd_addmul_vl_avx512_impl(__m256i, _mm256_load_si256, _mm256_ternarylogic_epi64);
+  *mcptr = mc;
+  return c;
+}
+
+// rows are only 32 byte aligned, hence the unaligned loads and stores
+__attribute__((target("avx512f,avx512vl"))) static inline mzd_t*
+mzd_addmul_vl_avx512_512(mzd_t* c, mzd_t const* v, mzd_t const* A, bool add,
+                         const unsigned int bits) {
+  word* mcptr = FIRST_ROW(c);
+  __m512i mc  = add ? _mm512_loadu_si512(mcptr) : _mm512_setzero_si512();
+  mzd_addmul_vl_avx512_impl(__m512i, _mm512_loadu_si512, _mm512_ternarylogic_epi64);
+  _mm512_storeu_si512(mcptr, mc);
+  return c;
+}
+
+#undef mzd_addmul_vl_avx512_impl
 #endif
-#ifdef WITH_SSE2
-    if (CPU_SUPPORTS_SSE2) {
-      if (A->ncols == 128) {
-        return mzd_mul_vl_sse_128(c, v, A);
+
+static inline mzd_t* mzd_addmul_vl_uint64(mzd_t* c, mzd_t const* v, mzd_t const* A,
+                                          const unsigned int bits) {
+  const unsigned int len    = A->width;
+  const word mask           = A->high_bitmask;
+  word* cptr                = FIRST_ROW(c);
+  word const* vptr          = CONST_FIRST_ROW(v);
+  const unsigned int width  = v->width;
+  const unsigned int chunks = sizeof(word) * 8 / bits;
+  const word combmask       = (1 << bits) - 1;
+
+  for (unsigned int w = 0; w < width; ++w, ++vptr) {
+    word idx         = *vptr;
+    unsigned int add = 0;
+
+    while (idx) {
+      const word comb = idx & combmask;
+
+      word const* Aptr = A->rows[((w * chunks) << bits) + add + comb];
+      for (unsigned int i = 0; i < len - 1; ++i) {
+        cptr[i] ^= Aptr[i];
       }
+      cptr[len - 1] = (cptr[len - 1] ^ Aptr[len - 1]) & mask;
+
+      idx >>= bits;
+      add += 1 << bits;
     }
-#endif
   }
-#endif
 
+  return c;
+}
+
+static inline mzd_t* mzd_mul_vl_uint64(mzd_t* c, mzd_t const* v, mzd_t const* A,
+                                       const unsigned int bits) {
   mzd_local_clear(c);
-  return mzd_addmul_vl(c, v, A);
+  return mzd_addmul_vl_uint64(c, v, A, bits);
 }
 
-mzd_t* mzd_addmul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
-  if (A->ncols != c->ncols || A->nrows != 32 * v->ncols) {
-    // number of columns does not match
-    return NULL;
+/**
+ * Lookup table based products for tables with 64 columns. The table rows are addressed through the
+ * row stride instead of the row pointers and the result is accumulated in a register.
+ */
+static inline mzd_t* mzd_addmul_vl_uint64_64(mzd_t* c, mzd_t const* v, mzd_t const* A, bool add,
+                                             const unsigned int bits) {
+  word const* vptr             = CONST_FIRST_ROW(v);
+  const unsigned int width     = v->width;
+  const unsigned int rowstride = A->rowstride;
+  const unsigned int moff2     = rowstride << bits;
+  const word combmask          = (1 << bits) - 1;
+
+  word* cptr       = FIRST_ROW(c);
+  word mc          = add ? *cptr : 0;
+  word const* Aptr = CONST_FIRST_ROW(A);
+
+  for (unsigned int w = width; w; --w, ++vptr) {
+    word idx = *vptr;
+    for (unsigned int s = sizeof(word) * 8 / bits; s; --s, idx >>= bits, Aptr += moff2) {
+      mc ^= Aptr[(idx & combmask) * rowstride];
+    }
+  }
+
+  *cptr = mc;
+  return c;
+}
+
+/**
+ * Instantiates the kernel expression expr for tables with 4 and 8 bit chunks as name_4 and name_8.
+ */
+#define mzd_vl_instantiate(attr, name, expr)                                                       \
+  attr static mzd_t* name##_4(mzd_t* c, mzd_t const* v, mzd_t const* A) {                          \
+    const unsigned int bits = 4;                                                                   \
+    return expr;                                                                                   \
+  }                                                                                                \
+  attr static mzd_t* name##_8(mzd_t* c, mzd_t const* v, mzd_t const* A) {                          \
+    const unsigned int bits = 8;                                                                   \
+    return expr;                                                                                   \
   }
 
+mzd_vl_instantiate(, mzd_mul_vl_uint64, mzd_mul_vl_uint64(c, v, A, bits))
+mzd_vl_instantiate(, mzd_addmul_vl_uint64, mzd_addmul_vl_uint64(c, v, A, bits))
+mzd_vl_instantiate(, mzd_mul_vl_uint64_64, mzd_addmul_vl_uint64_64(c, v, A, false, bits))
+mzd_vl_instantiate(, mzd_addmul_vl_uint64_64_add, mzd_addmul_vl_uint64_64(c, v, A, true, bits))
+
 #ifdef WITH_OPT
-  if (A->nrows % (sizeof(word) * 8) == 0) {
+#ifdef WITH_SSE2
+mzd_vl_instantiate(__attribute__((target("sse2"))), mzd_mul_vl_sse_128,
+                   mzd_mul_vl_sse_128(c, v, A, bits))
+mzd_vl_instantiate(__attribute__((target("sse2"))), mzd_addmul_vl_sse_128,
+                   mzd_addmul_vl_sse_128(c, v, A, bits))
+mzd_vl_instantiate(__attribute__((target("sse2"))), mzd_mul_vl_sse, mzd_mul_vl_sse(c, v, A, bits))
+mzd_vl_instantiate(__attribute__((target("sse2"))), mzd_addmul_vl_sse,
+                   mzd_addmul_vl_sse(c, v, A, bits))
+#endif
+
+#ifdef WITH_AVX2
+mzd_vl_instantiate(__attribute__((target("avx2"))), mzd_mul_vl_avx_256,
+                   mzd_mul_vl_avx_256(c, v, A, bits))
+mzd_vl_instantiate(__attribute__((target("avx2"))), mzd_addmul_vl_avx_256,
+                   mzd_addmul_vl_avx_256(c, v, A, bits))
+mzd_vl_instantiate(__attribute__((target("avx2"))), mzd_mul_vl_avx, mzd_mul_vl_avx(c, v, A, bits))
+mzd_vl_instantiate(__attribute__((target("avx2"))), mzd_addmul_vl_avx,
+                   mzd_addmul_vl_avx(c, v, A, bits))
+#endif
+#endif
+
+#ifdef WITH_AVX512
+mzd_vl_instantiate(__attribute__((target("avx512f,avx512vl"))), mzd_mul_vl_avx512_128,
+                   mzd_addmul_vl_avx512_128(c, v, A, false, bits))
+mzd_vl_instantiate(__attribute__((target("avx512f,avx512vl"))), mzd_addmul_vl_avx512_128_add,
+                   mzd_addmul_vl_avx512_128(c, v, A, true, bits))
+mzd_vl_instantiate(__attribute__((target("avx512f,avx512vl"))), mzd_mul_vl_avx512_256,
+                   mzd_addmul_vl_avx512_256(c, v, A, false, bits))
+mzd_vl_instantiate(__attribute__((target("avx512f,avx512vl"))), mzd_addmul_vl_avx512_256_add,
+                   mzd_addmul_vl_avx512_256(c, v, A, true, bits))
+mzd_vl_instantiate(__attribute__((target("avx512f,avx512vl"))), mzd_mul_vl_avx512_512,
+                   mzd_addmul_vl_avx512_512(c, v, A, false, bits))
+mzd_vl_instantiate(__attribute__((target("avx512f,avx512vl"))), mzd_addmul_vl_avx512_512_add,
+                   mzd_addmul_vl_avx512_512(c, v, A, true, bits))
+#endif
+
+#undef mzd_vl_instantiate
+
+// selects name_4 or name_8 depending on bits
+#define mzd_vl_pick(name) (bits == 4 ? name##_4 : name##_8)
+
+static mzd_mul_vl_fn mzd_mul_vl_select_impl(rci_t n, rci_t vcols, unsigned int bits, bool add) {
+#ifdef WITH_OPT
+  if (vcols % (sizeof(word) * 8) == 0) {
+#ifdef WITH_AVX512
+    // rows with n in {128, 192, 256, 384, 512} are padded to 128, 256 and 512 bits with zeros, so
+    // the padding is processed as well
+    if (CPU_SUPPORTS_AVX512) {
+      switch (n) {
+      case 128:
+        return add ? mzd_vl_pick(mzd_addmul_vl_avx512_128_add)
+                   : mzd_vl_pick(mzd_mul_vl_avx512_128);
+      case 192:
+      case 256:
+        return add ? mzd_vl_pick(mzd_addmul_vl_avx512_256_add)
+                   : mzd_vl_pick(mzd_mul_vl_avx512_256);
+      case 384:
+      case 512:
+        return add ? mzd_vl_pick(mzd_addmul_vl_avx512_512_add)
+                   : mzd_vl_pick(mzd_mul_vl_avx512_512);
+      }
+    }
+#endif
 #ifdef WITH_AVX2
     if (CPU_SUPPORTS_AVX2) {
-      if (A->ncols == 256) {
-        return mzd_addmul_vl_avx_256(c, v, A);
+      if (n == 256) {
+        return add ? mzd_vl_pick(mzd_addmul_vl_avx_256) : mzd_vl_pick(mzd_mul_vl_avx_256);
       }
-      if ((A->ncols & 0xff) == 0) {
-        return mzd_addmul_vl_avx(c, v, A);
+      if ((n & 0xff) == 0) {
+        return add ? mzd_vl_pick(mzd_addmul_vl_avx) : mzd_vl_pick(mzd_mul_vl_avx);
       }
     }
 #endif
 #ifdef WITH_SSE2
     if (CPU_SUPPORTS_SSE2) {
-      if (A->ncols == 128) {
-        return mzd_addmul_vl_sse_128(c, v, A);
+      if (n == 128) {
+        return add ? mzd_vl_pick(mzd_addmul_vl_sse_128) : mzd_vl_pick(mzd_mul_vl_sse_128);
       }
-      if ((A->ncols & 0x7f) == 0) {
-        return mzd_addmul_vl_sse(c, v, A);
+      if ((n & 0x7f) == 0) {
+        return add ? mzd_vl_pick(mzd_addmul_vl_sse) : mzd_vl_pick(mzd_mul_vl_sse);
       }
     }
 #endif
   }
+#else
+  (void)vcols;
 #endif
 
-  const unsigned int len   = A->width;
-  const word mask          = A->high_bitmask;
-  word* cptr               = FIRST_ROW(c);
-  word const* vptr         = CONST_FIRST_ROW(v);
-  const unsigned int width = v->width;
+  if (n == sizeof(word) * 8) {
+    return add ? mzd_vl_pick(mzd_addmul_vl_uint64_64_add) : mzd_vl_pick(mzd_mul_vl_uint64_64);
+  }
+  return add ? mzd_vl_pick(mzd_addmul_vl_uint64) : mzd_vl_pick(mzd_mul_vl_uint64);
+}
 
-  for (unsigned int w = 0; w < width; ++w, ++vptr) {
-    word idx         = *vptr;
-    unsigned int add = 0;
+#undef mzd_vl_pick
 
-    while (idx) {
-      const word comb = idx & 0xff;
+mzd_mul_vl_fn mzd_mul_vl_select(rci_t n, rci_t vcols, unsigned int bits) {
+  return mzd_mul_vl_select_impl(n, vcols, bits, false);
+}
 
-      word const* Aptr = A->rows[w * sizeof(word) * 8 * 32 + add + comb];
-      for (unsigned int i = 0; i < len - 1; ++i) {
-        cptr[i] ^= Aptr[i];
-      }
-      cptr[len - 1] = (cptr[len - 1] ^ Aptr[len - 1]) & mask;
+mzd_mul_vl_fn mzd_addmul_vl_select(rci_t n, rci_t vcols, unsigned int bits) {
+  return mzd_mul_vl_select_impl(n, vcols, bits, true);
+}
 
-      idx >>= 8;
-      add += 256;
-    }
+mzd_t* mzd_mul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
+  const unsigned int bits = mzd_lookup_bits(A, v->ncols);
+  if (!bits) {
+    // number of columns does not match
+    return NULL;
   }
 
-  return c;
+  return mzd_mul_vl_select(A->ncols, v->ncols, bits)(c, v, A);
+}
+
+mzd_t* mzd_addmul_vl(mzd_t* c, mzd_t const* v, mzd_t const* A) {
+  const unsigned int bits = mzd_lookup_bits(A, v->ncols);
+  if (A->ncols != c->ncols || !bits) {
+    // number of columns does not match
+    return NULL;
+  }
+
+  return mzd_addmul_vl_select(A->ncols, v->ncols, bits)(c, v, A);
 }
@@ -21,8 +21,10 @@ mzd_t* mzd_local_init_ex(rci_t r, rci_t c, bool clear) __attribute__((assume_ali
 void mzd_local_free(mzd_t* v);
 /**
  * Initialize multiple mzd_t instances using one large enough memory block.
+ *
+ * \return false if the memory could not be allocated, dst then holds NULL pointers
  */
-void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear)
+bool mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool clear)
     __attribute__((nonnull(1)));
 
 #define mzd_local_init_multiple(dst, n, r, c) mzd_local_init_multiple_ex(dst, n, r, c, true)
@@ -31,6 +33,59 @@ void mzd_local_init_multiple_ex(mzd_t** dst, size_t n, rci_t r, rci_t c, bool cl
  * mzd_free for mzd_local_init_multiple.
  */
 void mzd_local_free_multiple(mzd_t** vs);
+/**
+ * Number of words per row used by mzd_local_init for c columns.
+ */
+rci_t mzd_local_rowstride(rci_t c);
+/**
+ * Size of the memory block used by mzd_local_init for an r x c matrix.
+ */
+size_t mzd_local_size(rci_t r, rci_t c);
+/**
+ * Sets up an mzd_t instance for an r x c matrix in existing memory, e.g. a mapped file. buffer
+ * holds the 64 byte mzd_t followed by the r rows of mzd_local_rowstride(c) words each and needs to
+ * be 32 byte aligned. The rows are left untouched and the row pointers are stored in rows, which
+ * needs to hold r elements. Such instances must not be passed to mzd_local_free.
+ */
+mzd_t* mzd_local_setup_in_place(void* buffer, rci_t r, rci_t c, word** rows)
+    __attribute__((nonnull));
+
+typedef struct mzd_arena_block_s mzd_arena_block_t;
+
+/**
+ * Bump allocator for mzd_t instances sharing the same lifetime. All allocations are 32 byte
+ * aligned and are released at once by mzd_arena_clear. Instances allocated from an arena must not
+ * be passed to mzd_local_free.
+ */
+typedef struct {
+  mzd_arena_block_t* head;
+  size_t block_size;
+} mzd_arena_t;
+
+/**
+ * Initializes an empty arena. Memory is requested in blocks of at least block_size bytes.
+ */
+void mzd_arena_init(mzd_arena_t* arena, size_t block_size);
+/**
+ * Releases all memory of the arena. The arena can be used again afterwards.
+ */
+void mzd_arena_clear(mzd_arena_t* arena);
+/**
+ * Releases all instances allocated from the arena, but keeps the most recent block for further
+ * allocations.
+ */
+void mzd_arena_reset(mzd_arena_t* arena);
+void* mzd_arena_alloc(mzd_arena_t* arena, size_t size) __attribute__((assume_aligned(32)));
+/**
+ * mzd_local_init_ex using memory from the arena.
+ */
+mzd_t* mzd_arena_init_mzd(mzd_arena_t* arena, rci_t r, rci_t c, bool clear);
+
+/**
+ * Returns the number of memory blocks allocated by mzd_local_init_ex,
+ * mzd_local_init_multiple_ex and arenas so far by the calling thread.
+ */
+uint64_t mzd_local_allocation_count(void);
 /**
  * Improved mzd_copy for specific memory layouts.
  */
@@ -48,14 +103,57 @@ mzd_t* mzd_init_random_vector(rci_t n);
 mzd_t* mzd_init_random_vector_prng(rci_t n, aes_prng_t* aes_prng);
 
 void mzd_randomize_ssl(mzd_t* val) __attribute__((nonnull(1)));
+/**
+ * Fills the rows of A with randomness from the PRNG. The padding of the rows is left untouched.
+ */
+void mzd_randomize_prng(mzd_t* A, aes_prng_t* aes_prng) __attribute__((nonnull));
 
 void mzd_randomize_from_seed(mzd_t* vector, const unsigned char key[16]) __attribute__((nonnull));
 
+/**
+ * Like mzd_randomize_from_seed for the words of a vector with c columns.
+ */
+void mzd_row_randomize_from_seed(word* row, rci_t c, const unsigned char key[16])
+    __attribute__((nonnull));
+/**
+ * Like mzd_row_randomize_from_seed, but re-keys the given PRNG instead of creating a new one.
+ */
+void mzd_row_randomize_from_seed_prng(word* row, rci_t c, const unsigned char key[16],
+                                      aes_prng_t* aes_prng) __attribute__((nonnull));
+
 mzd_t* mzd_init_random_vector_from_seed(const unsigned char key[16], rci_t n);
 
 void mzd_randomize_multiple_from_seed(mzd_t** vectors, unsigned int count,
                                       const unsigned char key[PRNG_KEYSIZE]);
 
+/**
+ * Like mzd_randomize_multiple_from_seed, but re-keys the given PRNG instead of creating a new one.
+ */
+void mzd_randomize_multiple_from_seed_prng(mzd_t** vectors, unsigned int count,
+                                           const unsigned char key[PRNG_KEYSIZE],
+                                           aes_prng_t* aes_prng);
+
+// maximal number of seeds expanded together
+#define MZD_RANDOMIZE_MAX_SEEDS 8
+
+/**
+ * Same as calling mzd_randomize_multiple_from_seed_prng(vectors[s], count, key_s, &aes_prngs[s])
+ * for all s < seeds, where key_s are the PRNG_KEYSIZE bytes at keys + s * PRNG_KEYSIZE. The
+ * randomness of all seeds is generated together, so that the AES rounds of the streams are
+ * interleaved.
+ *
+ * \param seeds the number of seeds, at most MZD_RANDOMIZE_MAX_SEEDS
+ */
+void mzd_randomize_multiple_from_seeds_prng(mzd_t** const* vectors, unsigned int count,
+                                            const unsigned char* keys, unsigned int seeds,
+                                            aes_prng_t* aes_prngs) __attribute__((nonnull));
+/**
+ * Like mzd_randomize_multiple_from_seeds_prng with new PRNGs.
+ */
+void mzd_randomize_multiple_from_seeds(mzd_t** const* vectors, unsigned int count,
+                                       const unsigned char* keys, unsigned int seeds)
+    __attribute__((nonnull));
+
 mzd_t** mzd_init_random_vectors_from_seed(const unsigned char key[PRNG_KEYSIZE], rci_t n,
                                           unsigned count);
 
@@ -99,6 +197,20 @@ mzd_t* mzd_mul_vl(mzd_t* c, mzd_t const* v, mzd_t const* At) __attribute__((nonn
  */
 mzd_t* mzd_addmul_vl(mzd_t* c, mzd_t const* v, mzd_t const* At) __attribute__((nonnull));
 
+typedef mzd_t* (*mzd_mul_vl_fn)(mzd_t* c, mzd_t const* v, mzd_t const* At);
+
+/**
+ * Selects the fastest implementation of mzd_mul_vl supported by the CPU for products of a vector
+ * with vcols columns and a lookup table with n columns and chunks of bits bits. The returned
+ * function performs no checks on the dimensions.
+ */
+mzd_mul_vl_fn mzd_mul_vl_select(rci_t n, rci_t vcols, unsigned int bits);
+
+/**
+ * Like mzd_mul_vl_select for mzd_addmul_vl.
+ */
+mzd_mul_vl_fn mzd_addmul_vl_select(rci_t n, rci_t vcols, unsigned int bits);
+
 /**
  * Compute v * A optimized for v being a vector.
  */
@@ -114,8 +226,16 @@ void mzd_addmul_vlm(mzd_t** c, mzd_t const* const* v, mzd_t const* At, unsigned
 /**
  * Pre-compute matrices for faster mzd_addmul_v computions.
  *
+ * \param bits the number of bits combined in one row of the table, either 4 or 8. The table holds
+ *             (1 << bits) / bits rows for every row of A.
+ */
+mzd_t* mzd_precompute_matrix_lookup(mzd_t const* A, unsigned int bits) __attribute__((nonnull));
+
+/**
+ * Number of bits per chunk of a lookup table A for vectors with vcols columns or 0 if the
+ * dimensions do not match.
  */
-mzd_t* mzd_precompute_matrix_lookup(mzd_t const* A) __attribute__((nonnull));
+unsigned int mzd_lookup_bits(mzd_t const* A, rci_t vcols) __attribute__((nonnull));
 
 #define FIRST_ROW(v) ((word*)(((void*)(v)) + 64))
 #define CONST_FIRST_ROW(v) ((word const*)(((void const*)(v)) + 64))
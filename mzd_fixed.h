@@ -0,0 +1,66 @@
+#ifndef MZD_FIXED_H
+#define MZD_FIXED_H
+
+#include <m4ri/m4ri.h>
+
+/**
+ * Operations on the words of vectors with a fixed number of words. They are inlined into kernels
+ * instantiated for one block size, where width and the shift counts are compile-time constants.
+ * The loops are then fully unrolled and the shifts use immediate counts.
+ */
+#define FN_ATTRIBUTES_FIXED static inline __attribute__((__always_inline__))
+
+// number of words of the largest block size with fixed-width kernels
+#define MZD_FIXED_MAX_WIDTH 8
+
+FN_ATTRIBUTES_FIXED void mzd_fixed_and(word* res, word const* first, word const* second,
+                                       const unsigned int width) {
+  for (unsigned int i = 0; i < width; ++i) {
+    res[i] = first[i] & second[i];
+  }
+}
+
+FN_ATTRIBUTES_FIXED void mzd_fixed_xor(word* res, word const* first, word const* second,
+                                       const unsigned int width) {
+  for (unsigned int i = 0; i < width; ++i) {
+    res[i] = first[i] ^ second[i];
+  }
+}
+
+/**
+ * Shifts towards the higher bits like mzd_shift_left. res may be equal to val.
+ */
+FN_ATTRIBUTES_FIXED void mzd_fixed_shift_left(word* res, word const* val, const unsigned int count,
+                                              const unsigned int width) {
+  if (!count) {
+    for (unsigned int i = 0; i < width; ++i) {
+      res[i] = val[i];
+    }
+    return;
+  }
+
+  for (unsigned int i = width - 1; i; --i) {
+    res[i] = (val[i] << count) | (val[i - 1] >> (sizeof(word) * 8 - count));
+  }
+  res[0] = val[0] << count;
+}
+
+/**
+ * Shifts towards the lower bits like mzd_shift_right. res may be equal to val.
+ */
+FN_ATTRIBUTES_FIXED void mzd_fixed_shift_right(word* res, word const* val, const unsigned int count,
+                                               const unsigned int width) {
+  if (!count) {
+    for (unsigned int i = 0; i < width; ++i) {
+      res[i] = val[i];
+    }
+    return;
+  }
+
+  for (unsigned int i = 0; i < width - 1; ++i) {
+    res[i] = (val[i] >> count) | (val[i + 1] << (sizeof(word) * 8 - count));
+  }
+  res[width - 1] = val[width - 1] >> count;
+}
+
+#endif
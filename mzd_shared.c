@@ -34,6 +34,17 @@ void mzd_shared_share_from_keys(mzd_shared_t* shared_value, const unsigned char
   mzd_xor(shared_value->shared[2], shared_value->shared[1], shared_value->shared[2]);
 }
 
+void mzd_shared_share_from_keys_prng(mzd_shared_t* shared_value, const unsigned char keys[2][16],
+                                     aes_prng_t* aes_prng) {
+  shared_value->share_count = 3;
+
+  mzd_randomize_multiple_from_seed_prng(&shared_value->shared[0], 1, keys[0], aes_prng);
+  mzd_randomize_multiple_from_seed_prng(&shared_value->shared[1], 1, keys[1], aes_prng);
+
+  mzd_xor(shared_value->shared[2], shared_value->shared[0], shared_value->shared[2]);
+  mzd_xor(shared_value->shared[2], shared_value->shared[1], shared_value->shared[2]);
+}
+
 #if 0
 void mzd_shared_share(mzd_shared_t* shared_value) {
   shared_value->share_count = 3;
@@ -18,6 +18,9 @@
 #define FIS_NUM_ROUNDS NUM_ROUNDS
 #define BG_NUM_ROUNDS NUM_ROUNDS
 
+// Repetitions per chunk distributed over the thread pool; even, as repetitions are proven in pairs
+#define FIS_CHUNK_ROUNDS 16
+
 // Share count for proofs
 #define SC_PROOF 3
 // Share count for verification
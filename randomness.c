@@ -1,7 +1,16 @@
 #include "randomness.h"
 #include "parameters.h"
 
+#include <openssl/crypto.h>
 #include <openssl/rand.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(WITH_OPT) && defined(WITH_AESNI)
+#include "simd.h"
+#endif
 
 void init_EVP() {
 #if OPENSSL_VERSION_NUMBER >= 0x10100000
@@ -24,21 +33,242 @@ void cleanup_EVP() {
 #endif
 }
 
-void aes_prng_init(aes_prng_t* aes_prng, const unsigned char* key) {
+#if defined(WITH_OPT) && defined(WITH_AESNI)
+#define AES_PRNG_ROUNDS 10
+// number of counter blocks encrypted in parallel
+#define AES_PRNG_BLOCKS 8
+
+#define aes_prng_expand_step(rk, i, rcon)                                                          \
+  do {                                                                                             \
+    __m128i t = _mm_aeskeygenassist_si128(rk[i - 1], rcon);                                        \
+    __m128i k = rk[i - 1];                                                                         \
+    k         = _mm_xor_si128(k, _mm_slli_si128(k, 4));                                            \
+    k         = _mm_xor_si128(k, _mm_slli_si128(k, 4));                                            \
+    k         = _mm_xor_si128(k, _mm_slli_si128(k, 4));                                            \
+    rk[i]     = _mm_xor_si128(k, _mm_shuffle_epi32(t, _MM_SHUFFLE(3, 3, 3, 3)));                   \
+  } while (0)
+
+__attribute__((target("aes,sse2"))) static void
+aes_prng_expand_key(aes_prng_t* aes_prng, const unsigned char* key) {
+  __m128i* rk = (__m128i*)aes_prng->round_keys;
+
+  rk[0] = _mm_loadu_si128((__m128i const*)key);
+  aes_prng_expand_step(rk, 1, 0x01);
+  aes_prng_expand_step(rk, 2, 0x02);
+  aes_prng_expand_step(rk, 3, 0x04);
+  aes_prng_expand_step(rk, 4, 0x08);
+  aes_prng_expand_step(rk, 5, 0x10);
+  aes_prng_expand_step(rk, 6, 0x20);
+  aes_prng_expand_step(rk, 7, 0x40);
+  aes_prng_expand_step(rk, 8, 0x80);
+  aes_prng_expand_step(rk, 9, 0x1b);
+  aes_prng_expand_step(rk, 10, 0x36);
+}
+
+#undef aes_prng_expand_step
+
+/**
+ * Encrypts the next count <= AES_PRNG_BLOCKS counter blocks into dst. The blocks are independent,
+ * so the rounds of all of them are interleaved.
+ */
+__attribute__((target("aes,sse2"))) static inline void
+aes_prng_encrypt_blocks(aes_prng_t* aes_prng, unsigned char* dst, const unsigned int count) {
+  __m128i const* rk = (__m128i const*)aes_prng->round_keys;
+  uint64_t hi       = aes_prng->counter[0];
+  uint64_t lo       = aes_prng->counter[1];
+
+  __m128i blocks[AES_PRNG_BLOCKS];
+  for (unsigned int b = 0; b < count; ++b) {
+    blocks[b] = _mm_xor_si128(_mm_set_epi64x(__builtin_bswap64(lo), __builtin_bswap64(hi)), rk[0]);
+    if (!++lo) {
+      ++hi;
+    }
+  }
+  for (unsigned int i = 1; i < AES_PRNG_ROUNDS; ++i) {
+    for (unsigned int b = 0; b < count; ++b) {
+      blocks[b] = _mm_aesenc_si128(blocks[b], rk[i]);
+    }
+  }
+  for (unsigned int b = 0; b < count; ++b) {
+    _mm_storeu_si128((__m128i*)dst + b, _mm_aesenclast_si128(blocks[b], rk[AES_PRNG_ROUNDS]));
+  }
+
+  aes_prng->counter[0] = hi;
+  aes_prng->counter[1] = lo;
+}
+
+/**
+ * Encrypts the next blocks counter blocks of each of the prngs PRNGs to dst[i] + offset. The
+ * blocks of all streams are encrypted in batches of AES_PRNG_BLOCKS blocks, taking the blocks of
+ * the streams in turns.
+ */
+__attribute__((target("aes,sse2"))) static inline void
+aes_prng_encrypt_blocks_multiple(aes_prng_t* aes_prngs, const unsigned int prngs,
+                                 unsigned char* const* dst, size_t offset, size_t blocks) {
+  unsigned int i = 0;
+  for (size_t jobs = blocks * prngs; jobs;) {
+    const unsigned int batch = MIN(jobs, AES_PRNG_BLOCKS);
+
+    __m128i states[AES_PRNG_BLOCKS];
+    __m128i const* rks[AES_PRNG_BLOCKS];
+    unsigned char* outs[AES_PRNG_BLOCKS];
+    for (unsigned int b = 0; b < batch; ++b) {
+      aes_prng_t* aes_prng = &aes_prngs[i];
+      uint64_t* counter    = aes_prng->counter;
+
+      rks[b]    = (__m128i const*)aes_prng->round_keys;
+      outs[b]   = dst[i] + offset;
+      states[b] = _mm_xor_si128(
+          _mm_set_epi64x(__builtin_bswap64(counter[1]), __builtin_bswap64(counter[0])), rks[b][0]);
+      if (!++counter[1]) {
+        ++counter[0];
+      }
+
+      if (++i == prngs) {
+        i = 0;
+        offset += 16;
+      }
+    }
+    // a partial batch is padded, so that the rounds of all lanes are unrolled and kept in registers
+    for (unsigned int b = batch; b < AES_PRNG_BLOCKS; ++b) {
+      rks[b]    = rks[0];
+      states[b] = states[0];
+    }
+    for (unsigned int r = 1; r < AES_PRNG_ROUNDS; ++r) {
+      for (unsigned int b = 0; b < AES_PRNG_BLOCKS; ++b) {
+        states[b] = _mm_aesenc_si128(states[b], rks[b][r]);
+      }
+    }
+    for (unsigned int b = 0; b < batch; ++b) {
+      _mm_storeu_si128((__m128i*)outs[b], _mm_aesenclast_si128(states[b], rks[b][AES_PRNG_ROUNDS]));
+    }
+
+    jobs -= batch;
+  }
+}
+
+/**
+ * aes_prng_get_randomness_multiple for at most AES_PRNG_BLOCKS PRNGs with the same amount of left
+ * over key stream.
+ */
+__attribute__((target("aes,sse2"))) static void
+aes_prng_get_randomness_multiple_aesni(aes_prng_t* aes_prngs, unsigned int prngs,
+                                       unsigned char* const* dst, size_t count) {
+  const unsigned int used = aes_prngs[0].used;
+  const size_t avail      = MIN(count, sizeof(aes_prngs[0].block) - used);
+  for (unsigned int i = 0; i < prngs; ++i) {
+    memcpy(dst[i], aes_prngs[i].block + used, avail);
+    aes_prngs[i].used += avail;
+  }
+
+  size_t offset = avail;
+  size_t left   = count - avail;
+  aes_prng_encrypt_blocks_multiple(aes_prngs, prngs, dst, offset, left / 16);
+  offset += left & ~(size_t)15;
+  left &= 15;
+
+  if (left) {
+    unsigned char* blocks[AES_PRNG_BLOCKS];
+    for (unsigned int i = 0; i < prngs; ++i) {
+      blocks[i] = aes_prngs[i].block;
+    }
+    aes_prng_encrypt_blocks_multiple(aes_prngs, prngs, blocks, 0, 1);
+    for (unsigned int i = 0; i < prngs; ++i) {
+      memcpy(dst[i] + offset, aes_prngs[i].block, left);
+      aes_prngs[i].used = left;
+    }
+  }
+}
+
+__attribute__((target("aes,sse2"))) static void
+aes_prng_get_randomness_aesni(aes_prng_t* aes_prng, unsigned char* dst, size_t count) {
+  unsigned char* ptr = dst;
+  size_t left        = count;
+
+  // left over key stream of the last call
+  const size_t avail = MIN(left, sizeof(aes_prng->block) - aes_prng->used);
+  memcpy(ptr, aes_prng->block + aes_prng->used, avail);
+  aes_prng->used += avail;
+  ptr += avail;
+  left -= avail;
+
+  for (; left >= AES_PRNG_BLOCKS * 16; left -= AES_PRNG_BLOCKS * 16, ptr += AES_PRNG_BLOCKS * 16) {
+    aes_prng_encrypt_blocks(aes_prng, ptr, AES_PRNG_BLOCKS);
+  }
+  if (left >= 16) {
+    aes_prng_encrypt_blocks(aes_prng, ptr, left / 16);
+    ptr += left & ~(size_t)15;
+    left &= 15;
+  }
+  if (left) {
+    aes_prng_encrypt_blocks(aes_prng, aes_prng->block, 1);
+    memcpy(ptr, aes_prng->block, left);
+    aes_prng->used = left;
+  }
+}
+#endif
+
+/* A 128 bit IV */
+static const unsigned char aes_prng_iv[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                              '8', '9', '0', '1', '2', '3', '4', '5'};
+
+/**
+ * The stream is the encryption of a plaintext whose first byte is '0' and all others are zero.
+ * The plaintext starts anew with every call of aes_prng_get_randomness and every 16 bytes.
+ */
+static const unsigned char aes_prng_plaintext = '0';
+
+bool aes_prng_init(aes_prng_t* aes_prng, const unsigned char* key) {
+#if defined(WITH_OPT) && defined(WITH_AESNI)
+  if (CPU_SUPPORTS_AESNI) {
+    aes_prng->ctx = NULL;
+    aes_prng_reseed(aes_prng, key);
+    return true;
+  }
+#endif
+
   aes_prng->ctx = EVP_CIPHER_CTX_new();
+  return aes_prng->ctx &&
+         EVP_EncryptInit_ex(aes_prng->ctx, EVP_aes_128_ctr(), NULL, key, aes_prng_iv) == 1;
+}
+
+void aes_prng_reseed(aes_prng_t* aes_prng, const unsigned char* key) {
+#if defined(WITH_OPT) && defined(WITH_AESNI)
+  if (!aes_prng->ctx) {
+    aes_prng_expand_key(aes_prng, key);
+    uint64_t counter[2];
+    memcpy(counter, aes_prng_iv, sizeof(counter));
+    aes_prng->counter[0] = __builtin_bswap64(counter[0]);
+    aes_prng->counter[1] = __builtin_bswap64(counter[1]);
+    aes_prng->used       = sizeof(aes_prng->block);
+    return;
+  }
+#endif
 
-  /* A 128 bit IV */
-  static const unsigned char iv[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
-                                       '8', '9', '0', '1', '2', '3', '4', '5'};
-  EVP_EncryptInit_ex(aes_prng->ctx, EVP_aes_128_ctr(), NULL, key, iv);
+  EVP_EncryptInit_ex(aes_prng->ctx, NULL, NULL, key, aes_prng_iv);
 }
 
 void aes_prng_clear(aes_prng_t* aes_prng) {
-  EVP_CIPHER_CTX_free(aes_prng->ctx);
+  if (aes_prng->ctx) {
+    EVP_CIPHER_CTX_free(aes_prng->ctx);
+  } else {
+    OPENSSL_cleanse(aes_prng->round_keys, sizeof(aes_prng->round_keys));
+    OPENSSL_cleanse(aes_prng->block, sizeof(aes_prng->block));
+  }
 }
 
 void aes_prng_get_randomness(aes_prng_t* aes_prng, unsigned char* dst, size_t count) {
-  static const unsigned char plaintext[16] = {'0'};
+#if defined(WITH_OPT) && defined(WITH_AESNI)
+  if (!aes_prng->ctx) {
+    aes_prng_get_randomness_aesni(aes_prng, dst, count);
+    for (size_t i = 0; i < count; i += 16) {
+      dst[i] ^= aes_prng_plaintext;
+    }
+    return;
+  }
+#endif
+
+  static const unsigned char plaintext[16] = {aes_prng_plaintext};
 
   EVP_CIPHER_CTX* ctx = aes_prng->ctx;
 
@@ -52,22 +282,120 @@ void aes_prng_get_randomness(aes_prng_t* aes_prng, unsigned char* dst, size_t co
   }
 }
 
-// maybe seed with data from /dev/urandom
+void aes_prng_get_randomness_multiple(aes_prng_t* aes_prngs, unsigned int prngs,
+                                      unsigned char* const* dst, size_t count) {
+#if defined(WITH_OPT) && defined(WITH_AESNI)
+  bool lockstep = true;
+  for (unsigned int i = 0; i < prngs && lockstep; ++i) {
+    lockstep = !aes_prngs[i].ctx && aes_prngs[i].used == aes_prngs[0].used;
+  }
 
-static aes_prng_t aes_prng;
+  if (lockstep) {
+    for (unsigned int i = 0; i < prngs; i += AES_PRNG_BLOCKS) {
+      aes_prng_get_randomness_multiple_aesni(&aes_prngs[i], MIN(prngs - i, AES_PRNG_BLOCKS),
+                                             &dst[i], count);
+    }
+    for (unsigned int i = 0; i < prngs; ++i) {
+      for (size_t j = 0; j < count; j += 16) {
+        dst[i][j] ^= aes_prng_plaintext;
+      }
+    }
+    return;
+  }
+#endif
 
-void init_rand_bytes(void) {
+  for (unsigned int i = 0; i < prngs; ++i) {
+    aes_prng_get_randomness(&aes_prngs[i], dst[i], count);
+  }
+}
+
+// number of bytes drawn from a DRBG before it is reseeded
+#define RAND_BYTES_RESEED_INTERVAL (1 << 20)
+
+typedef struct {
+  aes_prng_t aes_prng;
+  // bytes drawn since the last reseed
+  size_t drawn;
+  // value of fork_generation when the DRBG was seeded
+  unsigned int generation;
+  bool initialized;
+} rand_bytes_drbg_t;
+
+/**
+ * Every thread draws from its own DRBG, so rand_bytes needs no locking.
+ */
+static _Thread_local rand_bytes_drbg_t drbg;
+// incremented in the child after every fork(), so that the child does not repeat the stream of the
+// parent
+static atomic_uint fork_generation;
+static pthread_once_t rand_bytes_once = PTHREAD_ONCE_INIT;
+// releases the DRBG of a thread when it exits
+static pthread_key_t rand_bytes_key;
+
+static void rand_bytes_atfork_child(void) {
+  atomic_fetch_add(&fork_generation, 1);
+}
+
+static void rand_bytes_thread_exit(void* arg) {
+  rand_bytes_drbg_t* state = arg;
+  aes_prng_clear(&state->aes_prng);
+  state->initialized = false;
+}
+
+static void rand_bytes_setup(void) {
+  pthread_key_create(&rand_bytes_key, rand_bytes_thread_exit);
+  pthread_atfork(NULL, NULL, rand_bytes_atfork_child);
+}
+
+static bool rand_bytes_reseed(rand_bytes_drbg_t* state) {
   unsigned char key[PRNG_KEYSIZE];
-  RAND_bytes(key, sizeof(key));
+  if (RAND_bytes(key, sizeof(key)) != 1) {
+    return false;
+  }
 
-  aes_prng_init(&aes_prng, key);
+  if (state->initialized) {
+    aes_prng_reseed(&state->aes_prng, key);
+  } else {
+    pthread_once(&rand_bytes_once, rand_bytes_setup);
+    aes_prng_init(&state->aes_prng, key);
+    pthread_setspecific(rand_bytes_key, state);
+    state->initialized = true;
+  }
+  OPENSSL_cleanse(key, sizeof(key));
+
+  state->drawn      = 0;
+  state->generation = atomic_load(&fork_generation);
+  return true;
+}
+
+void init_rand_bytes(void) {
+  rand_bytes_reseed(&drbg);
 }
 
 int rand_bytes(unsigned char* dst, size_t len) {
-  aes_prng_get_randomness(&aes_prng, dst, len);
+  rand_bytes_drbg_t* state = &drbg;
+
+  while (len) {
+    if (!state->initialized || state->drawn >= RAND_BYTES_RESEED_INTERVAL ||
+        state->generation != atomic_load(&fork_generation)) {
+      if (!rand_bytes_reseed(state)) {
+        return 0;
+      }
+    }
+
+    const size_t count = MIN(len, RAND_BYTES_RESEED_INTERVAL - state->drawn);
+    aes_prng_get_randomness(&state->aes_prng, dst, count);
+    state->drawn += count;
+    dst += count;
+    len -= count;
+  }
+
   return 1;
 }
 
 void deinit_rand_bytes(void) {
-  aes_prng_clear(&aes_prng);
+  if (drbg.initialized) {
+    pthread_setspecific(rand_bytes_key, NULL);
+    rand_bytes_thread_exit(&drbg);
+  }
 }
@@ -5,19 +5,63 @@
 #include <openssl/conf.h>
 #include <openssl/err.h>
 #include <openssl/evp.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 void init_EVP();
 void cleanup_EVP();
 
-typedef struct { EVP_CIPHER_CTX* ctx; } aes_prng_t;
+/**
+ * AES-128 in counter mode. If the CPU supports AES-NI, the stream is generated natively and ctx is
+ * NULL, otherwise it is generated with the EVP context. Both produce the same stream.
+ */
+typedef struct {
+  EVP_CIPHER_CTX* ctx;
 
-void aes_prng_init(aes_prng_t* aes_prng, const unsigned char* key);
+  // state of the native implementation
+  unsigned char round_keys[11 * 16] __attribute__((aligned(16)));
+  // big endian counter block split into the upper and the lower 64 bits
+  uint64_t counter[2];
+  // key stream of the last block, of which only the bytes starting at used are left
+  unsigned char block[16] __attribute__((aligned(16)));
+  unsigned int used;
+} aes_prng_t;
+
+/**
+ * \return false if the cipher context could not be allocated. The PRNG has to be released with
+ *         aes_prng_clear in any case.
+ */
+bool aes_prng_init(aes_prng_t* aes_prng, const unsigned char* key);
 void aes_prng_clear(aes_prng_t* aes_prng);
+/**
+ * Re-keys an initialized PRNG without allocating a new cipher context. Afterwards it produces the
+ * same stream as a PRNG initialized with aes_prng_init using the same key.
+ */
+void aes_prng_reseed(aes_prng_t* aes_prng, const unsigned char* key);
 void aes_prng_get_randomness(aes_prng_t* aes_prng, unsigned char* dst, size_t count);
+/**
+ * Same as calling aes_prng_get_randomness(&aes_prngs[i], dst[i], count) for all i < prngs. If the
+ * PRNGs are generated natively and have been used in lockstep, the AES rounds of all streams are
+ * interleaved.
+ */
+void aes_prng_get_randomness_multiple(aes_prng_t* aes_prngs, unsigned int prngs,
+                                      unsigned char* const* dst, size_t count);
 
+/**
+ * Seeds the DRBG of the calling thread. Calling it is optional, as every thread's DRBG is seeded
+ * from RAND_bytes on first use.
+ */
 void init_rand_bytes(void);
+/**
+ * Releases the DRBG of the calling thread. The DRBGs of other threads are released when they exit.
+ */
 void deinit_rand_bytes(void);
+/**
+ * Fills dst with len random bytes from the AES-CTR DRBG of the calling thread. The DRBG is reseeded
+ * from RAND_bytes after every 2^20 bytes and in the child process after fork().
+ *
+ * \return 1 on success, 0 if reseeding failed
+ */
 int rand_bytes(unsigned char* dst, size_t len);
 
 #endif
@@ -0,0 +1,374 @@
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "sha256_multi.h"
+
+#include <openssl/sha.h>
+#include <stdbool.h>
+#include <string.h>
+
+#ifdef WITH_OPT
+#include "simd.h"
+#endif
+
+static void sha256_compress_openssl(uint32_t (*state)[8], unsigned char const* const* blocks,
+                                    size_t count, unsigned int lanes) {
+  for (unsigned int l = 0; l < lanes; ++l) {
+    SHA256_CTX ctx;
+    memcpy(ctx.h, state[l], sizeof(ctx.h));
+    for (size_t b = 0; b < count; ++b) {
+      SHA256_Transform(&ctx, blocks[l] + b * 64);
+    }
+    memcpy(state[l], ctx.h, sizeof(ctx.h));
+  }
+}
+
+#if defined(WITH_OPT) && (defined(WITH_SHANI) || defined(WITH_AVX2))
+static const uint32_t sha256_k[64] __attribute__((aligned(32))) = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+#endif
+
+#if defined(WITH_OPT) && defined(WITH_SHANI)
+#define FN_ATTRIBUTES_SHANI __attribute__((__always_inline__, target("sha,sse4.1")))
+
+/**
+ * Four rounds starting at round 4 * g for each of the lanes. m holds the four message words of
+ * each lane, of which the ones needed by the following groups are updated.
+ */
+static inline FN_ATTRIBUTES_SHANI void sha256_ni_quad(__m128i* s0, __m128i* s1, __m128i* m,
+                                                      const unsigned int g,
+                                                      const unsigned int lanes) {
+  const __m128i k = _mm_load_si128((__m128i const*)&sha256_k[4 * g]);
+  for (unsigned int l = 0; l < lanes; ++l) {
+    __m128i* w        = m + 4 * l;
+    const __m128i cur = w[g % 4];
+
+    __m128i msg = _mm_add_epi32(cur, k);
+    s1[l]       = _mm_sha256rnds2_epu32(s1[l], s0[l], msg);
+    if (g >= 3 && g <= 14) {
+      const __m128i tmp = _mm_alignr_epi8(cur, w[(g + 3) % 4], 4);
+      w[(g + 1) % 4]    = _mm_sha256msg2_epu32(_mm_add_epi32(w[(g + 1) % 4], tmp), cur);
+    }
+    msg   = _mm_shuffle_epi32(msg, 0x0e);
+    s0[l] = _mm_sha256rnds2_epu32(s0[l], s1[l], msg);
+    if (g >= 1 && g <= 12) {
+      w[(g + 3) % 4] = _mm_sha256msg1_epu32(w[(g + 3) % 4], cur);
+    }
+  }
+}
+
+/**
+ * Compresses the blocks of lanes <= 2 lanes with the rounds of both lanes interleaved.
+ */
+static inline FN_ATTRIBUTES_SHANI void sha256_ni_compress_lanes(uint32_t (*state)[8],
+                                                                unsigned char const* const* blocks,
+                                                                size_t count,
+                                                                const unsigned int lanes) {
+  const __m128i shuffle = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+  // the state is kept as ABEF and CDGH as required by sha256rnds2
+  __m128i s0[2], s1[2];
+  for (unsigned int l = 0; l < lanes; ++l) {
+    const __m128i dcba = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const*)&state[l][0]), 0xb1);
+    const __m128i efgh = _mm_shuffle_epi32(_mm_loadu_si128((__m128i const*)&state[l][4]), 0x1b);
+    s0[l]              = _mm_alignr_epi8(dcba, efgh, 8);
+    s1[l]              = _mm_blend_epi16(efgh, dcba, 0xf0);
+  }
+
+  for (size_t b = 0; b < count; ++b) {
+    __m128i m[2 * 4], save0[2], save1[2];
+    for (unsigned int l = 0; l < lanes; ++l) {
+      for (unsigned int i = 0; i < 4; ++i) {
+        m[4 * l + i] = _mm_shuffle_epi8(
+            _mm_loadu_si128((__m128i const*)(blocks[l] + b * 64 + i * 16)), shuffle);
+      }
+      save0[l] = s0[l];
+      save1[l] = s1[l];
+    }
+
+    sha256_ni_quad(s0, s1, m, 0, lanes);
+    sha256_ni_quad(s0, s1, m, 1, lanes);
+    sha256_ni_quad(s0, s1, m, 2, lanes);
+    sha256_ni_quad(s0, s1, m, 3, lanes);
+    sha256_ni_quad(s0, s1, m, 4, lanes);
+    sha256_ni_quad(s0, s1, m, 5, lanes);
+    sha256_ni_quad(s0, s1, m, 6, lanes);
+    sha256_ni_quad(s0, s1, m, 7, lanes);
+    sha256_ni_quad(s0, s1, m, 8, lanes);
+    sha256_ni_quad(s0, s1, m, 9, lanes);
+    sha256_ni_quad(s0, s1, m, 10, lanes);
+    sha256_ni_quad(s0, s1, m, 11, lanes);
+    sha256_ni_quad(s0, s1, m, 12, lanes);
+    sha256_ni_quad(s0, s1, m, 13, lanes);
+    sha256_ni_quad(s0, s1, m, 14, lanes);
+    sha256_ni_quad(s0, s1, m, 15, lanes);
+
+    for (unsigned int l = 0; l < lanes; ++l) {
+      s0[l] = _mm_add_epi32(s0[l], save0[l]);
+      s1[l] = _mm_add_epi32(s1[l], save1[l]);
+    }
+  }
+
+  for (unsigned int l = 0; l < lanes; ++l) {
+    const __m128i feba = _mm_shuffle_epi32(s0[l], 0x1b);
+    const __m128i dchg = _mm_shuffle_epi32(s1[l], 0xb1);
+    _mm_storeu_si128((__m128i*)&state[l][0], _mm_blend_epi16(feba, dchg, 0xf0));
+    _mm_storeu_si128((__m128i*)&state[l][4], _mm_alignr_epi8(dchg, feba, 8));
+  }
+}
+
+__attribute__((target("sha,sse4.1"))) static void
+sha256_compress_shani(uint32_t (*state)[8], unsigned char const* const* blocks, size_t count,
+                      unsigned int lanes) {
+  unsigned int l = 0;
+  for (; l + 2 <= lanes; l += 2) {
+    sha256_ni_compress_lanes(&state[l], &blocks[l], count, 2);
+  }
+  if (l < lanes) {
+    sha256_ni_compress_lanes(&state[l], &blocks[l], count, 1);
+  }
+}
+
+#undef FN_ATTRIBUTES_SHANI
+#endif
+
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+#define mm256_rotr_epi32(x, n)                                                                     \
+  _mm256_or_si256(_mm256_srli_epi32(x, n), _mm256_slli_epi32(x, 32 - n))
+
+// one round, where the roles of the state words rotate instead of moving the words
+#define sha256_avx2_round(a, b, c, d, e, f, g, h, i)                                               \
+  do {                                                                                             \
+    if ((i) >= 16) {                                                                               \
+      const __m256i w15 = w[((i)-15) & 15];                                                        \
+      const __m256i w2  = w[((i)-2) & 15];                                                         \
+      const __m256i s0 =                                                                           \
+          _mm256_xor_si256(_mm256_xor_si256(mm256_rotr_epi32(w15, 7), mm256_rotr_epi32(w15, 18)),  \
+                           _mm256_srli_epi32(w15, 3));                                             \
+      const __m256i s1 =                                                                           \
+          _mm256_xor_si256(_mm256_xor_si256(mm256_rotr_epi32(w2, 17), mm256_rotr_epi32(w2, 19)),   \
+                           _mm256_srli_epi32(w2, 10));                                             \
+      w[(i)&15] = _mm256_add_epi32(_mm256_add_epi32(w[(i)&15], s0),                                \
+                                   _mm256_add_epi32(w[((i)-7) & 15], s1));                         \
+    }                                                                                              \
+    const __m256i sum1 =                                                                           \
+        _mm256_xor_si256(_mm256_xor_si256(mm256_rotr_epi32(e, 6), mm256_rotr_epi32(e, 11)),        \
+                         mm256_rotr_epi32(e, 25));                                                 \
+    const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, _mm256_xor_si256(f, g)), g);           \
+    const __m256i kw = _mm256_add_epi32(_mm256_set1_epi32(sha256_k[i]), w[(i)&15]);                \
+    const __m256i t1 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(h, sum1), ch), kw);      \
+    const __m256i sum0 =                                                                           \
+        _mm256_xor_si256(_mm256_xor_si256(mm256_rotr_epi32(a, 2), mm256_rotr_epi32(a, 13)),        \
+                         mm256_rotr_epi32(a, 22));                                                 \
+    const __m256i maj =                                                                            \
+        _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));       \
+    d = _mm256_add_epi32(d, t1);                                                                   \
+    h = _mm256_add_epi32(t1, _mm256_add_epi32(sum0, maj));                                         \
+  } while (0)
+
+/**
+ * Transposes the 8 words at the rows so that the i-th result holds the i-th word of all rows.
+ */
+static inline void FN_ATTRIBUTES_AVX2_NP mm256_transpose_epi32(__m256i* res, __m256i const* rows) {
+  __m256i t[8], u[8];
+  for (unsigned int i = 0; i < 8; i += 2) {
+    t[i]     = _mm256_unpacklo_epi32(rows[i], rows[i + 1]);
+    t[i + 1] = _mm256_unpackhi_epi32(rows[i], rows[i + 1]);
+  }
+  for (unsigned int i = 0; i < 8; i += 4) {
+    u[i]     = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+    u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+    u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+    u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+  }
+  for (unsigned int i = 0; i < 4; ++i) {
+    res[i]     = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+    res[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+  }
+}
+
+/**
+ * Compresses the blocks of 8 lanes, one lane in each 32 bit element. Missing lanes are filled up
+ * with copies of the first one, whose results are discarded.
+ */
+__attribute__((target("avx2"))) static void sha256_compress_avx2(uint32_t (*state)[8],
+                                                                 unsigned char const* const* blocks,
+                                                                 size_t count, unsigned int lanes) {
+  const __m256i shuffle =
+      _mm256_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL, 0x0c0d0e0f08090a0bULL,
+                        0x0405060700010203ULL);
+
+  unsigned char const* ptrs[SHA256_MULTI_LANES];
+  __m256i rows[8], s[8];
+  for (unsigned int l = 0; l < 8; ++l) {
+    const unsigned int src = l < lanes ? l : 0;
+    ptrs[l]                = blocks[src];
+    rows[l]                = _mm256_loadu_si256((__m256i const*)state[src]);
+  }
+  mm256_transpose_epi32(s, rows);
+
+  for (size_t b = 0; b < count; ++b) {
+    __m256i w[16];
+    for (unsigned int h = 0; h < 2; ++h) {
+      for (unsigned int l = 0; l < 8; ++l) {
+        rows[l] = _mm256_loadu_si256((__m256i const*)(ptrs[l] + b * 64 + h * 32));
+      }
+      mm256_transpose_epi32(&w[h * 8], rows);
+    }
+    for (unsigned int i = 0; i < 16; ++i) {
+      w[i] = _mm256_shuffle_epi8(w[i], shuffle);
+    }
+
+    __m256i a = s[0], bb = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], hh = s[7];
+    for (unsigned int i = 0; i < 64; i += 8) {
+      sha256_avx2_round(a, bb, c, d, e, f, g, hh, i);
+      sha256_avx2_round(hh, a, bb, c, d, e, f, g, i + 1);
+      sha256_avx2_round(g, hh, a, bb, c, d, e, f, i + 2);
+      sha256_avx2_round(f, g, hh, a, bb, c, d, e, i + 3);
+      sha256_avx2_round(e, f, g, hh, a, bb, c, d, i + 4);
+      sha256_avx2_round(d, e, f, g, hh, a, bb, c, i + 5);
+      sha256_avx2_round(c, d, e, f, g, hh, a, bb, i + 6);
+      sha256_avx2_round(bb, c, d, e, f, g, hh, a, i + 7);
+    }
+
+    s[0] = _mm256_add_epi32(s[0], a);
+    s[1] = _mm256_add_epi32(s[1], bb);
+    s[2] = _mm256_add_epi32(s[2], c);
+    s[3] = _mm256_add_epi32(s[3], d);
+    s[4] = _mm256_add_epi32(s[4], e);
+    s[5] = _mm256_add_epi32(s[5], f);
+    s[6] = _mm256_add_epi32(s[6], g);
+    s[7] = _mm256_add_epi32(s[7], hh);
+  }
+
+  mm256_transpose_epi32(rows, s);
+  for (unsigned int l = 0; l < lanes; ++l) {
+    _mm256_storeu_si256((__m256i*)state[l], rows[l]);
+  }
+}
+
+#undef sha256_avx2_round
+#undef mm256_rotr_epi32
+#endif
+
+static sha256_multi_compress_fn sha256_multi_select(unsigned int lanes,
+                                                    sha256_multi_backend_t backend) {
+#if defined(WITH_OPT) && defined(WITH_SHANI)
+  if ((backend == SHA256_MULTI_AUTO || backend == SHA256_MULTI_SHANI) &&
+      __builtin_cpu_supports("sha") && CPU_SUPPORTS_SSE4_1) {
+    return sha256_compress_shani;
+  }
+#endif
+#if defined(WITH_OPT) && defined(WITH_AVX2)
+  // with fewer lanes, the lanes filled up with copies are more expensive than OpenSSL
+  if (((backend == SHA256_MULTI_AUTO && lanes > SHA256_MULTI_LANES / 2) ||
+       backend == SHA256_MULTI_AVX2) &&
+      CPU_SUPPORTS_AVX2) {
+    return sha256_compress_avx2;
+  }
+#endif
+  (void)lanes;
+  return backend == SHA256_MULTI_AUTO || backend == SHA256_MULTI_OPENSSL ? sha256_compress_openssl
+                                                                          : NULL;
+}
+
+bool sha256_multi_init_backend(sha256_multi_ctx* ctx, unsigned int lanes,
+                               sha256_multi_backend_t backend) {
+  static const uint32_t iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+  for (unsigned int l = 0; l < lanes; ++l) {
+    memcpy(ctx->state[l], iv, sizeof(iv));
+  }
+  ctx->length   = 0;
+  ctx->lanes    = lanes;
+  ctx->compress = sha256_multi_select(lanes, backend);
+  return ctx->compress != NULL;
+}
+
+void sha256_multi_init(sha256_multi_ctx* ctx, unsigned int lanes) {
+  sha256_multi_init_backend(ctx, lanes, SHA256_MULTI_AUTO);
+}
+
+void sha256_multi_update(sha256_multi_ctx* ctx, unsigned char const* const* data, size_t len) {
+  const unsigned int lanes = ctx->lanes;
+  const size_t used        = ctx->length % 64;
+  ctx->length += len;
+
+  unsigned char const* ptrs[SHA256_MULTI_LANES];
+  size_t offset = 0;
+  if (used) {
+    offset = len < 64 - used ? len : 64 - used;
+    for (unsigned int l = 0; l < lanes; ++l) {
+      memcpy(ctx->buffer[l] + used, data[l], offset);
+    }
+    if (used + offset < 64) {
+      return;
+    }
+
+    for (unsigned int l = 0; l < lanes; ++l) {
+      ptrs[l] = ctx->buffer[l];
+    }
+    ctx->compress(ctx->state, ptrs, 1, lanes);
+  }
+
+  const size_t blocks = (len - offset) / 64;
+  if (blocks) {
+    for (unsigned int l = 0; l < lanes; ++l) {
+      ptrs[l] = data[l] + offset;
+    }
+    ctx->compress(ctx->state, ptrs, blocks, lanes);
+    offset += blocks * 64;
+  }
+
+  for (unsigned int l = 0; l < lanes; ++l) {
+    memcpy(ctx->buffer[l], data[l] + offset, len - offset);
+  }
+}
+
+void sha256_multi_final(sha256_multi_ctx* ctx, unsigned char* const* digests) {
+  const unsigned int lanes = ctx->lanes;
+  const size_t used        = ctx->length % 64;
+  const uint64_t bits      = ctx->length * 8;
+
+  unsigned char const* ptrs[SHA256_MULTI_LANES] = {NULL};
+  for (unsigned int l = 0; l < lanes; ++l) {
+    ptrs[l] = ctx->buffer[l];
+  }
+
+  // the length does not fit behind the padding bit in the last block
+  const bool extra_block = used >= 56;
+  for (unsigned int l = 0; l < lanes; ++l) {
+    ctx->buffer[l][used] = 0x80;
+    memset(ctx->buffer[l] + used + 1, 0, 63 - used);
+  }
+  if (extra_block) {
+    ctx->compress(ctx->state, ptrs, 1, lanes);
+    for (unsigned int l = 0; l < lanes; ++l) {
+      memset(ctx->buffer[l], 0, 56);
+    }
+  }
+  for (unsigned int l = 0; l < lanes; ++l) {
+    for (unsigned int i = 0; i < 8; ++i) {
+      ctx->buffer[l][56 + i] = bits >> (56 - 8 * i);
+    }
+  }
+  ctx->compress(ctx->state, ptrs, 1, lanes);
+
+  for (unsigned int l = 0; l < lanes; ++l) {
+    for (unsigned int i = 0; i < 8; ++i) {
+      digests[l][4 * i]     = ctx->state[l][i] >> 24;
+      digests[l][4 * i + 1] = ctx->state[l][i] >> 16;
+      digests[l][4 * i + 2] = ctx->state[l][i] >> 8;
+      digests[l][4 * i + 3] = ctx->state[l][i];
+    }
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef SHA256_MULTI_H
+#define SHA256_MULTI_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// maximal number of messages hashed together
+#define SHA256_MULTI_LANES 8
+
+typedef void (*sha256_multi_compress_fn)(uint32_t (*state)[8], unsigned char const* const* blocks,
+                                         size_t count, unsigned int lanes);
+
+/**
+ * SHA-256 of up to SHA256_MULTI_LANES messages of the same length. All messages are updated with
+ * the same number of bytes at once, so that the blocks of all lanes are compressed together: with
+ * 8 lanes in AVX2 registers or with SHA-NI processing two lanes interleaved.
+ */
+typedef struct {
+  uint32_t state[SHA256_MULTI_LANES][8];
+  unsigned char buffer[SHA256_MULTI_LANES][64];
+  // number of bytes hashed so far per lane
+  uint64_t length;
+  unsigned int lanes;
+  sha256_multi_compress_fn compress;
+} sha256_multi_ctx;
+
+typedef enum {
+  // the fastest implementation supported by the CPU for the number of lanes
+  SHA256_MULTI_AUTO,
+  SHA256_MULTI_OPENSSL,
+  SHA256_MULTI_AVX2,
+  SHA256_MULTI_SHANI,
+} sha256_multi_backend_t;
+
+void sha256_multi_init(sha256_multi_ctx* ctx, unsigned int lanes);
+/**
+ * Like sha256_multi_init, but the blocks are compressed by the given implementation.
+ *
+ * \return false if the implementation is not available in this build or on this CPU
+ */
+bool sha256_multi_init_backend(sha256_multi_ctx* ctx, unsigned int lanes,
+                               sha256_multi_backend_t backend);
+/**
+ * Appends len bytes of data[i] to the message of lane i.
+ */
+void sha256_multi_update(sha256_multi_ctx* ctx, unsigned char const* const* data, size_t len);
+void sha256_multi_final(sha256_multi_ctx* ctx, unsigned char* const* digests);
+
+#endif
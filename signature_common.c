@@ -2,6 +2,9 @@
 #include "lowmc_pars.h"
 #include "timing.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 bool create_instance(public_parameters_t* pp, int m, int n, int r, int k) {
   TIME_FUNCTION;
 
@@ -17,25 +20,28 @@ void destroy_instance(public_parameters_t* pp) {
   pp->lowmc = NULL;
 }
 
-void init_view(mpc_lowmc_t const* mpc_lowmc, view_t* views[NUM_ROUNDS]) {
+bool init_view(mpc_lowmc_t const* mpc_lowmc, view_t* views[NUM_ROUNDS], mzd_arena_t* arena) {
   const unsigned int view_count = 2 + mpc_lowmc->r;
+  const size_t array_size       = (view_count * sizeof(view_t) + 31) & ~31;
+  const size_t store_size       = (SC_PROOF * view_party_size(mpc_lowmc) * sizeof(word) + 31) & ~31;
+  const size_t size             = NUM_ROUNDS * (array_size + store_size);
+
+  // the view arrays followed by the view stores of all repetitions
+  unsigned char* buffer = arena ? mzd_arena_alloc(arena, size) : aligned_alloc(32, size);
+  if (!buffer) {
+    return false;
+  }
+  memset(buffer, 0, size);
 
-  unsigned char* buffer = malloc((view_count * NUM_ROUNDS) * (sizeof(view_t)));
-
+  unsigned char* store = buffer + NUM_ROUNDS * array_size;
   for (unsigned int i = 0; i < NUM_ROUNDS; i++) {
     views[i] = (view_t*)buffer;
-    buffer += view_count * sizeof(view_t);
-
-    for (unsigned m = 0; m < SC_PROOF; ++m) {
-      views[i][0].s[m] = mzd_local_init_ex(1, mpc_lowmc->k, false);
-    }
+    buffer += array_size;
 
-    for (unsigned n = 1; n < view_count; n++) {
-      for (unsigned m = 0; m < SC_PROOF; m++) {
-        views[i][n].s[m] = mzd_local_init(1, mpc_lowmc->n);
-      }
-    }
+    view_assign(mpc_lowmc, views[i], (word*)store, SC_PROOF);
+    store += store_size;
   }
+  return true;
 }
 
 void free_view(mpc_lowmc_t const* mpc_lowmc, view_t* views[NUM_ROUNDS]) {
@@ -16,7 +16,16 @@ bool create_instance(public_parameters_t* pp, int m, int n, int r, int k);
 
 void destroy_instance(public_parameters_t* pp);
 
-void init_view(mpc_lowmc_t const* lowmc, view_t* views[NUM_ROUNDS]);
+/**
+ * Allocates the views for NUM_ROUNDS repetitions.
+ *
+ * \param arena if not NULL, the views are allocated from this arena
+ * \return      false if the memory could not be allocated
+ */
+bool init_view(mpc_lowmc_t const* lowmc, view_t* views[NUM_ROUNDS], mzd_arena_t* arena);
+/**
+ * Releases views allocated by init_view without an arena.
+ */
 void free_view(mpc_lowmc_t const* lowmc, view_t* views[NUM_ROUNDS]);
 
 #endif
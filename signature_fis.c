@@ -6,6 +6,14 @@
 #include "randomness.h"
 #include "timing.h"
 
+#include "thread_pool.h"
+
+#include <errno.h>
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <time.h>
+
 unsigned fis_compute_sig_size(unsigned m, unsigned n, unsigned r, unsigned k) {
   unsigned first_view_size = k;
   unsigned full_view_size  = n;
@@ -30,6 +38,27 @@ fis_signature_t* fis_sig_from_char_array(public_parameters_t* pp, unsigned char*
   return sig;
 }
 
+size_t fis_sig_serialized_size(public_parameters_t* pp, fis_signature_t const* sig) {
+  return proof_serialized_size(pp->lowmc, sig->proof, true);
+}
+
+size_t fis_sig_serialize_into(public_parameters_t* pp, fis_signature_t const* sig, uint8_t* out,
+                              size_t cap) {
+  return proof_serialize_into(pp->lowmc, sig->proof, out, cap, true);
+}
+
+bool fis_sig_parse_view(public_parameters_t* pp, const uint8_t* data, size_t len,
+                        fis_signature_t* sig) {
+  if (!sig->proof) {
+    sig->proof = calloc(1, sizeof(proof_t));
+    if (!sig->proof) {
+      return false;
+    }
+  }
+
+  return proof_parse(pp->lowmc, sig->proof, data, len, true) == len;
+}
+
 bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
                     fis_public_key_t* public_key) {
   TIME_FUNCTION;
@@ -42,13 +71,18 @@ bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
     return false;
   }
 
+  private_key->round_keys = lowmc_key_schedule_init(pp->lowmc, private_key->k);
+  if (!private_key->round_keys) {
+    return false;
+  }
+
   mzd_t* p = mzd_local_init(1, pp->lowmc->n);
   if (!p) {
     return false;
   }
 
   START_TIMING;
-  public_key->pk = lowmc_call(pp->lowmc, private_key->k, p);
+  public_key->pk = lowmc_call_key_schedule(pp->lowmc, private_key->round_keys, p);
   END_TIMING(timing_and_size->gen.pubkey);
 
   mzd_local_free(p);
@@ -57,6 +91,8 @@ bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
 }
 
 void fis_destroy_key(fis_private_key_t* private_key, fis_public_key_t* public_key) {
+  lowmc_key_schedule_free(private_key->round_keys);
+  private_key->round_keys = NULL;
   lowmc_key_free(private_key->k);
   private_key->k = NULL;
 
@@ -64,220 +100,1029 @@ void fis_destroy_key(fis_private_key_t* private_key, fis_public_key_t* public_ke
   public_key->pk = NULL;
 }
 
-static proof_t* fis_prove(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key, mzd_t* p, const uint8_t* m,
-                          unsigned m_len) {
+/**
+ * Computes the lanes <= SHA256_MULTI_LANES commitments starting with commitment first, where
+ * commitment i * SC_PROOF + j is the commitment to the views of party j in repetition i.
+ */
+static void fis_commit(mpc_lowmc_t const* lowmc, view_t* const* views,
+                       unsigned char (*keys)[SC_PROOF][PRNG_KEYSIZE],
+                       unsigned char (*r)[SC_PROOF][COMMITMENT_RAND_LENGTH], size_t first,
+                       unsigned int lanes, unsigned char (*hashes)[SC_PROOF][COMMITMENT_LENGTH]) {
+  const unsigned int view_count = lowmc->r + 2;
+
+  unsigned char const* k[SHA256_MULTI_LANES];
+  word* const* y[SHA256_MULTI_LANES];
+  view_t const* v[SHA256_MULTI_LANES];
+  unsigned int vidx[SHA256_MULTI_LANES];
+  unsigned char const* rs[SHA256_MULTI_LANES];
+  unsigned char* hash[SHA256_MULTI_LANES];
+  for (unsigned int l = 0; l < lanes; ++l) {
+    const size_t i       = (first + l) / SC_PROOF;
+    const unsigned int j = (first + l) % SC_PROOF;
+
+    k[l]    = keys[i][j];
+    y[l]    = views[i][view_count - 1].s;
+    v[l]    = views[i];
+    vidx[l] = j;
+    rs[l]   = r[i][j];
+    hash[l] = hashes[i][j];
+  }
+
+  H_multiple(lanes, k, y, lowmc, v, vidx, view_count, rs, hash);
+}
+
+/**
+ * The message independent part of a proof: the seeds and the views of the three parties and the
+ * commitments to them for all repetitions. The views are allocated from the arena.
+ */
+typedef struct {
+  unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE];
+  unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH];
+  unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH];
+  view_t* views[NUM_ROUNDS];
+  mzd_arena_t arena;
+} fis_presig_t;
+
+typedef struct {
+  mpc_lowmc_t* lowmc;
+  mzd_t* const* key_schedule;
+  mzd_t* p;
+  mzd_shared_t* s;
+  view_t* const* views;
+  unsigned char (*keys)[SC_PROOF][PRNG_KEYSIZE];
+  unsigned char (*r)[SC_PROOF][COMMITMENT_RAND_LENGTH];
+  unsigned char (*hashes)[SC_PROOF][COMMITMENT_LENGTH];
+  // cleared by a chunk whose buffers could not be allocated
+  atomic_bool* ok;
+} fis_presign_chunk_t;
+
+/**
+ * Computes the views of the repetitions begin <= i < end and commits to them. The buffers only
+ * needed during the MPC execution are allocated once per chunk.
+ */
+static void fis_presign_chunk(void* arg, size_t begin, size_t end) {
+  fis_presign_chunk_t const* chunk = arg;
+  mpc_lowmc_t* lowmc               = chunk->lowmc;
+  mzd_shared_t* s                  = chunk->s;
+  view_t* const* views             = chunk->views;
+
+  // repetitions are processed in pairs to fill the SIMD registers for small instances
+  mzd_t** rvec[2][SC_PROOF];
+  mpc_lowmc_scratch_t scratch[2];
+  bool ok = true;
+  for (unsigned int k = 0; k < 2; ++k) {
+    for (unsigned int j = 0; j < SC_PROOF; ++j) {
+      rvec[k][j] = malloc(sizeof(mzd_t*) * lowmc->r);
+      ok = rvec[k][j] && mzd_local_init_multiple_ex(rvec[k][j], lowmc->r, 1, lowmc->n, false) &&
+           ok;
+    }
+    ok = mpc_lowmc_scratch_init(&scratch[k], lowmc) && ok;
+  }
+  // the buffers are released below in any case
+  if (!ok) {
+    atomic_store(chunk->ok, false);
+    end = begin;
+  }
+
+  for (size_t i = begin; i < end; i += 2) {
+    const unsigned int reps = i + 1 < end ? 2 : 1;
+    // the seeds of both repetitions are expanded together
+    mzd_randomize_multiple_from_seeds(&rvec[0][0], lowmc->r, chunk->keys[i][0], reps * SC_PROOF);
+
+    if (reps == 2) {
+      mpc_lowmc_key_t* pair_keys[2]        = {&s[i], &s[i + 1]};
+      view_t* pair_views[2]                = {views[i], views[i + 1]};
+      mzd_t*** const pair_rvec[2]          = {rvec[0], rvec[1]};
+      mpc_lowmc_scratch_t* pair_scratch[2] = {&scratch[0], &scratch[1]};
+      mpc_lowmc_call_scratch_x2(lowmc, pair_keys, chunk->key_schedule, chunk->p, pair_views,
+                                pair_rvec, pair_scratch);
+    } else {
+      mpc_lowmc_call_scratch(lowmc, &s[i], chunk->key_schedule, chunk->p, views[i], rvec[0],
+                             &scratch[0]);
+    }
+
+    // the views of the repetitions are committed to while they are still cached
+    fis_commit(lowmc, views, chunk->keys, chunk->r, i * SC_PROOF, reps * SC_PROOF, chunk->hashes);
+  }
+
+  for (unsigned int k = 0; k < 2; ++k) {
+    mpc_lowmc_scratch_clear(&scratch[k]);
+    for (unsigned int j = 0; j < SC_PROOF; ++j) {
+      mzd_local_free_multiple(rvec[k][j]);
+      free(rvec[k][j]);
+    }
+  }
+}
+
+/**
+ * Computes count presignatures at once. The secret sharing, the MPC executions and the commitments
+ * of all count * FIS_NUM_ROUNDS repetitions are independent of each other, so they are processed
+ * as one flat list of work items, which is split into chunks for the thread pool.
+ */
+static bool fis_presign_batch(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key,
+                              mzd_t* const* key_schedule, mzd_t* p, size_t count,
+                              fis_presig_t* presigs) {
   TIME_FUNCTION;
 
-  const unsigned int view_count = lowmc->r + 2;
+  const size_t total_rounds = count * FIS_NUM_ROUNDS;
 
-  unsigned char r[FIS_NUM_ROUNDS][3][COMMITMENT_RAND_LENGTH];
-  unsigned char keys[FIS_NUM_ROUNDS][3][16];
+  unsigned char(*r)[3][COMMITMENT_RAND_LENGTH] = malloc(total_rounds * sizeof(*r));
+  unsigned char(*keys)[3][16]                  = malloc(total_rounds * sizeof(*keys));
+  unsigned char(*hashes)[3][COMMITMENT_LENGTH] = malloc(total_rounds * sizeof(*hashes));
+  // the views of each signature are allocated from an arena owned by its proof
+  view_t** views      = malloc(total_rounds * sizeof(view_t*));
+  mzd_arena_t* arenas = calloc(count, sizeof(mzd_arena_t));
+  // all shares of the batch live in one memory block
+  mzd_shared_t* s = malloc(total_rounds * sizeof(mzd_shared_t));
+  mzd_t** shares  = calloc(total_rounds * SC_PROOF, sizeof(mzd_t*));
   unsigned char secret_sharing_key[16];
 
+  bool ret = r && keys && hashes && views && arenas && s && shares &&
+             mzd_local_init_multiple_ex(shares, total_rounds * SC_PROOF, 1, lowmc->k, false);
+  for (size_t i = 0; ret && i < count; ++i) {
+    mzd_arena_init(&arenas[i], proof_views_size(lowmc, SC_PROOF));
+    ret = init_view(lowmc, &views[i * FIS_NUM_ROUNDS], &arenas[i]);
+  }
+
   // Generating keys
   START_TIMING;
-  if (rand_bytes((unsigned char*)keys, sizeof(keys)) != 1 ||
-      rand_bytes((unsigned char*)r, sizeof(r)) != 1 ||
-      rand_bytes(secret_sharing_key, sizeof(secret_sharing_key)) != 1) {
-    return 0;
-  }
+  ret = ret && rand_bytes((unsigned char*)keys, total_rounds * sizeof(*keys)) == 1 &&
+        rand_bytes((unsigned char*)r, total_rounds * sizeof(*r)) == 1 &&
+        rand_bytes(secret_sharing_key, sizeof(secret_sharing_key)) == 1;
   END_TIMING(timing_and_size->sign.rand);
 
+  if (ret) {
+    START_TIMING;
+    for (size_t i = 0; i < total_rounds; ++i) {
+      s[i].share_count = SC_PROOF;
+      for (unsigned int j = 0; j < SC_PROOF; ++j) {
+        s[i].shared[j] = shares[i * SC_PROOF + j];
+      }
+      mzd_local_copy(s[i].shared[2], lowmc_key);
+      mzd_shared_share_from_keys(&s[i], keys[i]);
+    }
+    END_TIMING(timing_and_size->sign.secret_sharing);
+
+    START_TIMING;
+    atomic_bool chunks_ok     = true;
+    fis_presign_chunk_t chunk = {lowmc, key_schedule, p, s, views, keys, r, hashes, &chunks_ok};
+    thread_pool_for(total_rounds, FIS_CHUNK_ROUNDS, fis_presign_chunk, &chunk);
+    ret = atomic_load(&chunks_ok);
+    // includes hashing the views
+    END_TIMING(timing_and_size->sign.lowmc_enc);
+  }
+
+  if (ret) {
+    for (size_t i = 0; i < count; ++i) {
+      const size_t offset = i * FIS_NUM_ROUNDS;
+
+      memcpy(presigs[i].keys, &keys[offset], sizeof(presigs[i].keys));
+      memcpy(presigs[i].r, &r[offset], sizeof(presigs[i].r));
+      memcpy(presigs[i].hashes, &hashes[offset], sizeof(presigs[i].hashes));
+      memcpy(presigs[i].views, &views[offset], sizeof(presigs[i].views));
+      presigs[i].arena = arenas[i];
+    }
+  } else if (arenas) {
+    for (size_t i = 0; i < count; ++i) {
+      mzd_arena_clear(&arenas[i]);
+    }
+  }
+
+  mzd_local_free_multiple(shares);
+  free(shares);
+  free(s);
+  free(arenas);
+  free(views);
+  free(hashes);
+  free(keys);
+  free(r);
+
+  return ret;
+}
+
+/**
+ * Completes a presignature to a proof of the message. The proof takes over the views of the
+ * presignature, so it can only be used once.
+ */
+static proof_t* fis_prove_presig(mpc_lowmc_t const* lowmc, fis_presig_t* presig,
+                                 const uint8_t* m, size_t m_len) {
+  unsigned char ch[FIS_NUM_ROUNDS];
+  fis_H3(presig->hashes, m, m_len, ch);
+
+  return create_proof(NULL, lowmc, presig->hashes, ch, presig->r, presig->keys, presig->views,
+                      &presig->arena);
+}
+
+/**
+ * Computes proofs for count messages at once.
+ */
+static bool fis_prove_batch(mpc_lowmc_t* lowmc, lowmc_key_t* lowmc_key,
+                            mzd_t* const* key_schedule, mzd_t* p, const uint8_t* const* ms,
+                            const size_t* m_lens, size_t count, proof_t** proofs) {
+  TIME_FUNCTION;
+
+  const uint64_t mzd_allocations = mzd_local_allocation_count();
+
+  // all other buffers of the batch are smaller than the presignatures
+  fis_presig_t* presigs =
+      count <= SIZE_MAX / sizeof(fis_presig_t) ? malloc(count * sizeof(fis_presig_t)) : NULL;
+  if (!presigs || !fis_presign_batch(lowmc, lowmc_key, key_schedule, p, count, presigs)) {
+    free(presigs);
+    return false;
+  }
+
   START_TIMING;
-  view_t* views[FIS_NUM_ROUNDS];
-  init_view(lowmc, views);
+  bool ret = true;
+  for (size_t i = 0; i < count; ++i) {
+    if (ret) {
+      proofs[i] = fis_prove_presig(lowmc, &presigs[i], ms[i], m_lens[i]);
+      ret       = proofs[i] != NULL;
+    } else {
+      mzd_arena_clear(&presigs[i].arena);
+    }
+  }
+  free(presigs);
+  END_TIMING(timing_and_size->sign.challenge);
+
+  if (!ret) {
+    for (size_t i = 0; proofs[i]; ++i) {
+      free_proof(lowmc, proofs[i]);
+    }
+    return false;
+  }
 
-  mzd_shared_t s[FIS_NUM_ROUNDS];
+  if (timing_and_size) {
+    timing_and_size->mzd_allocations = mzd_local_allocation_count() - mzd_allocations;
+  }
+  return true;
+}
+
+/**
+ * Recomputes the views of one repetition and the commitments of the two opened parties.
+ *
+ * \param rv       buffers for the randomness of the two parties
+ * \param yc       buffer for the reconstructed output share
+ * \param aes_prngs PRNGs used to expand the randomness of the two parties
+ */
+static void fis_verify_round(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
+                             view_t const* views, const unsigned char keys[SC_VERIFY][PRNG_KEYSIZE],
+                             const unsigned char r[SC_VERIFY][COMMITMENT_RAND_LENGTH],
+                             unsigned int a_i, mzd_t** rv[SC_VERIFY], mzd_t* yc,
+                             aes_prng_t aes_prngs[SC_VERIFY],
+                             unsigned char hash[SC_VERIFY][COMMITMENT_LENGTH]) {
+  const unsigned int view_count      = lowmc->r + 2;
+  const unsigned int last_view_index = lowmc->r + 1;
+
+  unsigned int b_i = (a_i + 1) % 3;
+  unsigned int c_i = (a_i + 2) % 3;
+
+  mzd_randomize_multiple_from_seeds_prng(rv, lowmc->r, keys[0], SC_VERIFY, aes_prngs);
+
+  // the views of the first party are recomputed and are stored contiguously
+  memset(views[1].s[0], 0, (view_count - 2) * view_stride(lowmc) * sizeof(word));
+
+  mpc_lowmc_verify_keys(lowmc, p, views, rv, a_i, keys);
+
+  view_t const* last_view = &views[last_view_index];
+  word const* cw          = CONST_FIRST_ROW(c);
+  word* y                 = FIRST_ROW(yc);
+  for (rci_t w = 0; w < yc->width; ++w) {
+    y[w] = cw[w] ^ last_view->s[0][w] ^ last_view->s[1][w];
+  }
+
+  word* ys[3];
+  ys[a_i] = last_view->s[0];
+  ys[b_i] = last_view->s[1];
+  ys[c_i] = y;
+
+  // the commitments of both parties are computed together
+  unsigned char const* k[SC_VERIFY]  = {keys[0], keys[1]};
+  word* const* yv[SC_VERIFY]         = {ys, ys};
+  view_t const* v[SC_VERIFY]         = {views, views};
+  const unsigned int vidx[SC_VERIFY] = {0, 1};
+  unsigned char const* rs[SC_VERIFY] = {r[0], r[1]};
+  unsigned char* h[SC_VERIFY]        = {hash[0], hash[1]};
+  H_multiple(SC_VERIFY, k, yv, lowmc, v, vidx, view_count, rs, h);
+}
+
+/**
+ * Recomputes the challenge from the commitments and compares it to the challenge of the proof.
+ */
+static bool fis_check_challenge(unsigned char const hash[FIS_NUM_ROUNDS][2][COMMITMENT_LENGTH],
+                                unsigned char const hashes[FIS_NUM_ROUNDS][COMMITMENT_LENGTH],
+                                unsigned char const ch_in[(FIS_NUM_ROUNDS + 3) / 4],
+                                const uint8_t* m, size_t m_len) {
+  unsigned char ch[FIS_NUM_ROUNDS];
+  fis_H3_verify(hash, hashes, ch_in, m, m_len, ch);
+
+  unsigned char ch_collapsed[(FIS_NUM_ROUNDS + 3) / 4] = {0};
   for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    mzd_shared_init(&s[i], lowmc_key);
-    mzd_shared_share_from_keys(&s[i], keys[i]);
+    const unsigned int idx   = i / 4;
+    const unsigned int shift = (i % 4) << 1;
+
+    ch_collapsed[idx] |= ch[i] << shift;
   }
-  END_TIMING(timing_and_size->sign.secret_sharing);
+
+  return !memcmp(ch_collapsed, ch_in, ((FIS_NUM_ROUNDS + 3) / 4) * sizeof(unsigned char));
+}
+
+typedef struct {
+  mpc_lowmc_t const* lowmc;
+  mzd_t const* p;
+  mzd_t const* const* cs;
+  proof_t const* const* prfs;
+  unsigned char (*hash)[2][COMMITMENT_LENGTH];
+} fis_verify_chunk_t;
+
+/**
+ * Verifies the (proof, repetition) pairs begin <= idx < end.
+ */
+static void fis_verify_chunk(void* arg, size_t begin, size_t end) {
+  fis_verify_chunk_t const* chunk = arg;
+  mpc_lowmc_t const* lowmc        = chunk->lowmc;
+  proof_t const* const* prfs      = chunk->prfs;
+
+  mzd_t** rv[SC_VERIFY];
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    rv[j] = malloc(sizeof(mzd_t*) * lowmc->r);
+    mzd_local_init_multiple_ex(rv[j], lowmc->r, 1, lowmc->n, false);
+  }
+  mzd_t* yc = mzd_local_init(1, lowmc->n);
+  aes_prng_t aes_prngs[SC_VERIFY];
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    aes_prng_init(&aes_prngs[j], prfs[0]->keys[0][j]);
+  }
+
+  for (size_t idx = begin; idx < end; ++idx) {
+    proof_t const* prf   = prfs[idx / FIS_NUM_ROUNDS];
+    const unsigned int i = idx % FIS_NUM_ROUNDS;
+
+    fis_verify_round(lowmc, chunk->p, chunk->cs[idx / FIS_NUM_ROUNDS], prf->views[i], prf->keys[i],
+                     prf->r[i], getChAt(prf->ch, i), rv, yc, aes_prngs, chunk->hash[idx]);
+  }
+
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    aes_prng_clear(&aes_prngs[j]);
+  }
+  mzd_local_free(yc);
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    mzd_local_free_multiple(rv[j]);
+    free(rv[j]);
+  }
+}
+
+/**
+ * Verifies count proofs at once. All (proof, repetition) pairs are processed as one flat list of
+ * work items, which is split into chunks for the thread pool. Bit i of valid is set iff the i-th
+ * proof verifies.
+ *
+ * \return the number of proofs that failed to verify
+ */
+static size_t fis_proof_verify_batch(mpc_lowmc_t const* lowmc, mzd_t const* p,
+                                     mzd_t const* const* cs, proof_t const* const* prfs,
+                                     const uint8_t* const* ms, const size_t* m_lens, size_t count,
+                                     uint8_t* valid) {
+  TIME_FUNCTION;
+
+  const size_t total_rounds = count * FIS_NUM_ROUNDS;
 
   START_TIMING;
-  mzd_t** c_mpc[FIS_NUM_ROUNDS];
+  unsigned char(*hash)[2][COMMITMENT_LENGTH] = malloc(total_rounds * sizeof(*hash));
+
+  fis_verify_chunk_t chunk = {lowmc, p, cs, prfs, hash};
+  thread_pool_for(total_rounds, FIS_CHUNK_ROUNDS, fis_verify_chunk, &chunk);
+
+  size_t failed = 0;
+  for (size_t s = 0; s < count; ++s) {
+    proof_t const* prf = prfs[s];
+
+    if (!fis_check_challenge(&hash[s * FIS_NUM_ROUNDS], prf->hashes, prf->ch, ms[s], m_lens[s])) {
+      valid[s / 8] &= ~(1 << (s % 8));
+      ++failed;
+    } else {
+      valid[s / 8] |= 1 << (s % 8);
+    }
+  }
+
+  free(hash);
+  END_TIMING(timing_and_size->verify.verify);
+
+  return failed;
+}
+
+typedef struct {
+  mpc_lowmc_t const* lowmc;
+  mzd_t const* p;
+  mzd_t const* c;
+  unsigned char const* ch;
+  unsigned char const* rounds;
+  size_t const* offsets;
+  unsigned char (*hash)[2][COMMITMENT_LENGTH];
+} fis_verify_serialized_chunk_t;
+
+/**
+ * Parses and verifies the serialized repetitions begin <= i < end one after another using the same
+ * view store.
+ */
+static void fis_verify_serialized_chunk(void* arg, size_t begin, size_t end) {
+  fis_verify_serialized_chunk_t const* chunk = arg;
+  mpc_lowmc_t const* lowmc                   = chunk->lowmc;
+
+  const size_t party_size = view_party_size(lowmc);
+  const size_t store_size = SC_VERIFY * party_size * sizeof(word);
 
-#ifdef WITH_OPENMP
-  mzd_t** rvecs[FIS_NUM_ROUNDS][3];
-#else
-  mzd_t** rvec[SC_PROOF];
-  for (unsigned int i = 0; i < SC_PROOF; ++i) {
-    rvec[i] = malloc(sizeof(mzd_t*) * lowmc->r);
-    mzd_local_init_multiple_ex(rvec[i], lowmc->r, 1, lowmc->n, false);
+  mzd_t** rv[SC_VERIFY];
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    rv[j] = malloc(sizeof(mzd_t*) * lowmc->r);
+    mzd_local_init_multiple_ex(rv[j], lowmc->r, 1, lowmc->n, false);
+  }
+  mzd_t* yc = mzd_local_init(1, lowmc->n);
+  aes_prng_t aes_prngs[SC_VERIFY];
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    aes_prng_init(&aes_prngs[j], chunk->rounds);
+  }
+
+  word* store   = aligned_alloc(32, (store_size + 31) & ~31);
+  view_t* views = malloc((2 + lowmc->r) * sizeof(view_t));
+  view_assign(lowmc, views, store, SC_VERIFY);
+
+  unsigned char keys[SC_VERIFY][PRNG_KEYSIZE];
+  unsigned char r[SC_VERIFY][COMMITMENT_RAND_LENGTH];
+
+  for (size_t i = begin; i < end; ++i) {
+    const unsigned int ch_i = getChAt(chunk->ch, i);
+
+    memset(store, 0, store_size);
+    proof_parse_round(lowmc, views, keys, r, ch_i, chunk->rounds + chunk->offsets[i],
+                      &aes_prngs[0]);
+
+    fis_verify_round(lowmc, chunk->p, chunk->c, views, keys, r, ch_i, rv, yc, aes_prngs,
+                     chunk->hash[i]);
+  }
+
+  free(views);
+  free(store);
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    aes_prng_clear(&aes_prngs[j]);
+  }
+  mzd_local_free(yc);
+  for (unsigned int j = 0; j < SC_VERIFY; ++j) {
+    mzd_local_free_multiple(rv[j]);
+    free(rv[j]);
   }
-#endif
+}
+
+/**
+ * Verifies a serialized proof. Each chunk of repetitions is parsed into its own view store, so only
+ * one set of views per thread is in memory at any time.
+ *
+ * \return 0 on success, a value != 0 if the proof is malformed or does not verify
+ */
+static int fis_proof_verify_serialized(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
+                                       const uint8_t* data, size_t len, const uint8_t* m,
+                                       size_t m_len) {
+  TIME_FUNCTION;
+
+  const size_t ch_size = (FIS_NUM_ROUNDS + 3) / 4;
+  if (len < ch_size + FIS_NUM_ROUNDS * COMMITMENT_LENGTH) {
+    return -1;
+  }
+
+  unsigned char const* ch                         = data;
+  unsigned char const(*hashes)[COMMITMENT_LENGTH] = (void const*)(data + ch_size);
+  unsigned char const* rounds = data + ch_size + FIS_NUM_ROUNDS * COMMITMENT_LENGTH;
 
-#pragma omp parallel for
+  // offsets of the repetitions; the size of each one depends on its challenge
+  size_t offsets[FIS_NUM_ROUNDS];
+  size_t size = rounds - data;
   for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-#ifdef WITH_OPENMP
-    mzd_t*** rvec = rvecs[i];
-    rvec[0]       = mzd_init_random_vectors_from_seed(keys[i][0], lowmc->n, lowmc->r);
-    rvec[1]       = mzd_init_random_vectors_from_seed(keys[i][1], lowmc->n, lowmc->r);
-    rvec[2]       = mzd_init_random_vectors_from_seed(keys[i][2], lowmc->n, lowmc->r);
-#else
+    const unsigned int ch_i = getChAt(ch, i);
+    if (ch_i > 2) {
+      return -1;
+    }
+    offsets[i] = size - (rounds - data);
+    size += proof_round_size(lowmc, ch_i);
+  }
+  if (size != len) {
+    return -1;
+  }
+
+  START_TIMING;
+  unsigned char(*hash)[2][COMMITMENT_LENGTH] = malloc(FIS_NUM_ROUNDS * sizeof(*hash));
+
+  fis_verify_serialized_chunk_t chunk = {lowmc, p, c, ch, rounds, offsets, hash};
+  thread_pool_for(FIS_NUM_ROUNDS, FIS_CHUNK_ROUNDS, fis_verify_serialized_chunk, &chunk);
+
+  const bool success = fis_check_challenge(hash, hashes, ch, m, m_len);
+
+  free(hash);
+  END_TIMING(timing_and_size->verify.verify);
+
+  return success ? 0 : -1;
+}
+
+struct fis_sign_ctx_s {
+  mpc_lowmc_t const* lowmc;
+  mzd_t* p;
+
+  unsigned char keys[NUM_ROUNDS][SC_PROOF][PRNG_KEYSIZE];
+  unsigned char hashes[NUM_ROUNDS][SC_PROOF][COMMITMENT_LENGTH];
+
+  view_t* views[NUM_ROUNDS];
+  mzd_shared_t shares[NUM_ROUNDS];
+  mzd_t* share_storage[NUM_ROUNDS * SC_PROOF];
+  // buffers for two repetitions computed together
+  mzd_t** rvec[2][SC_PROOF];
+  mpc_lowmc_scratch_t scratch[2];
+  aes_prng_t aes_prng;
+  // PRNGs expanding the seeds of two repetitions together
+  aes_prng_t rvec_prngs[2 * SC_PROOF];
+
+  view_t* proof_views;
+  proof_t proof;
+  fis_signature_t sig;
+
+  // kept last: GCC derives the address of the member following r from the argument of rand_bytes
+  // and then reports bogus -Wstringop-overflow warnings for the calls using that member
+  unsigned char r[NUM_ROUNDS][SC_PROOF][COMMITMENT_RAND_LENGTH];
+};
+
+fis_sign_ctx_t* fis_sign_ctx_init(public_parameters_t* pp) {
+  mpc_lowmc_t const* lowmc = pp->lowmc;
+
+  fis_sign_ctx_t* ctx = calloc(1, sizeof(fis_sign_ctx_t));
+  if (!ctx) {
+    return NULL;
+  }
+
+  ctx->lowmc       = lowmc;
+  ctx->p           = mzd_local_init(1, lowmc->n);
+  ctx->proof_views = malloc(NUM_ROUNDS * (lowmc->r + 2) * sizeof(view_t));
+  ctx->sig.proof   = &ctx->proof;
+
+  bool ok = ctx->p && ctx->proof_views && init_view(lowmc, ctx->views, NULL) &&
+            mzd_local_init_multiple_ex(ctx->share_storage, NUM_ROUNDS * SC_PROOF, 1, lowmc->k,
+                                       false);
+  for (unsigned int k = 0; ok && k < 2; ++k) {
+    for (unsigned int j = 0; ok && j < SC_PROOF; ++j) {
+      ctx->rvec[k][j] = malloc(sizeof(mzd_t*) * lowmc->r);
+      ok = ctx->rvec[k][j] &&
+           mzd_local_init_multiple_ex(ctx->rvec[k][j], lowmc->r, 1, lowmc->n, false);
+    }
+    ok = ok && mpc_lowmc_scratch_init(&ctx->scratch[k], lowmc);
+  }
+
+  static const unsigned char zero_key[PRNG_KEYSIZE] = {0};
+  ok = ok && aes_prng_init(&ctx->aes_prng, zero_key);
+  for (unsigned int j = 0; ok && j < 2 * SC_PROOF; ++j) {
+    ok = aes_prng_init(&ctx->rvec_prngs[j], zero_key);
+  }
+  if (!ok) {
+    fis_sign_ctx_free(ctx);
+    return NULL;
+  }
+
+  for (unsigned int i = 0; i < NUM_ROUNDS; ++i) {
+    ctx->shares[i].share_count = SC_PROOF;
     for (unsigned int j = 0; j < SC_PROOF; ++j) {
-      mzd_randomize_multiple_from_seed(rvec[j], lowmc->r, keys[i][j]);
+      ctx->shares[i].shared[j] = ctx->share_storage[i * SC_PROOF + j];
     }
-#endif
-    c_mpc[i] = mpc_lowmc_call(lowmc, &s[i], p, views[i], rvec);
   }
-  END_TIMING(timing_and_size->sign.lowmc_enc);
+
+  return ctx;
+}
+
+void fis_sign_ctx_free(fis_sign_ctx_t* ctx) {
+  if (!ctx) {
+    return;
+  }
+
+  free(ctx->proof_views);
+  for (unsigned int j = 0; j < 2 * SC_PROOF; ++j) {
+    aes_prng_clear(&ctx->rvec_prngs[j]);
+  }
+  aes_prng_clear(&ctx->aes_prng);
+  for (unsigned int k = 0; k < 2; ++k) {
+    mpc_lowmc_scratch_clear(&ctx->scratch[k]);
+    for (unsigned int j = 0; j < SC_PROOF; ++j) {
+      mzd_local_free_multiple(ctx->rvec[k][j]);
+      free(ctx->rvec[k][j]);
+    }
+  }
+  mzd_local_free_multiple(ctx->share_storage);
+  free_view(ctx->lowmc, ctx->views);
+  mzd_local_free(ctx->p);
+  free(ctx);
+}
+
+fis_signature_t* fis_sign_with_ctx(fis_sign_ctx_t* ctx, fis_private_key_t* private_key,
+                                   const uint8_t* msg, size_t msglen) {
+  TIME_FUNCTION;
+
+  const uint64_t mzd_allocations = mzd_local_allocation_count();
+  mpc_lowmc_t const* lowmc       = ctx->lowmc;
 
   START_TIMING;
-  unsigned char hashes[FIS_NUM_ROUNDS][3][COMMITMENT_LENGTH];
-#pragma omp parallel for
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    H(keys[i][0], c_mpc[i], views[i], 0, view_count, r[i][0], hashes[i][0]);
-    H(keys[i][1], c_mpc[i], views[i], 1, view_count, r[i][1], hashes[i][1]);
-    H(keys[i][2], c_mpc[i], views[i], 2, view_count, r[i][2], hashes[i][2]);
+  if (rand_bytes((unsigned char*)ctx->keys, sizeof(ctx->keys)) != 1 ||
+      rand_bytes((unsigned char*)ctx->r, sizeof(ctx->r)) != 1) {
+    return NULL;
   }
-  END_TIMING(timing_and_size->sign.views);
+  END_TIMING(timing_and_size->sign.rand);
 
   START_TIMING;
-  unsigned char ch[FIS_NUM_ROUNDS];
-  fis_H3(hashes, m, m_len, ch);
+  for (unsigned int i = 0; i < NUM_ROUNDS; ++i) {
+    mzd_local_copy(ctx->shares[i].shared[2], private_key->k);
+    mzd_shared_share_from_keys_prng(&ctx->shares[i], ctx->keys[i], &ctx->aes_prng);
+  }
+  END_TIMING(timing_and_size->sign.secret_sharing);
 
-  proof_t* proof = create_proof(NULL, lowmc, hashes, ch, r, keys, views);
+  START_TIMING;
+  for (unsigned int i = 0; i < NUM_ROUNDS; i += 2) {
+    const unsigned int reps = i + 1 < NUM_ROUNDS ? 2 : 1;
+    mzd_randomize_multiple_from_seeds_prng(&ctx->rvec[0][0], lowmc->r, ctx->keys[i][0],
+                                           reps * SC_PROOF, ctx->rvec_prngs);
 
-  for (unsigned int j = 0; j < FIS_NUM_ROUNDS; ++j) {
-    mzd_shared_clear(&s[j]);
-#ifdef WITH_OPENMP
-    for (unsigned int i = 0; i < SC_PROOF; ++i) {
-      mzd_local_free_multiple(rvecs[j][i]);
-      free(rvecs[j][i]);
+    if (reps == 2) {
+      mpc_lowmc_key_t* pair_keys[2]        = {&ctx->shares[i], &ctx->shares[i + 1]};
+      view_t* pair_views[2]                = {ctx->views[i], ctx->views[i + 1]};
+      mzd_t*** const pair_rvec[2]          = {ctx->rvec[0], ctx->rvec[1]};
+      mpc_lowmc_scratch_t* pair_scratch[2] = {&ctx->scratch[0], &ctx->scratch[1]};
+      mpc_lowmc_call_scratch_x2(lowmc, pair_keys, private_key->round_keys, ctx->p, pair_views,
+                                pair_rvec, pair_scratch);
+    } else {
+      mpc_lowmc_call_scratch(lowmc, &ctx->shares[i], private_key->round_keys, ctx->p,
+                             ctx->views[i], ctx->rvec[0], &ctx->scratch[0]);
     }
-#endif
-    mpc_free(c_mpc[j], 3);
-  }
 
-#ifndef WITH_OPENMP
-  for (unsigned int i = 0; i < SC_PROOF; ++i) {
-    mzd_local_free_multiple(rvec[i]);
-    free(rvec[i]);
+    // the views of the repetitions are committed to while they are still cached
+    fis_commit(lowmc, ctx->views, ctx->keys, ctx->r, i * SC_PROOF, reps * SC_PROOF,
+               ctx->hashes);
   }
-#endif
+  // includes hashing the views
+  END_TIMING(timing_and_size->sign.lowmc_enc);
 
-  free_view(lowmc, views);
+  START_TIMING;
+  unsigned char ch[NUM_ROUNDS];
+  fis_H3(ctx->hashes, msg, msglen, ch);
+  create_proof_ref(&ctx->proof, lowmc, ctx->hashes, ch, ctx->r, ctx->keys, ctx->views,
+                   ctx->proof_views);
   END_TIMING(timing_and_size->sign.challenge);
 
-  return proof;
+  if (timing_and_size) {
+    timing_and_size->mzd_allocations = mzd_local_allocation_count() - mzd_allocations;
+  }
+  return &ctx->sig;
 }
 
-static int fis_proof_verify(mpc_lowmc_t const* lowmc, mzd_t const* p, mzd_t const* c,
-                            proof_t const* prf, const uint8_t* m, unsigned m_len) {
-  TIME_FUNCTION;
+fis_signature_t* fis_sign(public_parameters_t* pp, fis_private_key_t* private_key,
+                          const uint8_t* msg, size_t msglen) {
+  fis_signature_t* sig = NULL;
+  if (!fis_sign_batch(pp, private_key, &msg, &msglen, 1, &sig)) {
+    return NULL;
+  }
+  return sig;
+}
 
-  const unsigned int view_count      = lowmc->r + 2;
-  const unsigned int last_view_index = lowmc->r + 1;
+bool fis_set_threads(unsigned int threads) {
+  return thread_pool_set_threads(threads);
+}
 
-#ifdef WITH_OPENMP
-  mzd_t* ycs[FIS_NUM_ROUNDS] = {NULL};
-  mzd_local_init_multiple(ycs, FIS_NUM_ROUNDS, 1, lowmc->n);
-#else
-  mzd_t* yc    = mzd_local_init(1, lowmc->n);
-#endif
+bool fis_sign_batch(public_parameters_t* pp, fis_private_key_t* private_key,
+                    const uint8_t* const* msgs, const size_t* msglens, size_t count,
+                    fis_signature_t** sigs) {
+  proof_t** proofs =
+      count <= SIZE_MAX / sizeof(proof_t*) ? malloc(count * sizeof(proof_t*)) : NULL;
+  mzd_t* p = mzd_local_init(1, pp->lowmc->n);
 
-  START_TIMING;
-  unsigned char ch[FIS_NUM_ROUNDS];
-  unsigned char hash[FIS_NUM_ROUNDS][2][COMMITMENT_LENGTH];
+  bool ret = proofs && p &&
+             fis_prove_batch(pp->lowmc, private_key->k, private_key->round_keys, p, msgs,
+                             msglens, count, proofs);
+  for (size_t i = 0; ret && i < count; ++i) {
+    sigs[i] = malloc(sizeof(fis_signature_t));
+    if (!sigs[i]) {
+      // the signatures created so far own their proofs
+      for (size_t j = 0; j < i; ++j) {
+        fis_free_signature(pp, sigs[j]);
+        sigs[j] = NULL;
+      }
+      for (size_t j = i; j < count; ++j) {
+        free_proof(pp->lowmc, proofs[j]);
+      }
+      ret = false;
+    } else {
+      sigs[i]->proof = proofs[i];
+    }
+  }
 
-#ifndef WITH_OPENMP
-  mzd_t** rv[SC_VERIFY];
-  for (unsigned int i = 0; i < SC_VERIFY; ++i) {
-    rv[i] = malloc(sizeof(mzd_t*) * lowmc->r);
-    mzd_local_init_multiple_ex(rv[i], lowmc->r, 1, lowmc->n, false);
+  mzd_local_free(p);
+  free(proofs);
+  return ret;
+}
+
+// delay in milliseconds before a failed presignature is computed again; doubled after every
+// consecutive failure
+#define FIS_PRESIG_BACKOFF_MIN 1
+#define FIS_PRESIG_BACKOFF_MAX 1000
+
+struct fis_presig_pool_s {
+  public_parameters_t* pp;
+  fis_private_key_t* private_key;
+
+  pthread_mutex_t lock;
+  // signalled whenever a presignature is taken from the pool and when the pool is stopped
+  pthread_cond_t not_full;
+  fis_presig_t** presigs;
+  size_t capacity;
+  // number of presignatures in presigs
+  size_t count;
+  // number of presignatures currently computed by the workers
+  size_t pending;
+  // number of presignatures the workers failed to compute
+  size_t failures;
+  bool stop;
+
+  pthread_t* threads;
+  unsigned int num_threads;
+
+  // next pool in the list of all pools
+  fis_presig_pool_t* next;
+};
+
+// all pools, so that their presignatures can be dropped in a child process after fork()
+static fis_presig_pool_t* presig_pools         = NULL;
+static pthread_mutex_t presig_pools_lock       = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t presig_pools_atfork_once = PTHREAD_ONCE_INIT;
+
+static void fis_presig_free(fis_presig_t* presig) {
+  mzd_arena_clear(&presig->arena);
+  OPENSSL_cleanse(presig, sizeof(fis_presig_t));
+  free(presig);
+}
+
+/**
+ * Blocks all pools, so that none of them is modified while the process is forked.
+ */
+static void fis_presig_pools_prepare(void) {
+  pthread_mutex_lock(&presig_pools_lock);
+  for (fis_presig_pool_t* pool = presig_pools; pool; pool = pool->next) {
+    pthread_mutex_lock(&pool->lock);
   }
-#endif
+}
 
-#pragma omp parallel for
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    unsigned int a_i = getChAt(prf->ch, i);
-    unsigned int b_i = (a_i + 1) % 3;
-    unsigned int c_i = (a_i + 2) % 3;
-
-#ifdef WITH_OPENMP
-    mzd_t** rv[2];
-    rv[0] = mzd_init_random_vectors_from_seed(prf->keys[i][0], lowmc->n, lowmc->r);
-    rv[1] = mzd_init_random_vectors_from_seed(prf->keys[i][1], lowmc->n, lowmc->r);
-#else
-    for (unsigned int j = 0; j < SC_VERIFY; ++j) {
-      mzd_randomize_multiple_from_seed(rv[j], lowmc->r, prf->keys[i][j]);
+static void fis_presig_pools_parent(void) {
+  for (fis_presig_pool_t* pool = presig_pools; pool; pool = pool->next) {
+    pthread_mutex_unlock(&pool->lock);
+  }
+  pthread_mutex_unlock(&presig_pools_lock);
+}
+
+/**
+ * A presignature must never be used by both processes, since two signatures sharing the seeds of
+ * a presignature reveal the private key. The child therefore drops all presignatures. The workers
+ * do not exist in the child, so the pools are stopped and all signatures are computed as by
+ * fis_sign.
+ */
+static void fis_presig_pools_child(void) {
+  for (fis_presig_pool_t* pool = presig_pools; pool; pool = pool->next) {
+    for (size_t i = 0; i < pool->count; ++i) {
+      fis_presig_free(pool->presigs[i]);
     }
-#endif
+    pool->count       = 0;
+    pool->pending     = 0;
+    pool->stop        = true;
+    pool->num_threads = 0;
+    // threads of the parent might have been waiting on the condition variable
+    pthread_cond_init(&pool->not_full, NULL);
+    pthread_mutex_unlock(&pool->lock);
+  }
+  pthread_mutex_unlock(&presig_pools_lock);
+}
+
+static void fis_presig_pools_setup(void) {
+  pthread_atfork(fis_presig_pools_prepare, fis_presig_pools_parent, fis_presig_pools_child);
+}
+
+/**
+ * Waits until the delay has passed or the pool is stopped. Must be called with the lock held.
+ */
+static void fis_presig_pool_backoff(fis_presig_pool_t* pool, unsigned int milliseconds) {
+  struct timespec until;
+  clock_gettime(CLOCK_REALTIME, &until);
+  until.tv_sec += milliseconds / 1000;
+  until.tv_nsec += (long)(milliseconds % 1000) * 1000000;
+  if (until.tv_nsec >= 1000000000) {
+    until.tv_sec += 1;
+    until.tv_nsec -= 1000000000;
+  }
+
+  while (!pool->stop && pthread_cond_timedwait(&pool->not_full, &pool->lock, &until) != ETIMEDOUT) {
+  }
+}
+
+static void* fis_presig_pool_worker(void* arg) {
+  fis_presig_pool_t* pool = arg;
+  mpc_lowmc_t* lowmc      = pool->pp->lowmc;
+
+  mzd_t* p             = mzd_local_init(1, lowmc->n);
+  unsigned int backoff = FIS_PRESIG_BACKOFF_MIN;
 
-    for (unsigned int j = 1; j < view_count - 1; ++j) {
-      mzd_local_clear(prf->views[i][j].s[0]);
+  pthread_mutex_lock(&pool->lock);
+  while (true) {
+    while (!pool->stop && pool->count + pool->pending >= pool->capacity) {
+      pthread_cond_wait(&pool->not_full, &pool->lock);
     }
+    if (pool->stop) {
+      break;
+    }
+    ++pool->pending;
+    pthread_mutex_unlock(&pool->lock);
 
-    mpc_lowmc_verify_keys(lowmc, p, prf->views[i], rv, a_i, prf->keys[i]);
+    fis_presig_t* presig = malloc(sizeof(fis_presig_t));
+    const bool ret = presig && fis_presign_batch(lowmc, pool->private_key->k,
+                                                 pool->private_key->round_keys, p, 1, presig);
 
-    mzd_t* ys[3];
-    ys[a_i] = prf->views[i][last_view_index].s[0];
-    ys[b_i] = prf->views[i][last_view_index].s[1];
-    ys[c_i] = (mzd_t*)c;
+    pthread_mutex_lock(&pool->lock);
+    --pool->pending;
+    if (ret) {
+      pool->presigs[pool->count++] = presig;
+      backoff                      = FIS_PRESIG_BACKOFF_MIN;
+      continue;
+    }
 
-#ifdef WITH_OPENMP
-    mzd_t* yc = ycs[i];
-#endif
-    ys[c_i] = mpc_reconstruct_from_share(yc, ys);
+    // the allocation or the randomness source failed; the worker keeps running and tries again
+    // after a while, since signing falls back to fis_sign anyway
+    free(presig);
+    ++pool->failures;
+    fis_presig_pool_backoff(pool, backoff);
+    if (backoff < FIS_PRESIG_BACKOFF_MAX) {
+      backoff *= 2;
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
 
-    H(prf->keys[i][0], ys, prf->views[i], 0, view_count, prf->r[i][0], hash[i][0]);
-    H(prf->keys[i][1], ys, prf->views[i], 1, view_count, prf->r[i][1], hash[i][1]);
+  mzd_local_free(p);
+  return NULL;
+}
 
-#ifdef WITH_OPENMP
-    mzd_local_free_multiple(rv[1]);
-    free(rv[1]);
-    mzd_local_free_multiple(rv[0]);
-    free(rv[0]);
-#endif
+fis_presig_pool_t* fis_presig_pool_init(public_parameters_t* pp, fis_private_key_t* private_key,
+                                        size_t capacity, unsigned int threads) {
+  if (!capacity || !threads) {
+    return NULL;
   }
-  fis_H3_verify(hash, prf->hashes, prf->ch, m, m_len, ch);
 
-#ifdef WITH_OPENMP
-  mzd_local_free_multiple(ycs);
-#else
-  for (unsigned int i = 0; i < SC_VERIFY; ++i) {
-    mzd_local_free_multiple(rv[i]);
-    free(rv[i]);
+  fis_presig_pool_t* pool = calloc(1, sizeof(fis_presig_pool_t));
+  if (!pool) {
+    return NULL;
   }
-  mzd_local_free(yc);
-#endif
+  pool->pp          = pp;
+  pool->private_key = private_key;
+  pool->capacity    = capacity;
+  pool->presigs     = calloc(capacity, sizeof(fis_presig_t*));
+  pool->threads     = calloc(threads, sizeof(pthread_t));
+  if (!pool->presigs || !pool->threads) {
+    free(pool->threads);
+    free(pool->presigs);
+    free(pool);
+    return NULL;
+  }
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->not_full, NULL);
 
-  unsigned char ch_collapsed[(FIS_NUM_ROUNDS + 3) / 4] = {0};
-  for (unsigned int i = 0; i < FIS_NUM_ROUNDS; ++i) {
-    const unsigned int idx   = i / 4;
-    const unsigned int shift = (i % 4) << 1;
+  pthread_once(&presig_pools_atfork_once, fis_presig_pools_setup);
+  pthread_mutex_lock(&presig_pools_lock);
+  pool->next   = presig_pools;
+  presig_pools = pool;
+  pthread_mutex_unlock(&presig_pools_lock);
 
-    ch_collapsed[idx] |= ch[i] << shift;
+  for (unsigned int i = 0; i < threads; ++i) {
+    if (pthread_create(&pool->threads[i], NULL, fis_presig_pool_worker, pool) != 0) {
+      break;
+    }
+    ++pool->num_threads;
+  }
+  if (!pool->num_threads) {
+    fis_presig_pool_free(pool);
+    return NULL;
   }
 
-  const int success_status =
-      memcmp(ch_collapsed, prf->ch, ((FIS_NUM_ROUNDS + 3) / 4) * sizeof(unsigned char));
-  END_TIMING(timing_and_size->verify.verify);
+  return pool;
+}
 
-  START_TIMING;
+void fis_presig_pool_free(fis_presig_pool_t* pool) {
+  if (!pool) {
+    return;
+  }
+
+  pthread_mutex_lock(&presig_pools_lock);
+  fis_presig_pool_t** link = &presig_pools;
+  while (*link != pool) {
+    link = &(*link)->next;
+  }
+  *link = pool->next;
+  pthread_mutex_unlock(&presig_pools_lock);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+  pthread_cond_broadcast(&pool->not_full);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (unsigned int i = 0; i < pool->num_threads; ++i) {
+    pthread_join(pool->threads[i], NULL);
+  }
 
-  return success_status;
+  for (size_t i = 0; i < pool->count; ++i) {
+    fis_presig_free(pool->presigs[i]);
+  }
+
+  pthread_cond_destroy(&pool->not_full);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool->threads);
+  free(pool->presigs);
+  free(pool);
 }
 
-fis_signature_t* fis_sign(public_parameters_t* pp, fis_private_key_t* private_key,
-                          const uint8_t* msg, size_t msglen) {
+size_t fis_presig_pool_available(fis_presig_pool_t* pool) {
+  pthread_mutex_lock(&pool->lock);
+  const size_t count = pool->count;
+  pthread_mutex_unlock(&pool->lock);
+  return count;
+}
+
+size_t fis_presig_pool_failures(fis_presig_pool_t* pool) {
+  pthread_mutex_lock(&pool->lock);
+  const size_t failures = pool->failures;
+  pthread_mutex_unlock(&pool->lock);
+  return failures;
+}
+
+fis_signature_t* fis_sign_with_pool(fis_presig_pool_t* pool, const uint8_t* msg, size_t msglen) {
+  pthread_mutex_lock(&pool->lock);
+  fis_presig_t* presig = pool->count ? pool->presigs[--pool->count] : NULL;
+  if (presig) {
+    pthread_cond_signal(&pool->not_full);
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  if (!presig) {
+    // the workers did not keep up, so the signature is computed from scratch
+    return fis_sign(pool->pp, pool->private_key, msg, msglen);
+  }
+
   fis_signature_t* sig = malloc(sizeof(fis_signature_t));
-  mzd_t* p             = mzd_local_init(1, pp->lowmc->n);
-  sig->proof           = fis_prove(pp->lowmc, private_key->k, p, msg, msglen);
-  mzd_local_free(p);
+  if (!sig) {
+    fis_presig_free(presig);
+    return NULL;
+  }
+  sig->proof = fis_prove_presig(pool->pp->lowmc, presig, msg, msglen);
+  OPENSSL_cleanse(presig, sizeof(fis_presig_t));
+  free(presig);
   return sig;
 }
 
 int fis_verify(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
                size_t msglen, fis_signature_t* sig) {
+  uint8_t valid = 0;
+  return fis_verify_batch(pp, &public_key, &msg, &msglen, &sig, 1, &valid);
+}
+
+int fis_verify_batch(public_parameters_t* pp, fis_public_key_t* const* public_keys,
+                     const uint8_t* const* msgs, const size_t* msglens,
+                     fis_signature_t* const* sigs, size_t count, uint8_t* valid) {
+  mzd_t const** cs     = malloc(count * sizeof(mzd_t const*));
+  proof_t const** prfs = malloc(count * sizeof(proof_t const*));
+  for (size_t i = 0; i < count; ++i) {
+    cs[i]   = public_keys[i]->pk;
+    prfs[i] = sigs[i]->proof;
+  }
+
   mzd_t* p = mzd_local_init(1, pp->lowmc->n);
-  int res  = fis_proof_verify(pp->lowmc, p, public_key->pk, sig->proof, msg, msglen);
+  const size_t failed =
+      fis_proof_verify_batch(pp->lowmc, p, cs, prfs, msgs, msglens, count, valid);
   mzd_local_free(p);
-  return res;
+
+  free(prfs);
+  free(cs);
+  return failed != 0;
+}
+
+int fis_verify_from_char_array(public_parameters_t* pp, fis_public_key_t* public_key,
+                               const uint8_t* msg, size_t msglen, const uint8_t* data,
+                               size_t len) {
+  mzd_t* p = mzd_local_init(1, pp->lowmc->n);
+  const int ret =
+      fis_proof_verify_serialized(pp->lowmc, p, public_key->pk, data, len, msg, msglen);
+  mzd_local_free(p);
+  return ret;
+}
+
+void fis_clear_signature(public_parameters_t* pp, fis_signature_t* signature) {
+  if (signature->proof) {
+    free_proof(pp->lowmc, signature->proof);
+    signature->proof = NULL;
+  }
 }
 
 void fis_free_signature(public_parameters_t* pp, fis_signature_t* signature) {
-  free_proof(pp->lowmc, signature->proof);
+  fis_clear_signature(pp, signature);
   free(signature);
 }
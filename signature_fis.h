@@ -8,16 +8,67 @@ typedef struct {
   mzd_t* pk;
 } fis_public_key_t;
 
-typedef struct { lowmc_key_t* k; } fis_private_key_t;
+typedef struct {
+  lowmc_key_t* k;
+  // round keys of k, computed once in fis_create_key
+  mzd_t** round_keys;
+} fis_private_key_t;
 
 typedef struct { proof_t* proof; } fis_signature_t;
 
+/**
+ * Holds all buffers required to compute a signature.
+ */
+typedef struct fis_sign_ctx_s fis_sign_ctx_t;
+
+/**
+ * Bounded pool of presignatures, i.e. of the message independent parts of signatures computed
+ * ahead of time by background threads. Every presignature is used for exactly one signature.
+ */
+typedef struct fis_presig_pool_s fis_presig_pool_t;
+
 unsigned fis_compute_sig_size(unsigned m, unsigned n, unsigned r, unsigned k);
 
 unsigned char* fis_sig_to_char_array(public_parameters_t* pp, fis_signature_t* sig, unsigned* len);
 
 fis_signature_t* fis_sig_from_char_array(public_parameters_t* pp, unsigned char* data);
 
+/**
+ * Number of bytes required to serialize the signature.
+ */
+size_t fis_sig_serialized_size(public_parameters_t* pp, fis_signature_t const* sig);
+
+/**
+ * Serializes a signature into a caller provided buffer without allocating any memory.
+ *
+ * \param out the output buffer
+ * \param cap the size of the output buffer
+ * \return    the number of bytes written or 0 if out is too small
+ */
+size_t fis_sig_serialize_into(public_parameters_t* pp, fis_signature_t const* sig, uint8_t* out,
+                              size_t cap);
+
+/**
+ * Parses a serialized signature of exactly len bytes. The views are read directly from data into
+ * the proof of sig. If sig already holds a parsed signature, its memory is reused.
+ *
+ * \param sig a zero-initialized signature or one from a previous call, to be released with
+ *            fis_clear_signature
+ * \return    true if data holds a well-formed signature, false otherwise
+ */
+bool fis_sig_parse_view(public_parameters_t* pp, const uint8_t* data, size_t len,
+                        fis_signature_t* sig);
+
+/**
+ * Sets the number of worker threads shared by all signing and verification calls. The repetitions
+ * of every call are split into chunks that are computed by the workers and the calling thread, so
+ * concurrent calls do not start threads of their own. With 0 workers, which is the default, every
+ * call is computed in the calling thread. Must not be called while signing or verifying.
+ *
+ * \return true on success, false if the workers could not be started
+ */
+bool fis_set_threads(unsigned int threads);
+
 bool fis_create_key(public_parameters_t* pp, fis_private_key_t* private_key,
                     fis_public_key_t* public_key);
 
@@ -26,9 +77,115 @@ void fis_destroy_key(fis_private_key_t* private_key, fis_public_key_t* public_ke
 fis_signature_t* fis_sign(public_parameters_t* pp, fis_private_key_t* private_key,
                           const uint8_t* msg, size_t msglen);
 
+/**
+ * Signs count messages with the same private key. The MPC executions of all signatures are
+ * distributed over the threads set with fis_set_threads.
+ *
+ * \param msgs    the messages
+ * \param msglens the lengths of the messages
+ * \param count   the number of messages
+ * \param sigs    array of count elements receiving the signatures
+ * \return        true on success, false otherwise. On failure, no signatures are returned.
+ */
+bool fis_sign_batch(public_parameters_t* pp, fis_private_key_t* private_key,
+                    const uint8_t* const* msgs, const size_t* msglens, size_t count,
+                    fis_signature_t** sigs);
+
+/**
+ * Allocates a signing context for the given instance. A context must only be used by one thread at
+ * a time.
+ *
+ * \return the context or NULL on failure
+ */
+fis_sign_ctx_t* fis_sign_ctx_init(public_parameters_t* pp);
+
+void fis_sign_ctx_free(fis_sign_ctx_t* ctx);
+
+/**
+ * Signs a message using only the buffers of the signing context, i.e. without allocating any
+ * memory. The repetitions are computed in the calling thread.
+ *
+ * \param ctx the signing context
+ * \return    the signature or NULL on failure. The signature is owned by the context and is valid
+ *            until the next call with the same context. It must not be passed to
+ *            fis_free_signature.
+ */
+fis_signature_t* fis_sign_with_ctx(fis_sign_ctx_t* ctx, fis_private_key_t* private_key,
+                                   const uint8_t* msg, size_t msglen);
+
+/**
+ * Starts threads computing presignatures for the private key until capacity presignatures are
+ * available. Whenever a presignature is taken from the pool, it is refilled. pp and private_key
+ * must stay valid until the pool is freed. A child process created by fork() starts with an empty
+ * pool without threads, so that it never reuses a presignature of its parent.
+ *
+ * \param capacity the maximal number of presignatures kept in the pool
+ * \param threads  the number of background threads
+ * \return         the pool or NULL on failure
+ */
+fis_presig_pool_t* fis_presig_pool_init(public_parameters_t* pp, fis_private_key_t* private_key,
+                                        size_t capacity, unsigned int threads);
+
+/**
+ * Stops the background threads and releases all unused presignatures.
+ */
+void fis_presig_pool_free(fis_presig_pool_t* pool);
+
+/**
+ * Number of presignatures currently available in the pool.
+ */
+size_t fis_presig_pool_available(fis_presig_pool_t* pool);
+
+/**
+ * Number of presignatures the background threads failed to compute so far. A failed presignature
+ * is computed again after a delay.
+ */
+size_t fis_presig_pool_failures(fis_presig_pool_t* pool);
+
+/**
+ * Signs a message using a presignature from the pool, so that only the challenge has to be derived
+ * from the message and the proof has to be assembled. If the pool is empty, the signature is
+ * computed as by fis_sign. Can be called from multiple threads.
+ *
+ * \return the signature or NULL on failure
+ */
+fis_signature_t* fis_sign_with_pool(fis_presig_pool_t* pool, const uint8_t* msg, size_t msglen);
+
 int fis_verify(public_parameters_t* pp, fis_public_key_t* public_key, const uint8_t* msg,
                size_t msglen, fis_signature_t* sig);
 
+/**
+ * Verifies count signatures. The repetitions of all signatures are distributed over the threads
+ * set with fis_set_threads.
+ *
+ * \param public_keys the public keys, one per signature
+ * \param msgs        the messages
+ * \param msglens     the lengths of the messages
+ * \param sigs        the signatures
+ * \param count       the number of signatures
+ * \param valid       bitmap of (count + 7) / 8 bytes; bit i is set iff the i-th signature is valid
+ * \return            0 if all signatures are valid and a value != 0 otherwise
+ */
+int fis_verify_batch(public_parameters_t* pp, fis_public_key_t* const* public_keys,
+                     const uint8_t* const* msgs, const size_t* msglens,
+                     fis_signature_t* const* sigs, size_t count, uint8_t* valid);
+
+/**
+ * Verifies a serialized signature of exactly len bytes without parsing it first. The repetitions
+ * are parsed from data while they are verified, so the memory used for the views does not depend
+ * on the number of repetitions.
+ *
+ * \return 0 if the signature is valid and a value != 0 otherwise
+ */
+int fis_verify_from_char_array(public_parameters_t* pp, fis_public_key_t* public_key,
+                               const uint8_t* msg, size_t msglen, const uint8_t* data,
+                               size_t len);
+
+/**
+ * Releases the proof of a signature, but not the signature itself.
+ */
+void fis_clear_signature(public_parameters_t* pp, fis_signature_t* signature);
+
 void fis_free_signature(public_parameters_t* pp, fis_signature_t* signature);
 
 #endif
@@ -14,7 +14,10 @@
 #define FN_ATTRIBUTES_SSE2_NP __attribute__((__always_inline__, target("sse2")))
 
 #define CPU_SUPPORTS_AVX2 __builtin_cpu_supports("avx2")
+#define CPU_SUPPORTS_AVX512                                                                        \
+  (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl"))
 #define CPU_SUPPORTS_SSE4_1 __builtin_cpu_supports("sse4.1")
+#define CPU_SUPPORTS_AESNI __builtin_cpu_supports("aes")
 
 #ifdef __x86_64__
 #define CPU_SUPPORTS_SSE2 1
@@ -53,6 +56,51 @@ static inline __m256i FN_ATTRIBUTES_AVX2 mm256_shift_right(__m256i data, unsigne
   return _mm256_or_si256(data, carry);
 }
 
+/**
+ * \brief Perform a left shift on both 128 bit halves of a 256 bit value.
+ */
+static inline __m256i FN_ATTRIBUTES_AVX2 mm256_shift_left_x2(__m256i data, unsigned int count) {
+  if (!count) {
+    return data;
+  }
+
+  __m256i carry = _mm256_bslli_epi128(data, 8);
+  carry         = _mm256_srli_epi64(carry, 64 - count);
+  data          = _mm256_slli_epi64(data, count);
+  return _mm256_or_si256(data, carry);
+}
+
+/**
+ * \brief Perform a right shift on both 128 bit halves of a 256 bit value.
+ */
+static inline __m256i FN_ATTRIBUTES_AVX2 mm256_shift_right_x2(__m256i data, unsigned int count) {
+  if (!count) {
+    return data;
+  }
+
+  __m256i carry = _mm256_bsrli_epi128(data, 8);
+  carry         = _mm256_slli_epi64(carry, 64 - count);
+  data          = _mm256_srli_epi64(data, count);
+  return _mm256_or_si256(data, carry);
+}
+
+/**
+ * \brief Load two 16 byte aligned 128 bit values into the halves of a 256 bit value.
+ */
+static inline __m256i FN_ATTRIBUTES_AVX2 mm256_load_x2(void const* lo, void const* hi) {
+  const __m128i l = *(__m128i const*)__builtin_assume_aligned(lo, 16);
+  const __m128i h = *(__m128i const*)__builtin_assume_aligned(hi, 16);
+  return _mm256_inserti128_si256(_mm256_castsi128_si256(l), h, 1);
+}
+
+/**
+ * \brief Store the halves of a 256 bit value to two 16 byte aligned locations.
+ */
+static inline void FN_ATTRIBUTES_AVX2_NP mm256_store_x2(void* lo, void* hi, __m256i data) {
+  *(__m128i*)__builtin_assume_aligned(lo, 16) = _mm256_castsi256_si128(data);
+  *(__m128i*)__builtin_assume_aligned(hi, 16) = _mm256_extracti128_si256(data, 1);
+}
+
 /**
  * \brief xor multiple 256 bit values.
  */
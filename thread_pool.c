@@ -0,0 +1,333 @@
+#include "thread_pool.h"
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+  thread_pool_fn fn;
+  void* arg;
+  size_t grain;
+  // number of items not processed yet
+  atomic_size_t remaining;
+} thread_pool_job_t;
+
+typedef struct {
+  thread_pool_job_t* job;
+  size_t begin;
+  size_t end;
+} thread_pool_task_t;
+
+/**
+ * Tasks of one thread. The owner pushes and pops at the tail, other threads steal the oldest and
+ * therefore largest tasks from the head.
+ */
+typedef struct {
+  pthread_mutex_t lock;
+  thread_pool_task_t* tasks;
+  size_t head;
+  size_t tail;
+  size_t capacity;
+} thread_pool_deque_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  // signalled when a task is pushed and when the pool is stopped
+  pthread_cond_t wake;
+  // signalled when a task is pushed and when a job is finished, so that waiting callers can take
+  // the chunks of their own jobs
+  pthread_cond_t done;
+  // number of tasks in all deques
+  atomic_size_t queued;
+  // number of tasks pushed so far
+  atomic_size_t pushed;
+  bool stop;
+
+  unsigned int num_workers;
+  pthread_t* threads;
+  // one deque per worker and one shared by all threads outside of the pool
+  thread_pool_deque_t* deques;
+} thread_pool_t;
+
+static _Atomic(thread_pool_t*) pool = NULL;
+static pthread_once_t pool_once = PTHREAD_ONCE_INIT;
+// index of the deque of the current thread if it is a worker
+static _Thread_local unsigned int worker_index = UINT_MAX;
+
+static unsigned int own_deque(thread_pool_t const* p) {
+  return worker_index < p->num_workers ? worker_index : p->num_workers;
+}
+
+static bool deque_push(thread_pool_deque_t* deque, thread_pool_task_t const* task) {
+  pthread_mutex_lock(&deque->lock);
+  if (deque->tail == deque->capacity) {
+    if (deque->head) {
+      memmove(deque->tasks, deque->tasks + deque->head,
+              (deque->tail - deque->head) * sizeof(thread_pool_task_t));
+      deque->tail -= deque->head;
+      deque->head = 0;
+    } else {
+      const size_t capacity     = deque->capacity ? 2 * deque->capacity : 16;
+      thread_pool_task_t* tasks = realloc(deque->tasks, capacity * sizeof(thread_pool_task_t));
+      if (!tasks) {
+        pthread_mutex_unlock(&deque->lock);
+        return false;
+      }
+      deque->tasks    = tasks;
+      deque->capacity = capacity;
+    }
+  }
+  deque->tasks[deque->tail++] = *task;
+  pthread_mutex_unlock(&deque->lock);
+  return true;
+}
+
+/**
+ * Removes the newest task if job is NULL or if it belongs to job.
+ */
+static bool deque_pop(thread_pool_deque_t* deque, thread_pool_job_t const* job,
+                      thread_pool_task_t* task) {
+  bool ret = false;
+  pthread_mutex_lock(&deque->lock);
+  if (deque->tail > deque->head && (!job || deque->tasks[deque->tail - 1].job == job)) {
+    *task = deque->tasks[--deque->tail];
+    ret   = true;
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return ret;
+}
+
+/**
+ * Removes the oldest task, or the oldest task belonging to job if job is not NULL.
+ */
+static bool deque_steal(thread_pool_deque_t* deque, thread_pool_job_t const* job,
+                        thread_pool_task_t* task) {
+  bool ret = false;
+  pthread_mutex_lock(&deque->lock);
+  for (size_t i = deque->head; i < deque->tail; ++i) {
+    if (!job || deque->tasks[i].job == job) {
+      *task = deque->tasks[i];
+      memmove(deque->tasks + deque->head + 1, deque->tasks + deque->head,
+              (i - deque->head) * sizeof(thread_pool_task_t));
+      ++deque->head;
+      ret = true;
+      break;
+    }
+  }
+  pthread_mutex_unlock(&deque->lock);
+  return ret;
+}
+
+/**
+ * Takes a task from the deque of the current thread or steals one from another deque. If job is
+ * not NULL, only tasks of job are taken.
+ */
+static bool pool_take(thread_pool_t* p, unsigned int own, thread_pool_job_t const* job,
+                      thread_pool_task_t* task) {
+  const unsigned int num_deques = p->num_workers + 1;
+
+  bool ret = deque_pop(&p->deques[own], job, task);
+  // the deque of the threads outside of the pool is shared, so the tasks of job might be buried
+  // below the tasks of other callers
+  if (!ret && job) {
+    ret = deque_steal(&p->deques[own], job, task);
+  }
+  for (unsigned int i = 1; !ret && i < num_deques; ++i) {
+    ret = deque_steal(&p->deques[(own + i) % num_deques], job, task);
+  }
+  if (ret) {
+    atomic_fetch_sub(&p->queued, 1);
+  }
+  return ret;
+}
+
+/**
+ * Runs a task. As long as it is larger than the grain of its job, its upper half is pushed to the
+ * deque of the current thread, so that idle threads can steal it.
+ */
+static void pool_run(thread_pool_t* p, unsigned int own, thread_pool_task_t task) {
+  thread_pool_job_t* job = task.job;
+  const size_t grain     = job->grain;
+
+  while (task.end - task.begin > grain) {
+    const size_t half              = (task.end - task.begin) / 2;
+    const thread_pool_task_t upper = {job, task.begin + (half + grain - 1) / grain * grain,
+                                      task.end};
+    // counted before it is pushed, so that queued never underflows when the task is stolen
+    atomic_fetch_add(&p->queued, 1);
+    if (!deque_push(&p->deques[own], &upper)) {
+      atomic_fetch_sub(&p->queued, 1);
+      break;
+    }
+    task.end = upper.begin;
+
+    atomic_fetch_add(&p->pushed, 1);
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_signal(&p->wake);
+    pthread_cond_broadcast(&p->done);
+    pthread_mutex_unlock(&p->lock);
+  }
+
+  job->fn(job->arg, task.begin, task.end);
+
+  const size_t items = task.end - task.begin;
+  if (atomic_fetch_sub(&job->remaining, items) == items) {
+    pthread_mutex_lock(&p->lock);
+    pthread_cond_broadcast(&p->done);
+    pthread_mutex_unlock(&p->lock);
+  }
+}
+
+static void* pool_worker(void* arg) {
+  thread_pool_t* p = atomic_load(&pool);
+  worker_index     = (unsigned int)(uintptr_t)arg;
+
+  while (true) {
+    thread_pool_task_t task;
+    if (pool_take(p, worker_index, NULL, &task)) {
+      pool_run(p, worker_index, task);
+      continue;
+    }
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->stop && !atomic_load(&p->queued)) {
+      pthread_cond_wait(&p->wake, &p->lock);
+    }
+    const bool stop = p->stop;
+    pthread_mutex_unlock(&p->lock);
+    if (stop) {
+      break;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Stops the first started workers and releases the pool.
+ */
+static void pool_free(thread_pool_t* p, unsigned int started) {
+  pthread_mutex_lock(&p->lock);
+  p->stop = true;
+  pthread_cond_broadcast(&p->wake);
+  pthread_mutex_unlock(&p->lock);
+
+  for (unsigned int i = 0; i < started; ++i) {
+    pthread_join(p->threads[i], NULL);
+  }
+  for (unsigned int i = 0; i <= p->num_workers; ++i) {
+    pthread_mutex_destroy(&p->deques[i].lock);
+    free(p->deques[i].tasks);
+  }
+
+  pthread_cond_destroy(&p->done);
+  pthread_cond_destroy(&p->wake);
+  pthread_mutex_destroy(&p->lock);
+  free(p->deques);
+  free(p->threads);
+  free(p);
+}
+
+/**
+ * The workers do not exist in a child process and the locks might have been held by them, so the
+ * child drops the pool without touching it and computes all loops in the calling thread. The pool
+ * is leaked deliberately: a worker might have been growing a deque during the fork, so the task
+ * arrays of the copy cannot be freed safely. The leak is bounded by one pool per fork.
+ */
+static void pool_atfork_child(void) {
+  atomic_store(&pool, NULL);
+}
+
+static void pool_setup(void) {
+  pthread_atfork(NULL, NULL, pool_atfork_child);
+}
+
+bool thread_pool_set_threads(unsigned int threads) {
+  pthread_once(&pool_once, pool_setup);
+
+  thread_pool_t* old = atomic_exchange(&pool, NULL);
+  if (old) {
+    pool_free(old, old->num_workers);
+  }
+  if (!threads) {
+    return true;
+  }
+
+  thread_pool_t* p = calloc(1, sizeof(thread_pool_t));
+  if (!p) {
+    return false;
+  }
+  p->threads = calloc(threads, sizeof(pthread_t));
+  p->deques  = calloc(threads + 1, sizeof(thread_pool_deque_t));
+  if (!p->threads || !p->deques) {
+    free(p->deques);
+    free(p->threads);
+    free(p);
+    return false;
+  }
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->wake, NULL);
+  pthread_cond_init(&p->done, NULL);
+  atomic_init(&p->queued, 0);
+  atomic_init(&p->pushed, 0);
+  for (unsigned int i = 0; i <= threads; ++i) {
+    pthread_mutex_init(&p->deques[i].lock, NULL);
+  }
+
+  p->num_workers = threads;
+
+  // the workers read the pool from the global, so it has to be set before they are started
+  atomic_store(&pool, p);
+  for (unsigned int i = 0; i < threads; ++i) {
+    if (pthread_create(&p->threads[i], NULL, pool_worker, (void*)(uintptr_t)i) != 0) {
+      atomic_store(&pool, NULL);
+      pool_free(p, i);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+unsigned int thread_pool_get_threads(void) {
+  thread_pool_t const* p = atomic_load(&pool);
+  return p ? p->num_workers : 0;
+}
+
+void thread_pool_for(size_t count, size_t grain, thread_pool_fn fn, void* arg) {
+  thread_pool_t* p = atomic_load(&pool);
+  if (!grain) {
+    grain = 1;
+  }
+  if (!p || count <= grain) {
+    if (count) {
+      fn(arg, 0, count);
+    }
+    return;
+  }
+
+  thread_pool_job_t job  = {fn, arg, grain, count};
+  const unsigned int own = own_deque(p);
+  pool_run(p, own, (thread_pool_task_t){&job, 0, count});
+
+  // help with the remaining chunks of the job and wait for the ones run by other threads
+  while (atomic_load(&job.remaining)) {
+    const size_t pushed = atomic_load(&p->pushed);
+    thread_pool_task_t task;
+    if (pool_take(p, own, &job, &task)) {
+      pool_run(p, own, task);
+      continue;
+    }
+
+    // woken up whenever a chunk is pushed or a job is finished; chunks pushed since the attempt to
+    // take one are taken without waiting
+    pthread_mutex_lock(&p->lock);
+    if (atomic_load(&job.remaining) && atomic_load(&p->pushed) == pushed) {
+      pthread_cond_wait(&p->done, &p->lock);
+    }
+    pthread_mutex_unlock(&p->lock);
+  }
+}
@@ -0,0 +1,34 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Body of a parallel loop processing the items begin <= i < end.
+ */
+typedef void (*thread_pool_fn)(void* arg, size_t begin, size_t end);
+
+/**
+ * Replaces the library wide pool by one with the given number of worker threads. With 0 workers,
+ * all loops are executed by the calling thread. Must not be called while a loop is running. A child
+ * process created by fork() starts without workers.
+ *
+ * \return true on success, false if the workers could not be started
+ */
+bool thread_pool_set_threads(unsigned int threads);
+
+/**
+ * Number of worker threads of the library wide pool.
+ */
+unsigned int thread_pool_get_threads(void);
+
+/**
+ * Calls fn for the items 0 <= i < count. The range is split into chunks of at least grain items,
+ * whose boundaries are multiples of grain. Chunks not yet started are stolen by idle workers, so
+ * loops of concurrent callers share the same workers. The calling thread takes part in its loop and
+ * returns when all items have been processed.
+ */
+void thread_pool_for(size_t count, size_t grain, thread_pool_fn fn, void* arg);
+
+#endif
@@ -1,4 +1,3 @@
 #include "timing.h"
 
-static timing_and_size_t storage;
-timing_and_size_t* timing_and_size = &storage;
+_Thread_local timing_and_size_t* timing_and_size = NULL;
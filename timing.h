@@ -10,24 +10,34 @@ typedef union {
       uint64_t lowmc_init, keygen, pubkey;
     } gen;
     struct {
-      uint64_t rand, secret_sharing, lowmc_enc, views, challenge;
+      uint64_t rand, secret_sharing, lowmc_enc, challenge;
     } sign;
     struct {
       uint64_t challenge, output_shares, output_views, verify;
     } verify;
     uint64_t size;
+    // number of mzd_local buffers allocated by the signing thread; buffers allocated by the workers
+    // set with fis_set_threads are not included
+    uint64_t mzd_allocations;
   };
   uint64_t data[13];
 } timing_and_size_t;
 
-extern timing_and_size_t* timing_and_size;
+// per thread, so that concurrently signing threads do not share the timings; threads that do not
+// set it record no timings
+extern _Thread_local timing_and_size_t* timing_and_size;
 
 #ifdef WITH_DETAILED_TIMING
 
 #define gettime gettime_clock
 #define TIME_FUNCTION uint64_t start_time
-#define START_TIMING start_time = gettime()
-#define END_TIMING(dst) dst     = gettime() - start_time
+#define START_TIMING start_time = timing_and_size ? gettime() : 0
+#define END_TIMING(dst)                                                                            \
+  do {                                                                                             \
+    if (timing_and_size) {                                                                         \
+      dst = gettime() - start_time;                                                                \
+    }                                                                                              \
+  } while (0)
 
 #define TIMING_SCALE (1000000 / CLOCKS_PER_SEC);
 
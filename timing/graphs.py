@@ -71,11 +71,11 @@ def lookup_style(style, *args):
 
 
 def compute_sign(data):
-  return np.sum(data[:, 3:8] / 1000, axis=1)
+  return np.sum(data[:, 3:7] / 1000, axis=1)
 
 
 def compute_verify(data):
-  return np.sum(data[:, 8:12] / 1000, axis=1)
+  return np.sum(data[:, 7:11] / 1000, axis=1)
 
 
 def round_up(x, f=5.0):